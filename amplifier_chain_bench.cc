@@ -0,0 +1,98 @@
+#include <amplifier.hh>
+#include <int_computer.hh>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+
+template<typename Fn>
+auto best_of_3(Fn fn) -> double {
+  double best = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    const auto t0 = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+    if (i == 0 || elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+///\brief Run the day 7 search (all permutations of \p first .. \p first+4), \p rounds times.
+template<typename Chain>
+auto search(const int_computer_state& program, int first, bool feedback, unsigned int rounds)
+-> int_computer_state::value_type {
+  int_computer_state::value_type best = 0;
+  for (unsigned int r = 0; r < rounds; ++r) {
+    std::array<int, 5> phases;
+    for (int i = 0; i < 5; ++i) phases[i] = first + i;
+    do {
+      Chain c(phases.begin(), phases.end(), program);
+      best = std::max(best, feedback ? c.feedback_eval(0) : c(0));
+    } while (std::next_permutation(phases.begin(), phases.end()));
+  }
+  return best;
+}
+
+///\brief Like search(), but resetting a single chain for each permutation.
+template<typename Chain>
+auto search_reset(const int_computer_state& program, int first, bool feedback, unsigned int rounds)
+-> int_computer_state::value_type {
+  phase_cache cache(program);
+  Chain c;
+  int_computer_state::value_type best = 0;
+  for (unsigned int r = 0; r < rounds; ++r) {
+    std::array<int, 5> phases;
+    for (int i = 0; i < 5; ++i) phases[i] = first + i;
+    do {
+      c.reset(phases.begin(), phases.end(), cache);
+      best = std::max(best, feedback ? c.feedback_eval(0) : c(0));
+    } while (std::next_permutation(phases.begin(), phases.end()));
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "amplifier_chain_bench";
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: " << progname << " program_file [rounds]" << std::endl;
+    return 1;
+  }
+
+  try {
+    auto file = std::ifstream(argv[1]);
+    const int_computer_state program = int_computer_state::parse(file);
+    const unsigned int rounds = (argc >= 3 ? std::strtoul(argv[2], nullptr, 10) : 20u);
+
+    std::cout << std::setw(10) << "mode"
+        << std::setw(14) << "vector (s)"
+        << std::setw(14) << "fixed<5> (s)"
+        << std::setw(14) << "reset (s)"
+        << std::setw(10) << "speedup" << std::endl;
+    for (const bool feedback : { false, true }) {
+      const int first = (feedback ? 5 : 0);
+      const auto expect = search<amplifier_chain>(program, first, feedback, 1);
+      if (expect != search<fixed_amplifier_chain<5>>(program, first, feedback, 1)
+          || expect != search_reset<fixed_amplifier_chain<5>>(program, first, feedback, 1))
+        throw std::runtime_error("chains disagree");
+
+      const double vector_time = best_of_3([&]() { search<amplifier_chain>(program, first, feedback, rounds); });
+      const double fixed_time = best_of_3([&]() { search<fixed_amplifier_chain<5>>(program, first, feedback, rounds); });
+      const double reset_time = best_of_3([&]() { search_reset<fixed_amplifier_chain<5>>(program, first, feedback, rounds); });
+      std::cout << std::setw(10) << (feedback ? "feedback" : "single")
+          << std::setw(14) << std::fixed << std::setprecision(4) << vector_time
+          << std::setw(14) << fixed_time
+          << std::setw(14) << reset_time
+          << std::setw(10) << std::setprecision(2) << vector_time / reset_time << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
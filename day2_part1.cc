@@ -1,4 +1,5 @@
 #include <int_computer.hh>
+#include <perf_counters.hh>
 #include <exception>
 #include <iostream>
 
@@ -7,7 +8,10 @@ int main(int argc, char* argv[]) {
 
   try {
     int_computer_state ic = int_computer_state::parse(std::cin);
-    std::cout << ic.eval_and_get() << std::endl;
+    auto perf = perf_scope::from_env("day2_part1");
+    const auto result = ic.eval_and_get();
+    perf.reset();
+    std::cout << result << std::endl;
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl
         << std::endl
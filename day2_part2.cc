@@ -1,21 +1,74 @@
+#include <checkpoint.hh>
 #include <int_computer.hh>
+#include <perf_counters.hh>
+#include <telemetry.hh>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 
 constexpr int_computer_state::value_type SOUGHT = 19690720; 
 
 int main() {
   try {
     const int_computer_state program = int_computer_state::parse(std::cin);
-    for (int_computer_state::value_type verb = 0; verb < 100; ++verb) {
-      for (int_computer_state::value_type noun = 0; noun < 100; ++noun) {
-        auto testcase = program;
-        testcase[1] = noun;
-        testcase[2] = verb;
-        if (testcase.eval_and_get() == SOUGHT)
-          std::cout << std::setw(4) << std::right << (100 * noun + verb) << std::endl;
+    const auto metrics = telemetry_dumper::from_env();
+    const auto perf = perf_scope::from_env("day2_part2");
+
+    // If INT_COMPUTER_CHECKPOINT names a file, the search saves its progress
+    // there (every 10 seconds, on SIGUSR1, and on SIGINT/SIGTERM),
+    // and a later run resumes from it.
+    const char* checkpoint_file = std::getenv("INT_COMPUTER_CHECKPOINT");
+    std::uint64_t next = 0;
+    std::vector<int_computer_state::value_type> found;
+    std::optional<checkpoint_trigger> trigger;
+    if (checkpoint_file != nullptr) {
+      if (std::ifstream(checkpoint_file).good()) {
+        checkpoint_reader r(checkpoint_file);
+        if (r.read_state() != program) throw std::runtime_error("checkpoint is of a different program");
+        next = r.read_u64();
+        found = r.read_values();
+      }
+      trigger.emplace(std::chrono::seconds(10));
+    }
+    const auto save = [&]() {
+      checkpoint_writer w;
+      w.write(program);
+      w.write(next);
+      w.write(found);
+      w.commit(checkpoint_file);
+    };
+
+    for (const auto answer : found)
+      std::cout << std::setw(4) << std::right << answer << std::endl;
+    for (; next < 100u * 100u; ++next) {
+      if (trigger.has_value() && trigger->due()) {
+        save();
+        if (trigger->stop_requested()) {
+          std::cerr << "interrupted, progress saved to " << checkpoint_file << std::endl;
+          return 1;
+        }
+      }
+
+      const int_computer_state::value_type verb = next / 100u;
+      const int_computer_state::value_type noun = next % 100u;
+      auto testcase = program;
+      testcase[1] = noun;
+      testcase[2] = verb;
+      const auto result = testcase.eval_and_get();
+      telemetry::add(telemetry::counter::searches);
+      if (result == SOUGHT) {
+        found.push_back(100 * noun + verb);
+        std::cout << std::setw(4) << std::right << found.back() << std::endl;
       }
     }
+    if (checkpoint_file != nullptr) std::remove(checkpoint_file);
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
   }
@@ -1,4 +1,8 @@
+#include <buffered_io.hh>
 #include <int_computer.hh>
+#include <perf_counters.hh>
+#include <telemetry.hh>
+#include <trace_recorder.hh>
 #include <exception>
 #include <iostream>
 #include <fstream>
@@ -11,16 +15,18 @@ int main(int argc, char* argv[]) {
     int_computer_state ic = int_computer_state::parse(program);
     program.close();
 
-    ic.read_cb = []() -> int_computer_state::value_type {
-      int_computer_state::value_type i;
-      std::cin >> i;
-      return i;
-    };
-    ic.write_cb = [](int_computer_state::value_type i) {
-      std::cout << i << "\n";
-    };
+    const auto metrics = telemetry_dumper::from_env();
+    const auto tracer = trace_recorder::from_env();
+    ic.tracer = tracer.get();
 
-    ic.eval();
+    buffered_io io;
+    io.attach(ic);
+
+    {
+      const auto perf = perf_scope::from_env("day5_part1");
+      ic.eval();
+    }
+    io.flush();
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl
         << std::endl
@@ -1,4 +1,6 @@
 #include <int_computer.hh>
+#include <perf_counters.hh>
+#include <telemetry.hh>
 #include <algorithm>
 #include <array>
 #include <exception>
@@ -35,6 +37,7 @@ auto find_solution_(const int_computer_state& program, phase_setting_type& phase
       const auto eval_out = int_computer_state::single_output(program, { s, in_value });
       if (last) {
         solutions.emplace_back(phase_setting, eval_out);
+        telemetry::add(telemetry::counter::searches);
       } else {
         solutions.push_back(find_solution_(program, phase_setting, idx + 1u, eval_out));
       }
@@ -63,7 +66,12 @@ int main(int argc, char* argv[]) {
   const auto progname = argc >= 1 ? argv[0] : "run";
 
   try {
-    std::cout << find_solution(load_computer(std::string(progname) + ".txt")).output << std::endl;
+    const auto program = load_computer(std::string(progname) + ".txt");
+    const auto metrics = telemetry_dumper::from_env();
+    auto perf = perf_scope::from_env("day7_part1");
+    const auto result = find_solution(program);
+    perf.reset();
+    std::cout << result.output << std::endl;
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
     return 1;
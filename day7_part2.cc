@@ -1,5 +1,7 @@
 #include <amplifier.hh>
 #include <int_computer.hh>
+#include <perf_counters.hh>
+#include <telemetry.hh>
 #include <algorithm>
 #include <array>
 #include <exception>
@@ -19,14 +21,18 @@ auto all_permutations(std::function<void(std::array<int, 5>)> cb) {
 
 
 auto find_solution(const int_computer_state& program) -> int_computer_state::value_type {
+  // A single chain is reset for every permutation, reusing its memory
+  // and the warmed up amplifiers of the cache.
+  phase_cache cache(program);
+  fixed_amplifier_chain<5> chain;
+
   return objpipe::new_callback<std::array<int, 5>>(all_permutations)
       .transform(
-          [&program](const std::array<int, 5>& phase_settings) -> amplifier_chain {
-            return amplifier_chain(phase_settings.begin(), phase_settings.end(), program);
-          })
-      .transform(
-          [](amplifier_chain c) -> amplifier_chain::value_type {
-            return c.feedback_eval(0);
+          [&cache, &chain](const std::array<int, 5>& phase_settings) -> fixed_amplifier_chain<5>::value_type {
+            chain.reset(phase_settings.begin(), phase_settings.end(), cache);
+            const auto result = chain.feedback_eval(0);
+            telemetry::add(telemetry::counter::searches);
+            return result;
           })
       .max()
       .value(); // derefence optional
@@ -41,7 +47,12 @@ int main(int argc, char* argv[]) {
   const auto progname = argc >= 1 ? argv[0] : "run";
 
   try {
-    std::cout << find_solution(load_computer(std::string(progname) + ".txt")) << std::endl;
+    const auto program = load_computer(std::string(progname) + ".txt");
+    const auto metrics = telemetry_dumper::from_env();
+    auto perf = perf_scope::from_env("day7_part2");
+    const auto result = find_solution(program);
+    perf.reset();
+    std::cout << result << std::endl;
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
     return 1;
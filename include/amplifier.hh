@@ -2,19 +2,57 @@
 #define AMPLIFIER_HH
 
 #include <int_computer.hh>
+#include <telemetry.hh>
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 
+///\brief Raised when a feedback loop revisits an earlier state.
+///\details A program in such a state will never halt.
+class feedback_loop_error
+: public std::runtime_error
+{
+  public:
+  explicit feedback_loop_error(std::size_t period);
+
+  ~feedback_loop_error();
+
+  ///\brief Number of feedback rounds after which the state repeats.
+  auto period() const noexcept -> std::size_t { return period_; }
+
+  private:
+  std::size_t period_;
+};
+
+
 class amplifier {
   public:
   using value_type = int_computer_state::value_type;
 
   amplifier() = default;
-  amplifier(int_computer_state program, int phase_setting);
+  ///\param[in] cfg If not null, control flow graph of \p program, which is
+  ///used for block-at-a-time evaluation.
+  amplifier(int_computer_state program, int phase_setting, std::shared_ptr<const control_flow_graph> cfg = nullptr);
+
+  ///\brief Recreate an amplifier from the state of a suspended amplifier.
+  ///\pre \p s is waiting for input or halted, as an amplifier is between calls.
+  ///\details If \p s modified its own code, blocks of \p cfg are checked before use.
+  static auto resume(int_computer_state s, std::shared_ptr<const control_flow_graph> cfg = nullptr) -> amplifier;
+
+  ///\brief State of the machine, which is waiting for input or halted.
+  auto state() const noexcept -> const int_computer_state& { return s_; }
 
   auto empty() const noexcept -> bool {
     return s_.empty();
@@ -26,10 +64,51 @@ class amplifier {
 
   auto operator()(value_type v) -> value_type;
 
+  auto fingerprint() const noexcept -> std::size_t {
+    return s_.fingerprint();
+  }
+
+  auto operator==(const amplifier& y) const noexcept -> bool {
+    return s_ == y.s_;
+  }
+
+  auto operator!=(const amplifier& y) const noexcept -> bool {
+    return !(*this == y);
+  }
+
   private:
+  auto eval_until_io_or_halt_() -> int_computer_state::io_pending;
   void eval_until_read_or_halt_();
 
   int_computer_state s_;
+  std::shared_ptr<const control_flow_graph> cfg_;
+};
+
+
+///\brief Amplifiers of a single program, warmed up for each phase setting.
+///\details
+///Warming up an amplifier runs its program until it has read its phase setting,
+///which only depends on the phase setting. The cache does this once per setting,
+///after which resetting a chain copies the warmed up amplifiers into place.
+///
+///The cache may be shared between threads.
+class phase_cache {
+  public:
+  explicit phase_cache(int_computer_state program);
+  phase_cache(const phase_cache&) = delete;
+  phase_cache& operator=(const phase_cache&) = delete;
+
+  auto program() const noexcept -> const int_computer_state& { return program_; }
+
+  ///\brief Amplifier running the program, which has read \p phase_setting.
+  ///\details The reference stays valid for the lifetime of the cache.
+  auto get(int phase_setting) -> const amplifier&;
+
+  private:
+  int_computer_state program_;
+  std::shared_ptr<const control_flow_graph> cfg_;
+  std::mutex mtx_;
+  std::unordered_map<int, amplifier> amps_;
 };
 
 
@@ -43,18 +122,62 @@ class amplifier_chain {
 
   template<typename Iter>
   amplifier_chain(Iter phase_settings_begin, Iter phase_settings_end, const int_computer_state& program) {
+    const auto cfg = make_cfg_(program);
     std::transform(phase_settings_begin, phase_settings_end, std::back_inserter(elems_),
-        [&program](const auto& phase_setting) -> amplifier {
-          return amplifier(program, phase_setting);
+        [&program, &cfg](const auto& phase_setting) -> amplifier {
+          return amplifier(program, phase_setting, cfg);
         });
   }
 
+  ///\brief Replace the amplifiers by fresh amplifiers of \p cache's program,
+  ///with the given phase settings.
+  ///\details
+  ///The memory of the current amplifiers is reused, so once the chain held
+  ///this many amplifiers, a reset doesn't allocate.
+  template<typename Iter>
+  void reset(Iter phase_settings_begin, Iter phase_settings_end, phase_cache& cache) {
+    elems_.resize(std::distance(phase_settings_begin, phase_settings_end));
+    for (auto& amp : elems_) amp = cache.get(*phase_settings_begin++);
+  }
+
+  auto size() const noexcept -> std::size_t { return elems_.size(); }
+  auto operator[](std::size_t idx) const -> const amplifier& { return elems_[idx]; }
+  auto begin() const noexcept -> std::vector<amplifier>::const_iterator { return elems_.begin(); }
+  auto end() const noexcept -> std::vector<amplifier>::const_iterator { return elems_.end(); }
+
   auto is_halt() const -> bool {
     return std::all_of(elems_.begin(), elems_.end(), [](const amplifier& a) { return a.is_halt(); });
   }
 
   auto operator()(value_type v) -> value_type;
+
+  ///\brief Feed the output back into the chain, until all amplifiers halt.
+  ///\throws feedback_loop_error if the chain enters a cycle.
   auto feedback_eval(value_type v) -> value_type;
+  ///\brief Run at most \p max_rounds rounds of feedback_eval(), from and into \p v.
+  ///\details
+  ///Between calls, the chain and \p v can be saved to a checkpoint, so a long
+  ///feedback loop can be interrupted and resumed. Cycle detection restarts
+  ///with each call, so only cycles well within \p max_rounds are detected.
+  ///\return True once all amplifiers have halted; \p v then holds the result.
+  ///\throws feedback_loop_error if the chain enters a cycle.
+  auto feedback_rounds(value_type& v, std::uint64_t max_rounds) -> bool;
+
+  ///\brief Combined fingerprint of all amplifiers.
+  auto fingerprint() const noexcept -> std::size_t {
+    std::size_t h = elems_.size();
+    for (const auto& amp : elems_)
+      h ^= amp.fingerprint() + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+  }
+
+  auto operator==(const amplifier_chain& y) const noexcept -> bool {
+    return elems_ == y.elems_;
+  }
+
+  auto operator!=(const amplifier_chain& y) const noexcept -> bool {
+    return !(*this == y);
+  }
 
   auto operator|=(const amplifier& y) -> amplifier_chain& {
     elems_.emplace_back(y);
@@ -89,23 +212,192 @@ class amplifier_chain {
   }
 
   private:
+  template<std::size_t> friend class fixed_amplifier_chain;
+  friend class checkpoint_reader;
+
+  static auto make_cfg_(const int_computer_state& program) -> std::shared_ptr<const control_flow_graph>;
+  template<typename Chain>
+  static auto feedback_eval_(Chain& c, value_type& v, std::uint64_t max_rounds) -> bool;
+  template<typename Chain>
+  static auto feedback_state_fingerprint_(const Chain& c, value_type v) noexcept -> std::size_t;
+  template<typename Chain>
+  static auto confirm_feedback_loop_(Chain& c, value_type& v, std::size_t period) -> bool;
+
   std::vector<amplifier> elems_;
 };
 
 
-auto operator|(amplifier&& x, amplifier&& y) -> amplifier_chain {
+///\brief Chain of exactly \p N amplifiers.
+///\details
+///Amplifiers are held in a std::array, and running the chain is unrolled at
+///compile time, instead of looping over a vector.
+template<std::size_t N>
+class fixed_amplifier_chain {
+  public:
+  using value_type = amplifier::value_type;
+
+  fixed_amplifier_chain() = default;
+
+  ///\throws std::invalid_argument if there are not exactly \p N phase settings.
+  template<typename Iter>
+  fixed_amplifier_chain(Iter phase_settings_begin, Iter phase_settings_end, const int_computer_state& program) {
+    if (std::distance(phase_settings_begin, phase_settings_end) != std::ptrdiff_t(N))
+      throw std::invalid_argument("phase setting count doesn't match chain length");
+
+    const auto cfg = amplifier_chain::make_cfg_(program);
+    for (auto& amp : elems_) amp = amplifier(program, *phase_settings_begin++, cfg);
+  }
+
+  ///\brief Copy the amplifiers of \p c.
+  ///\throws std::invalid_argument if \p c doesn't have exactly \p N amplifiers.
+  explicit fixed_amplifier_chain(const amplifier_chain& c)
+  : fixed_amplifier_chain(check_size_(c), std::make_index_sequence<N>())
+  {}
+
+  ///\brief Replace the amplifiers by fresh amplifiers of \p cache's program,
+  ///with the given phase settings.
+  ///\details The memory of the current amplifiers is reused.
+  ///\throws std::invalid_argument if there are not exactly \p N phase settings.
+  template<typename Iter>
+  void reset(Iter phase_settings_begin, Iter phase_settings_end, phase_cache& cache) {
+    if (std::distance(phase_settings_begin, phase_settings_end) != std::ptrdiff_t(N))
+      throw std::invalid_argument("phase setting count doesn't match chain length");
+    for (auto& amp : elems_) amp = cache.get(*phase_settings_begin++);
+  }
+
+  static constexpr auto size() noexcept -> std::size_t { return N; }
+  auto operator[](std::size_t idx) const -> const amplifier& { return elems_[idx]; }
+
+  auto is_halt() const -> bool {
+    return is_halt_(std::make_index_sequence<N>());
+  }
+
+  auto operator()(value_type v) -> value_type {
+    return apply_(v, std::make_index_sequence<N>());
+  }
+
+  ///\brief Feed the output back into the chain, until all amplifiers halt.
+  ///\throws feedback_loop_error if the chain enters a cycle.
+  auto feedback_eval(value_type v) -> value_type {
+    amplifier_chain::feedback_eval_(*this, v, std::numeric_limits<std::uint64_t>::max());
+    return v;
+  }
+
+  ///\copydoc amplifier_chain::feedback_rounds
+  auto feedback_rounds(value_type& v, std::uint64_t max_rounds) -> bool {
+    return amplifier_chain::feedback_eval_(*this, v, max_rounds);
+  }
+
+  ///\brief Combined fingerprint of all amplifiers.
+  ///\details Same as the fingerprint of an amplifier_chain holding the same amplifiers.
+  auto fingerprint() const noexcept -> std::size_t {
+    std::size_t h = N;
+    for (const auto& amp : elems_)
+      h ^= amp.fingerprint() + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+  }
+
+  auto operator==(const fixed_amplifier_chain& y) const noexcept -> bool {
+    return elems_ == y.elems_;
+  }
+
+  auto operator!=(const fixed_amplifier_chain& y) const noexcept -> bool {
+    return !(*this == y);
+  }
+
+  private:
+  template<std::size_t... I>
+  fixed_amplifier_chain(const amplifier_chain& c, std::index_sequence<I...>)
+  : elems_{{ c[I]... }}
+  {}
+
+  static auto check_size_(const amplifier_chain& c) -> const amplifier_chain& {
+    if (c.size() != N) throw std::invalid_argument("amplifier chain length doesn't match");
+    return c;
+  }
+
+  template<std::size_t... I>
+  auto is_halt_(std::index_sequence<I...>) const -> bool {
+    return (std::get<I>(elems_).is_halt() && ...);
+  }
+
+  template<std::size_t... I>
+  auto apply_(value_type v, std::index_sequence<I...>) -> value_type {
+    ((v = std::get<I>(elems_)(v)), ...);
+    return v;
+  }
+
+  std::array<amplifier, N> elems_;
+};
+
+
+template<typename Chain>
+auto amplifier_chain::feedback_eval_(Chain& c, value_type& v, std::uint64_t max_rounds) -> bool {
+  // Brent's cycle detection, on fingerprints.
+  // A fingerprint match is only a suspicion, which is confirmed
+  // by comparing full states (see confirm_feedback_loop_).
+  std::size_t saved = feedback_state_fingerprint_(c, v);
+  std::size_t power = 1, lambda = 0;
+
+  for (std::uint64_t round = 0; round < max_rounds; ++round) {
+    v = c(v);
+    telemetry::add(telemetry::counter::feedback_rounds);
+    if (c.is_halt()) return true;
+    ++lambda;
+
+    const std::size_t current = feedback_state_fingerprint_(c, v);
+    if (current == saved) {
+      if (confirm_feedback_loop_(c, v, lambda)) throw feedback_loop_error(lambda);
+      if (c.is_halt()) return true;
+      saved = feedback_state_fingerprint_(c, v);
+      power = 1;
+      lambda = 0;
+    } else if (lambda == power) {
+      saved = current;
+      power *= 2u;
+      lambda = 0;
+    }
+  }
+  return false;
+}
+
+template<typename Chain>
+auto amplifier_chain::feedback_state_fingerprint_(const Chain& c, value_type v) noexcept -> std::size_t {
+  return c.fingerprint() ^ (std::hash<value_type>()(v) * 0x9e3779b97f4a7c15ull);
+}
+
+///\brief Confirm that the feedback loop repeats every \p period rounds.
+///\details
+///Runs the chain for \p period rounds from a snapshot of the current state,
+///and compares the outcome against the snapshot.
+///\return True if the state repeats.
+///If false, \p v and the chain hold the state after the confirmation rounds.
+template<typename Chain>
+auto amplifier_chain::confirm_feedback_loop_(Chain& c, value_type& v, std::size_t period) -> bool {
+  const Chain snapshot = c;
+  const value_type snapshot_v = v;
+
+  for (std::size_t i = 0; i < period; ++i) {
+    v = c(v);
+    if (c.is_halt()) return false;
+  }
+  return v == snapshot_v && c == snapshot;
+}
+
+
+inline auto operator|(amplifier&& x, amplifier&& y) -> amplifier_chain {
   return amplifier_chain() | std::move(x) | std::move(y);
 }
 
-auto operator|(const amplifier& x, amplifier&& y) -> amplifier_chain {
+inline auto operator|(const amplifier& x, amplifier&& y) -> amplifier_chain {
   return amplifier_chain() | x | std::move(y);
 }
 
-auto operator|(amplifier&& x, const amplifier& y) -> amplifier_chain {
+inline auto operator|(amplifier&& x, const amplifier& y) -> amplifier_chain {
   return amplifier_chain() | std::move(x) | y;
 }
 
-auto operator|(const amplifier& x, const amplifier& y) -> amplifier_chain {
+inline auto operator|(const amplifier& x, const amplifier& y) -> amplifier_chain {
   return amplifier_chain() | x | y;
 }
 
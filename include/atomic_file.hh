@@ -0,0 +1,18 @@
+#ifndef ATOMIC_FILE_HH
+#define ATOMIC_FILE_HH
+
+#include <string>
+#include <string_view>
+
+
+///\brief Replace \p path with a file holding \p bytes.
+///\details
+///The bytes are written to a temporary file next to \p path, which is then
+///renamed over it, so readers see either the old or the new file, never a
+///partial one. The temporary is hidden (its name starts with a dot) and
+///unique per process and call, so concurrent writers don't share it.
+///\throws std::system_error if the file can't be written; the temporary is removed.
+void atomic_replace_file(const std::string& path, std::string_view bytes);
+
+
+#endif /* ATOMIC_FILE_HH */
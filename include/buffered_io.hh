@@ -0,0 +1,48 @@
+#ifndef BUFFERED_IO_HH
+#define BUFFERED_IO_HH
+
+#include <int_computer.hh>
+#include <cstddef>
+#include <memory>
+
+
+///\brief Fast text I/O for an int_computer_state, on a pair of file descriptors.
+///\details
+///Input is read in large blocks and scanned for integers, separated by white
+///space or commas. Output is formatted with std::to_chars into a buffer, one
+///value per line. The output buffer is flushed when it is full, before
+///blocking on input (so interactive use works), and on flush().
+///
+///This replaces the std::cin/std::cout lambdas drivers used to install.
+class buffered_io {
+  public:
+  using value_type = int_computer_state::value_type;
+
+  explicit buffered_io(int in_fd = 0, int out_fd = 1, std::size_t buffer_size = 64 * 1024);
+  buffered_io(const buffered_io&) = delete;
+  buffered_io& operator=(const buffered_io&) = delete;
+  ///\brief Flushes any buffered output, ignoring errors.
+  ~buffered_io();
+
+  ///\brief Read the next integer.
+  ///\throws io_error on end of input, or if the input is not an integer.
+  auto read() -> value_type;
+  void write(value_type v);
+  void flush();
+
+  ///\brief Install read_cb and write_cb on \p m, that use this adapter.
+  ///\details The adapter must outlive evaluation of \p m.
+  void attach(int_computer_state& m);
+
+  private:
+  auto fill_() -> bool;
+
+  int in_fd_, out_fd_;
+  std::size_t buffer_size_;
+  std::unique_ptr<char[]> in_buf_, out_buf_;
+  std::size_t in_pos_ = 0, in_end_ = 0, out_end_ = 0;
+  bool in_eof_ = false;
+};
+
+
+#endif /* BUFFERED_IO_HH */
@@ -0,0 +1,85 @@
+#ifndef CHAIN_POOL_HH
+#define CHAIN_POOL_HH
+
+#include <amplifier.hh>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+///\brief Keeps amplifier chains of a single program, for reuse by search workers.
+///\details
+///A worker acquires a chain, which is reset in place to the requested phase
+///settings, and the chain returns to the pool when the lease is destroyed.
+///Once every worker has had a chain and every phase setting has been seen,
+///acquiring and resetting chains doesn't allocate.
+///
+///The pool must outlive its leases.
+///\tparam Chain amplifier_chain or fixed_amplifier_chain<N>.
+template<typename Chain = amplifier_chain>
+class chain_pool {
+  public:
+  class releaser {
+    public:
+    releaser() = default;
+    explicit releaser(chain_pool* pool) noexcept : pool_(pool) {}
+
+    void operator()(Chain* c) const noexcept { pool_->release_(c); }
+
+    private:
+    chain_pool* pool_ = nullptr;
+  };
+  using lease = std::unique_ptr<Chain, releaser>;
+
+  explicit chain_pool(int_computer_state program)
+  : cache_(std::move(program))
+  {}
+
+  chain_pool(const chain_pool&) = delete;
+  chain_pool& operator=(const chain_pool&) = delete;
+
+  ///\brief Get a chain, with fresh amplifiers with the given phase settings.
+  template<typename Iter>
+  auto acquire(Iter phase_settings_begin, Iter phase_settings_end) -> lease {
+    std::unique_ptr<Chain> c;
+    {
+      std::lock_guard<std::mutex> lck{ mtx_ };
+      if (!idle_.empty()) {
+        c = std::move(idle_.back());
+        idle_.pop_back();
+      }
+    }
+    if (c == nullptr) c = std::make_unique<Chain>();
+
+    c->reset(phase_settings_begin, phase_settings_end, cache_);
+    return lease(c.release(), releaser(this));
+  }
+
+  auto cache() noexcept -> phase_cache& { return cache_; }
+
+  ///\brief Number of chains waiting in the pool.
+  auto idle() const -> std::size_t {
+    std::lock_guard<std::mutex> lck{ mtx_ };
+    return idle_.size();
+  }
+
+  private:
+  void release_(Chain* c) noexcept {
+    std::unique_ptr<Chain> owned(c);
+    std::lock_guard<std::mutex> lck{ mtx_ };
+    try {
+      idle_.push_back(std::move(owned));
+    } catch (...) {
+      // Drop the chain.
+    }
+  }
+
+  phase_cache cache_;
+  mutable std::mutex mtx_;
+  std::vector<std::unique_ptr<Chain>> idle_;
+};
+
+
+#endif /* CHAIN_POOL_HH */
@@ -0,0 +1,123 @@
+#ifndef CHECKPOINT_HH
+#define CHECKPOINT_HH
+
+#include <amplifier.hh>
+#include <int_computer.hh>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <signal.h>
+
+
+///\brief Raised when a checkpoint file can't be read.
+class checkpoint_error
+: public std::runtime_error
+{
+  public:
+  using std::runtime_error::runtime_error;
+
+  ~checkpoint_error();
+};
+
+
+///\brief Builds a checkpoint file.
+///\details
+///A checkpoint is a sequence of tagged items, which a checkpoint_reader
+///reads back in the same order. Integers are stored as zigzag varints, so
+///machine memory (mostly small numbers) takes a byte or two per cell.
+///The file ends in a checksum, and is written to a temporary file that is
+///renamed into place, so a crash while saving leaves the previous checkpoint.
+class checkpoint_writer {
+  public:
+  using value_type = int_computer_state::value_type;
+
+  checkpoint_writer();
+
+  void write(std::uint64_t v);
+  void write_value(value_type v);
+  void write(const std::vector<value_type>& v);
+  ///\brief Write the memory and program counter of \p s.
+  ///\details A machine waiting for I/O is stopped at its I/O instruction,
+  ///so the program counter includes the pending I/O.
+  void write(const int_computer_state& s);
+  void write(const amplifier& a);
+  void write(const amplifier_chain& c);
+
+  template<std::size_t N>
+  void write(const fixed_amplifier_chain<N>& c) {
+    begin_chain_(N);
+    for (std::size_t i = 0; i < N; ++i) write(c[i]);
+  }
+
+  ///\brief Atomically replace \p filename with the checkpoint.
+  void commit(const std::string& filename) const;
+
+  private:
+  void begin_chain_(std::size_t n);
+  void tag_(char t) { buf_ += t; }
+  void varint_(std::uint64_t v);
+
+  std::string buf_;
+};
+
+
+///\brief Reads a checkpoint file written by checkpoint_writer.
+///\details Items must be read in the order they were written.
+///\throws checkpoint_error on a damaged file, or if the next item has a different type.
+class checkpoint_reader {
+  public:
+  using value_type = int_computer_state::value_type;
+
+  explicit checkpoint_reader(const std::string& filename);
+
+  auto read_u64() -> std::uint64_t;
+  auto read_value() -> value_type;
+  auto read_values() -> std::vector<value_type>;
+  auto read_state() -> int_computer_state;
+  auto read_amplifier() -> amplifier;
+  ///\brief Read an amplifier chain of \p program.
+  ///\details \p program is used to rebuild the control flow graph shared by the amplifiers.
+  auto read_chain(const int_computer_state& program) -> amplifier_chain;
+  auto at_end() const noexcept -> bool { return pos_ == data_.size(); }
+
+  private:
+  void expect_(char t);
+  auto varint_() -> std::uint64_t;
+  auto read_state_() -> int_computer_state;
+
+  std::string data_;
+  std::size_t pos_ = 0;
+};
+
+
+///\brief Decides when a long computation saves a checkpoint.
+///\details
+///A checkpoint is due every \p interval, and when the process receives SIGUSR1.
+///SIGINT and SIGTERM make a checkpoint due and request a stop, so the
+///computation can save its progress and exit.
+///The previous signal handlers are restored on destruction.
+///Only one trigger can exist at a time.
+class checkpoint_trigger {
+  public:
+  explicit checkpoint_trigger(std::chrono::steady_clock::duration interval);
+  checkpoint_trigger(const checkpoint_trigger&) = delete;
+  checkpoint_trigger& operator=(const checkpoint_trigger&) = delete;
+  ~checkpoint_trigger();
+
+  ///\brief True if a checkpoint should be saved now.
+  ///\details Resets the interval and the signal.
+  auto due() noexcept -> bool;
+  ///\brief True if SIGINT or SIGTERM was received.
+  auto stop_requested() const noexcept -> bool;
+
+  private:
+  std::chrono::steady_clock::duration interval_;
+  std::chrono::steady_clock::time_point next_;
+  struct sigaction old_usr1_, old_int_, old_term_;
+};
+
+
+#endif /* CHECKPOINT_HH */
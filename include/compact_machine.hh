@@ -0,0 +1,143 @@
+#ifndef COMPACT_MACHINE_HH
+#define COMPACT_MACHINE_HH
+
+#include <int_computer.hh>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+///\brief Intcode machine with a small memory footprint.
+///\details
+///Memory is split in pages of \ref page_size cells.
+///Pages start out shared with an immutable program image, and are copied on
+///their first store, so a machine only owns the pages its program wrote to.
+///A machine that didn't store anything owns no memory at all; the page table
+///is allocated on the first store.
+///
+///The machine has no I/O callbacks. Evaluation stops at every read or write,
+///which the caller completes with read() or write(), or which run() completes
+///from input and output containers held by reference.
+class compact_machine {
+  public:
+  using value_type = int_computer_state::value_type;
+  using size_type = std::uint32_t;
+  using io_pending = int_computer_state::io_pending;
+  using image_type = std::vector<value_type>;
+
+  static constexpr size_type page_size = 32;
+
+  ///\brief Bytes used by a machine.
+  struct memory_report {
+    ///\brief Total bytes this machine accounts for (object, page table and owned pages).
+    auto total() const noexcept -> std::size_t { return object + page_table + pages; }
+
+    std::size_t object = 0; ///< Size of the machine object itself.
+    std::size_t page_table = 0; ///< Page table, allocated on the first store.
+    std::size_t pages = 0; ///< Pages copied from the image.
+    std::size_t owned_pages = 0; ///< Number of pages copied from the image.
+    std::size_t shared_image = 0; ///< Size of the shared image; not included in total().
+  };
+
+  compact_machine() = default;
+  ///\brief Create a machine running \p image.
+  ///\details The image is shared with all copies of the machine.
+  explicit compact_machine(std::shared_ptr<const image_type> image, size_type pc = 0);
+  ///\brief Create a machine with the memory and program counter of \p s.
+  explicit compact_machine(const int_computer_state& s);
+  compact_machine(const compact_machine& y);
+  compact_machine(compact_machine&&) noexcept = default;
+  compact_machine& operator=(const compact_machine& y);
+  compact_machine& operator=(compact_machine&&) noexcept = default;
+  ~compact_machine() noexcept = default;
+
+  ///\brief Create a shareable image of the memory of \p s.
+  static auto make_image(const int_computer_state& s) -> std::shared_ptr<const image_type>;
+
+  auto size() const noexcept -> size_type { return image_ ? size_type(image_->size()) : 0u; }
+  auto empty() const noexcept -> bool { return size() == 0u; }
+  auto pc() const noexcept -> size_type { return pc_; }
+  auto image() const noexcept -> const std::shared_ptr<const image_type>& { return image_; }
+
+  ///\brief Read memory cell \p idx.
+  ///\throws std::out_of_range if \p idx is not a valid address.
+  auto operator[](size_type idx) const -> value_type {
+    if (idx >= size()) throw std::out_of_range("address out of range");
+    return load_(idx);
+  }
+  ///\brief Write memory cell \p idx.
+  ///\throws std::out_of_range if \p idx is not a valid address.
+  void store(size_type idx, value_type v);
+
+  auto is_halt() const -> bool;
+
+  ///\brief Evaluate until the next read, write or halt instruction.
+  ///\details The read or write instruction is not executed.
+  auto eval_until_io_or_halt() -> io_pending;
+  auto eval_until_io_or_halt(eval_budget& budget) -> io_pending;
+
+  ///\brief Complete a pending read instruction, with value \p v.
+  ///\throws io_error if the machine is not at a read instruction.
+  void read(value_type v);
+  ///\brief Complete a pending write instruction.
+  ///\return The written value.
+  ///\throws io_error if the machine is not at a write instruction.
+  auto write() -> value_type;
+
+  ///\brief Evaluate, taking input from \p in and appending output to \p out.
+  ///\details
+  ///\p In must have empty(), front() and pop_front(), and \p Out must have push_back().
+  ///Both are only referenced for the duration of the call.
+  ///\return io_pending::halt, or io_pending::read if \p in ran out of values.
+  template<typename In, typename Out>
+  auto run(In& in, Out& out) -> io_pending {
+    for (;;) {
+      switch (eval_until_io_or_halt()) {
+        case io_pending::read:
+          if (in.empty()) return io_pending::read;
+          read(in.front());
+          in.pop_front();
+          break;
+        case io_pending::write:
+          out.push_back(write());
+          break;
+        default:
+          return io_pending::halt;
+      }
+    }
+  }
+
+  ///\brief Convert back to an int_computer_state.
+  auto to_state() const -> int_computer_state;
+
+  auto memory_usage() const noexcept -> memory_report;
+
+  auto operator==(const compact_machine& y) const noexcept -> bool;
+  auto operator!=(const compact_machine& y) const noexcept -> bool { return !(*this == y); }
+
+  private:
+  struct page {
+    value_type data[page_size];
+  };
+  using page_table = std::unique_ptr<std::unique_ptr<page>[]>;
+
+  auto page_count_() const noexcept -> size_type { return (size() + page_size - 1u) / page_size; }
+  auto owned_page_(size_type idx) const noexcept -> const page* {
+    return pages_ ? pages_[idx / page_size].get() : nullptr;
+  }
+  auto load_(size_type idx) const noexcept -> value_type {
+    const page* p = owned_page_(idx);
+    return p != nullptr ? p->data[idx % page_size] : (*image_)[idx];
+  }
+  auto load_checked_(value_type idx) const -> value_type;
+  void store_checked_(value_type idx, value_type v);
+  auto step_() -> bool;
+
+  std::shared_ptr<const image_type> image_;
+  page_table pages_;
+  size_type pc_ = 0;
+};
+
+
+#endif /* COMPACT_MACHINE_HH */
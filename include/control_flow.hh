@@ -0,0 +1,122 @@
+#ifndef CONTROL_FLOW_HH
+#define CONTROL_FLOW_HH
+
+#include <int_computer.hh>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+///\brief Basic block analysis of a program.
+///\details
+///Blocks are discovered by following static control flow from the start
+///of the program.
+///Computed jumps usually go through a table of addresses in data,
+///so address-like values in words that are not instructions are tried
+///as entry points too.
+///
+///A block ends at a jump, I/O instruction, halt, or at an instruction
+///that cannot be decoded (and must be left to the interpreter).
+///Every block holds at least one instruction.
+class control_flow_graph {
+  public:
+  using size_type = int_computer_state::size_type;
+  using value_type = int_computer_state::value_type;
+
+  struct operand {
+    addressing_mode mode;
+    value_type value;
+  };
+
+  struct decoded_instruction {
+    size_type pc;
+    opcode op;
+    std::uint8_t arg_count;
+    std::array<operand, 3> args;
+
+    auto next() const noexcept -> size_type { return pc + 1u + arg_count; }
+    ///\brief The operand an instruction stores to.
+    auto output() const noexcept -> const operand& { return args[arg_count - 1u]; }
+  };
+
+  enum class terminator {
+    fallthrough, ///< Next instruction is the entry of another block.
+    jump,
+    io,
+    halt,
+    undecodable ///< Instruction at \ref basic_block::end must be interpreted.
+  };
+
+  struct basic_block {
+    size_type begin, end; ///< Instruction words covered by the block.
+    std::vector<decoded_instruction> instrs;
+    terminator kind;
+    std::vector<size_type> successors; ///< Statically known successor blocks.
+    bool computed_jump = false; ///< Jump target is read from memory.
+  };
+
+  ///\brief A natural loop.
+  struct loop {
+    size_type header; ///< Entry of the loop header block.
+    std::vector<size_type> blocks; ///< Entries of all blocks in the loop, including the header.
+  };
+
+  control_flow_graph() = default;
+  explicit control_flow_graph(const int_computer_state& program);
+
+  ///\brief Decode the instruction at \p pc.
+  ///\return The decoded instruction, or an empty optional if executing the
+  ///instruction would raise an error.
+  static auto decode(const int_computer_state& program, size_type pc) -> std::optional<decoded_instruction>;
+
+  static auto stores(opcode op) noexcept -> bool;
+
+  auto blocks() const noexcept -> const std::vector<basic_block>& { return blocks_; }
+  auto program_size() const noexcept -> size_type { return image_.size(); }
+
+  ///\brief Index of the block starting at \p pc.
+  ///\return Index into \ref blocks(), or an empty optional if no block starts at \p pc.
+  auto block_index(size_type pc) const noexcept -> std::optional<std::size_t> {
+    if (pc >= block_at_.size() || block_at_[pc] == 0u) return {};
+    return block_at_[pc] - 1u;
+  }
+
+  ///\brief Block starting at \p pc, or null.
+  auto find(size_type pc) const noexcept -> const basic_block* {
+    const auto idx = block_index(pc);
+    return idx ? &blocks_[*idx] : nullptr;
+  }
+
+  ///\brief True if \p addr is part of an instruction in any block.
+  auto is_code(size_type addr) const noexcept -> bool {
+    return addr < code_.size() && code_[addr];
+  }
+
+  ///\brief True if the instruction words of \p b in \p s match the analysed program.
+  auto matches(const basic_block& b, const int_computer_state& s) const noexcept -> bool;
+  ///\brief True if the instruction words of all blocks in \p s match the analysed program.
+  auto matches(const int_computer_state& s) const noexcept -> bool;
+
+  ///\brief All natural loops, found through back edges of a depth first search.
+  auto loops() const -> std::vector<loop>;
+
+  ///\brief Write the graph in graphviz dot format.
+  ///\param[in] block_counts If not empty, execution counts per block index,
+  ///which are used to label and highlight the blocks.
+  void write_dot(std::ostream& out, const std::vector<std::uint64_t>& block_counts = {}) const;
+
+  private:
+  void find_leaders_(std::vector<bool>& leaders, std::vector<size_type> todo) const;
+
+  std::vector<value_type> image_;
+  std::vector<basic_block> blocks_;
+  std::vector<std::uint32_t> block_at_; ///< 1 + block index, or 0.
+  std::vector<bool> code_;
+};
+
+
+#endif /* CONTROL_FLOW_HH */
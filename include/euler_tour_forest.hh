@@ -0,0 +1,86 @@
+#ifndef EULER_TOUR_FOREST_HH
+#define EULER_TOUR_FOREST_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+///\brief Forest of rooted trees, with O(log n) link, cut, depth and subtree size.
+///\details
+///Each tree is stored as its Euler tour (an enter and an exit token per vertex),
+///in a treap keyed by position in the tour.
+///The enter token counts +1 and the exit token -1, so the depth of a vertex is
+///the prefix sum of the tour up to its enter token, minus one.
+///
+///The sum of the depths of all vertices is maintained on every link and cut.
+class euler_tour_forest {
+  public:
+  using vertex = std::uint32_t;
+  using size_type = std::size_t;
+
+  static constexpr vertex npos = std::numeric_limits<vertex>::max();
+
+  ///\brief Add a vertex, as a tree of its own.
+  auto add_vertex() -> vertex;
+  ///\brief Remove a vertex that has no parent and no children.
+  void remove_vertex(vertex v);
+
+  ///\brief Make \p child a child of \p parent.
+  ///\pre \p child has no parent.
+  ///\throws std::invalid_argument if \p parent is a descendant of \p child.
+  void link(vertex child, vertex parent);
+  ///\brief Detach \p child (and its subtree) from its parent.
+  void cut(vertex child);
+
+  ///\brief Build the forest from a parent array.
+  ///\details Runs in linear time.
+  ///\throws std::invalid_argument if the parent array contains a cycle.
+  void assign(const std::vector<vertex>& parents);
+
+  auto parent(vertex v) const -> vertex { return parent_.at(v); }
+  ///\brief Number of ancestors of \p v.
+  auto depth(vertex v) const -> size_type;
+  ///\brief Number of vertices in the subtree rooted at \p v, including \p v.
+  auto subtree_size(vertex v) const -> size_type;
+  auto connected(vertex x, vertex y) const -> bool;
+
+  ///\brief Sum of the depths of all vertices.
+  auto total_depth() const noexcept -> size_type { return total_depth_; }
+
+  private:
+  using node_id = std::uint32_t;
+  static constexpr node_id nil = std::numeric_limits<node_id>::max();
+
+  struct node {
+    node_id left = nil, right = nil, up = nil;
+    std::uint32_t priority = 0;
+    std::uint32_t size = 1; ///< Number of tokens in the subtree.
+    std::int32_t sum = 0; ///< Sum of token values in the subtree.
+    std::int8_t value = 0; ///< +1 for enter, -1 for exit.
+  };
+
+  static auto enter_(vertex v) noexcept -> node_id { return 2u * v; }
+  static auto exit_(vertex v) noexcept -> node_id { return 2u * v + 1u; }
+
+  auto size_(node_id n) const noexcept -> std::uint32_t { return n == nil ? 0u : nodes_[n].size; }
+  auto sum_(node_id n) const noexcept -> std::int32_t { return n == nil ? 0 : nodes_[n].sum; }
+  void update_(node_id n) noexcept;
+  auto root_(node_id n) const noexcept -> node_id;
+  auto position_(node_id n) const noexcept -> size_type;
+  auto prefix_sum_(node_id n) const noexcept -> std::int64_t;
+  void split_(node_id t, size_type k, node_id& l, node_id& r);
+  auto merge_(node_id l, node_id r) -> node_id;
+  auto build_(const std::vector<node_id>& tour) -> node_id;
+  auto next_priority_() noexcept -> std::uint32_t;
+
+  std::vector<node> nodes_;
+  std::vector<vertex> parent_;
+  std::vector<vertex> free_;
+  size_type total_depth_ = 0;
+  std::uint64_t rng_ = 0x9e3779b97f4a7c15ull;
+};
+
+
+#endif /* EULER_TOUR_FOREST_HH */
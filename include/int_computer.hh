@@ -1,13 +1,18 @@
 #ifndef INT_COMPUTER_HH
 #define INT_COMPUTER_HH
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iosfwd>
+#include <limits>
 #include <stdexcept>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 
@@ -72,6 +77,9 @@ auto operator<<(std::basic_ostream<CharT, Traits>& out, addressing_mode m) -> st
 }
 
 class int_computer_state;
+class trace_recorder;
+class control_flow_graph;
+class ir_tier;
 
 
 class instruction {
@@ -91,13 +99,115 @@ class instruction {
   eval_fn eval;
 };
 
+///\brief Limits how long an evaluation may run.
+///\details
+///A budget holds a step count and a deadline. The interpreter takes one step
+///per instruction; the hot path is a single decrement and compare, and the
+///clock is only read once every \ref check_interval steps.
+///
+///A budget is consumed as evaluation proceeds, so the same budget can be
+///passed to consecutive calls, and shared by several machines.
+class eval_budget {
+  public:
+  using clock = std::chrono::steady_clock;
+
+  ///\brief Number of steps between deadline checks.
+  static constexpr std::uint64_t check_interval = 4096;
+
+  ///\brief Unlimited budget.
+  eval_budget() = default;
+
+  static auto steps(std::uint64_t n) -> eval_budget {
+    eval_budget b;
+    b.remaining_ = n;
+    return b;
+  }
+
+  static auto time(clock::duration d) -> eval_budget {
+    return deadline(clock::now() + d);
+  }
+
+  static auto deadline(clock::time_point t) -> eval_budget {
+    eval_budget b;
+    b.deadline_ = t;
+    return b;
+  }
+
+  ///\brief Also limit the step count.
+  auto with_steps(std::uint64_t n) && -> eval_budget&& {
+    remaining_ = n;
+    fuel_ = 0;
+    return std::move(*this);
+  }
+
+  ///\brief Also limit the wall clock time.
+  auto with_deadline(clock::time_point t) && -> eval_budget&& {
+    deadline_ = t;
+    return std::move(*this);
+  }
+
+  ///\brief Take \p n steps.
+  ///\return False, without taking any steps, if the budget doesn't allow them.
+  ///\details A step count that is too small for \p n steps still allows
+  ///fewer steps; the budget is only \ref exhausted once no step is left.
+  auto step(std::uint64_t n = 1) noexcept -> bool {
+    if (fuel_ >= n) {
+      fuel_ -= n;
+      return true;
+    }
+    return refuel_(n);
+  }
+
+  ///\brief Give back \p n steps that were taken, but not used.
+  void refund(std::uint64_t n) noexcept { fuel_ += n; }
+
+  auto steps_left() const noexcept -> std::uint64_t {
+    return remaining_ == unlimited ? unlimited : remaining_ + fuel_;
+  }
+
+  auto exhausted() const noexcept -> bool { return exhausted_; }
+
+  private:
+  static constexpr std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
+
+  auto refuel_(std::uint64_t n) noexcept -> bool {
+    if (exhausted_) return false;
+    if (deadline_ != clock::time_point::max() && clock::now() >= deadline_) {
+      exhausted_ = true;
+      return false;
+    }
+
+    if (remaining_ != unlimited) {
+      remaining_ += fuel_;
+      fuel_ = 0;
+      if (remaining_ < n) {
+        if (remaining_ == 0u) exhausted_ = true;
+        return false;
+      }
+    }
+
+    const std::uint64_t refill = std::max(n, check_interval);
+    fuel_ = std::min(remaining_, refill);
+    if (remaining_ != unlimited) remaining_ -= fuel_;
+    fuel_ -= n;
+    return true;
+  }
+
+  std::uint64_t remaining_ = unlimited; ///< Steps not yet handed out as fuel.
+  std::uint64_t fuel_ = 0; ///< Steps until the next deadline check.
+  clock::time_point deadline_ = clock::time_point::max();
+  bool exhausted_ = false;
+};
+
 
 class int_computer_state {
   public:
   enum class io_pending {
     halt,
     read,
-    write
+    write,
+    ///\brief The eval_budget ran out; evaluation can be resumed where it stopped.
+    budget_exhausted
   };
 
   using opcode_type = std::underlying_type_t<opcode>;
@@ -114,21 +224,25 @@ class int_computer_state {
   int_computer_state() = default;
 
   int_computer_state(std::initializer_list<value_type> init, size_type pc = 0)
-  : opcodes_(init),
-    pc_(pc)
-  {}
+  : pc_(pc),
+    opcodes_(init)
+  {
+    rehash_();
+  }
 
   template<typename Iter>
   int_computer_state(Iter b, Iter e)
   : opcodes_(b, e)
-  {}
+  {
+    rehash_();
+  }
 
   static auto parse(std::istream& in) -> int_computer_state;
 
   auto size() const noexcept -> size_type { return opcodes_.size(); }
   auto empty() const noexcept -> bool { return opcodes_.empty(); }
-  auto begin() -> iterator { return opcodes_.begin(); }
-  auto end() -> iterator { return opcodes_.end(); }
+  auto begin() -> iterator { invalidate_hash_(); return opcodes_.begin(); }
+  auto end() -> iterator { invalidate_hash_(); return opcodes_.end(); }
   auto begin() const -> const_iterator { return opcodes_.begin(); }
   auto end() const -> const_iterator { return opcodes_.end(); }
   auto cbegin() const -> const_iterator { return opcodes_.cbegin(); }
@@ -136,6 +250,7 @@ class int_computer_state {
 
   auto operator[](size_type idx) -> value_type& {
     assert(idx < size());
+    invalidate_hash_();
     return opcodes_[idx];
   }
 
@@ -144,6 +259,12 @@ class int_computer_state {
     return opcodes_[idx];
   }
 
+  ///\brief Program counter.
+  auto pc() const noexcept -> size_type { return pc_; }
+
+  ///\brief Continue execution at \p new_pc.
+  void jump(size_type new_pc) noexcept { pc_ = new_pc; }
+
   auto is_halt() const -> bool {
     if (empty()) throw bad_program_error("empty program");
     assert(pc_ < opcodes_.size());
@@ -152,16 +273,66 @@ class int_computer_state {
 
   auto eval_and_get() -> value_type;
   auto eval() -> int_computer_state&;
+  ///\brief Evaluate until halt, or until \p budget runs out.
+  ///\return io_pending::halt or io_pending::budget_exhausted.
+  auto eval(eval_budget& budget) -> io_pending;
   auto eval_until_io_or_halt() -> io_pending;
+  auto eval_until_io_or_halt(eval_budget& budget) -> io_pending;
+
+  ///\brief Block-at-a-time variant of eval_until_io_or_halt().
+  ///\details
+  ///Blocks of \p cfg are executed without checking for I/O or halt between
+  ///instructions. Code outside the blocks is executed one instruction at a time.
+  ///Once the program stores into its own code, blocks are only used if
+  ///their instruction words are unchanged.
+  ///\pre \p cfg was built from this program, and instruction words were
+  ///not modified other than by the program itself.
+  ///\param[in,out] block_counts If not null, counts executions per block index.
+  auto eval_until_io_or_halt(const control_flow_graph& cfg, std::vector<std::uint64_t>* block_counts = nullptr) -> io_pending;
+  ///\brief Make the block evaluator check blocks against memory before use.
+  ///\details Needed for a state whose code may differ from the program a
+  ///control flow graph was built from, for example one restored from a checkpoint.
+  void assume_code_modified() noexcept { code_modified_ = true; }
+  ///\brief Block-at-a-time evaluation, limited by \p budget.
+  ///\details A block is only entered if the budget allows all of its instructions.
+  ///As in eval1(), the budget is charged per executed instruction: a
+  ///terminating I/O or halt isn't charged, nor are instructions skipped
+  ///after a store into code.
+  auto eval_until_io_or_halt(const control_flow_graph& cfg, eval_budget& budget, std::vector<std::uint64_t>* block_counts = nullptr) -> io_pending;
   auto eval1() -> int_computer_state&;
 
   static auto instructions() -> const std::unordered_map<opcode, instruction>&;
+  ///\brief Running count of instructions executed by eval1(), the block evaluator, ir_tier and compact_machine on this thread.
+  ///\details Used by perf_counters to report cost per interpreted instruction.
+  ///Only differences are meaningful: with telemetry, this is the thread's
+  ///telemetry instruction counter, so each instruction is counted once.
+  static auto interpreted_instructions() noexcept -> std::uint64_t;
 
   static auto single_input_single_output(int_computer_state s, value_type in) -> value_type;
   static auto single_output(int_computer_state s, std::vector<value_type> in) -> value_type;
 
+  ///\brief Hash of the memory and program counter.
+  ///\details
+  ///The memory contribution is maintained incrementally as the program
+  ///stores values, so this is O(1) during evaluation.
+  ///Handing out mutable references (operator[], begin(), end()) makes this
+  ///O(n), until the next evaluation refreshes the memory contribution.
+  ///Const member functions never write, so a shared const state can be
+  ///hashed and compared from several threads.
+  auto fingerprint() const noexcept -> std::size_t;
+
+  ///\brief Bytes used by this state: the object itself and its memory.
+  ///\details Heap state held by \ref read_cb and \ref write_cb is not included.
+  auto memory_usage() const noexcept -> std::size_t {
+    return sizeof(*this) + opcodes_.capacity() * sizeof(value_type)
+        + args_.capacity() * sizeof(instruction::argument_type);
+  }
+
   auto operator==(const int_computer_state& y) const noexcept -> bool;
 
+  friend class ir_tier;
+  friend class compact_machine;
+
   template<typename CharT, typename Traits>
   friend auto operator<<(std::basic_ostream<CharT, Traits>& out, const int_computer_state& s) -> std::basic_ostream<CharT, Traits>& {
     bool precede_comma = false;
@@ -189,9 +360,24 @@ class int_computer_state {
   void instr_less_than(const std::vector<instruction::argument_type>& args);
   void instr_equals(const std::vector<instruction::argument_type>& args);
 
+  void trace_(size_type pc, value_type instr, const std::vector<instruction::argument_type>& args) const;
   auto get_(instruction::argument_type iarg) const -> value_type;
   void set_(instruction::argument_type iarg, value_type new_value);
 
+  static auto cell_hash_(size_type idx, value_type v) noexcept -> std::uint64_t;
+  static auto mix_(std::uint64_t x) noexcept -> std::uint64_t;
+  void invalidate_hash_() noexcept { mem_hash_valid_ = false; }
+  ///\brief Recompute the memory hash, if invalidated.
+  void rehash_() noexcept {
+    if (!mem_hash_valid_) {
+      mem_hash_ = memory_hash_();
+      mem_hash_valid_ = true;
+    }
+  }
+  auto memory_hash_() const noexcept -> std::uint64_t;
+  ///\brief Add \p n to \ref interpreted_instructions(), and to the telemetry instruction counter.
+  static void count_interpreted_(std::uint64_t n) noexcept;
+
   static constexpr auto as_opcode(value_type v) -> opcode {
     return opcode(v % 100);
   }
@@ -212,10 +398,19 @@ class int_computer_state {
 
   size_type pc_ = 0u;
   vector_type opcodes_;
+  std::uint64_t mem_hash_ = 0u;
+  bool mem_hash_valid_ = false;
+  ///\brief Set once the block evaluator sees a store into code.
+  ///\details Blocks are then checked against memory before use, also in later calls.
+  bool code_modified_ = false;
+  ///\brief Argument buffer of eval1().
+  std::vector<instruction::argument_type> args_;
 
   public:
   std::function<value_type()> read_cb;
   std::function<void(value_type)> write_cb;
+  ///\brief Optional recorder for executed instructions.
+  trace_recorder* tracer = nullptr;
 };
 
 
@@ -224,4 +419,16 @@ inline auto operator!=(const int_computer_state& x, const int_computer_state& y)
 }
 
 
+namespace std {
+
+template<>
+struct hash<int_computer_state> {
+  auto operator()(const int_computer_state& s) const noexcept -> std::size_t {
+    return s.fingerprint();
+  }
+};
+
+} /* namespace std */
+
+
 #endif /* INT_COMPUTER_HH */
@@ -0,0 +1,54 @@
+#ifndef INT_COMPUTER_PIPE_HH
+#define INT_COMPUTER_PIPE_HH
+
+#include <int_computer.hh>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <objpipe/callback.h>
+
+
+///\brief Objpipe of the outputs of \p m.
+///\details
+///The machine runs inside the callback coroutine: each pull resumes the
+///interpreter only until it writes its next value, so a program with
+///unbounded output can be consumed in bounded memory.
+///The read_cb of \p m is left as is; use feed_input() to drive it from a pipe.
+///
+///The machine is halted by running out of outputs to pull: if the consumer
+///stops pulling, evaluation is simply never resumed.
+inline auto output_pipe(int_computer_state m) {
+  using value_type = int_computer_state::value_type;
+
+  return objpipe::new_callback<value_type>(
+      [m = std::move(m)](auto&& cb) {
+        int_computer_state machine = m;
+        machine.write_cb = [&cb](value_type v) { cb(v); };
+        machine.eval();
+      });
+}
+
+///\brief Make \p m read its input from \p input.
+///\details
+///Each read pulls the next value from \p input.
+///\throws io_error (during evaluation) if the machine reads past the end of \p input.
+template<typename Pipe>
+void feed_input(int_computer_state& m, Pipe&& input) {
+  using value_type = int_computer_state::value_type;
+
+  m.read_cb =
+      [input = std::make_shared<std::decay_t<Pipe>>(std::forward<Pipe>(input))]() -> value_type {
+        if (input->empty()) throw io_error("input pipe is empty");
+        return input->pull();
+      };
+}
+
+///\brief Objpipe of the outputs of \p m, running with the values of \p input as its input.
+template<typename Pipe>
+auto output_pipe(int_computer_state m, Pipe&& input) {
+  feed_input(m, std::forward<Pipe>(input));
+  return output_pipe(std::move(m));
+}
+
+
+#endif /* INT_COMPUTER_PIPE_HH */
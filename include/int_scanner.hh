@@ -0,0 +1,50 @@
+#ifndef INT_SCANNER_HH
+#define INT_SCANNER_HH
+
+#include <int_computer.hh>
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+
+
+///\brief Outcome of \ref scan_int.
+enum class scan_status {
+  value, ///< A value was scanned.
+  need_more, ///< The buffer ends before a complete value; scan again with more input.
+  end ///< Only separators remain before the end of input.
+};
+
+inline auto is_int_separator(char c) noexcept -> bool {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v' || c == ',';
+}
+
+///\brief Scan the next integer in \p buf, starting at \p pos.
+///\details
+///The text input grammar of buffered_io and machine_event_loop: integers,
+///separated by white space or commas. Separators before the value are
+///consumed even if the value is not complete yet.
+///\param[in,out] pos Scan position in \p buf, advanced past the value.
+///\param eof True if no more input follows \p buf.
+///\throws io_error if the input is not an integer, or out of range.
+inline auto scan_int(std::string_view buf, std::size_t& pos, bool eof, int_computer_state::value_type& v) -> scan_status {
+  while (pos != buf.size() && is_int_separator(buf[pos])) ++pos;
+  if (pos == buf.size()) return eof ? scan_status::end : scan_status::need_more;
+
+  std::size_t token_end = pos;
+  while (token_end != buf.size() && ((buf[token_end] >= '0' && buf[token_end] <= '9') || buf[token_end] == '-'))
+    ++token_end;
+  if (token_end == buf.size() && !eof) return scan_status::need_more;
+
+  const char* const b = buf.data() + pos;
+  const char* const e = buf.data() + token_end;
+  const auto [ptr, ec] = std::from_chars(b, e, v);
+  if (ec == std::errc::result_out_of_range) throw io_error("input number out of range");
+  if (ec != std::errc() || ptr != e || (token_end != buf.size() && !is_int_separator(*e)))
+    throw io_error("invalid input");
+  pos = token_end;
+  return scan_status::value;
+}
+
+
+#endif /* INT_SCANNER_HH */
@@ -0,0 +1,84 @@
+#ifndef IR_TIER_HH
+#define IR_TIER_HH
+
+#include <int_computer.hh>
+#include <control_flow.hh>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+///\brief Optimising tier of the interpreter.
+///\details
+///Blocks that are entered \p hot_threshold times are lifted into a region:
+///a trace of instructions starting at the block, translated to a register
+///based intermediate representation in which every register is assigned once.
+///While building the trace:
+///- immediates are constants, and arithmetic on constants is folded;
+///- memory cells are promoted to registers: a cell is loaded on its first use,
+///  and stored once when the region exits, if its value changed
+///  (Intcode addresses are static, so no other instruction aliases a cell);
+///- jumps with a constant condition and target are threaded, so the trace
+///  continues at the target.
+///
+///A trace ends at I/O, halt, a jump that depends on memory, an instruction
+///that can't be decoded, or an instruction storing to code. These are left
+///to the interpreter, as is all code that isn't hot. A region whose exit
+///returns to its own entry loops without leaving the optimised code.
+///
+///Regions are guarded by the instruction words they were built from, and are
+///discarded (deoptimised) when the program modified them.
+///
+///A tier is not thread safe. It can be used by any machine running the
+///program it was created for.
+class ir_tier {
+  public:
+  using value_type = int_computer_state::value_type;
+  using size_type = int_computer_state::size_type;
+  using io_pending = int_computer_state::io_pending;
+
+  ///\brief Longest trace, in instructions.
+  static constexpr std::size_t max_trace = 256;
+
+  explicit ir_tier(const int_computer_state& program, std::uint32_t hot_threshold = 64);
+  ir_tier(const ir_tier&) = delete;
+  ir_tier& operator=(const ir_tier&) = delete;
+  ~ir_tier() noexcept;
+
+  ///\brief Evaluate \p s until the next read, write or halt instruction.
+  ///\details Like int_computer_state::eval_until_io_or_halt, the I/O instruction is not executed.
+  auto eval_until_io_or_halt(int_computer_state& s) -> io_pending;
+  ///\brief Evaluate, limited by \p budget.
+  ///\details A region is only entered if the budget allows all of its instructions.
+  auto eval_until_io_or_halt(int_computer_state& s, eval_budget& budget) -> io_pending;
+  ///\brief Evaluate \p s until it halts, using its read and write callbacks for I/O.
+  auto eval(int_computer_state& s) -> int_computer_state&;
+
+  ///\brief Number of regions built so far, including rebuilt regions.
+  auto regions_built() const noexcept -> std::uint64_t { return built_; }
+  ///\brief Number of regions discarded because the program modified them.
+  auto deopts() const noexcept -> std::uint64_t { return deopts_; }
+
+  ///\brief Human readable listing of the region at \p pc, or an empty string.
+  auto dump(size_type pc) const -> std::string;
+
+  private:
+  struct region;
+
+  auto build_(const int_computer_state& s, size_type entry) const -> std::unique_ptr<region>;
+  auto build_trace_(const int_computer_state& s, size_type entry, std::size_t limit, std::size_t& conflict) const -> std::unique_ptr<region>;
+  static auto guard_(const region& r, const int_computer_state& s) noexcept -> bool;
+  void run_(region& r, int_computer_state& s, eval_budget& budget);
+
+  control_flow_graph cfg_;
+  std::uint32_t hot_threshold_;
+  std::vector<std::uint32_t> heat_; ///< Entries per block index.
+  std::vector<std::unique_ptr<region>> regions_; ///< Region per block index.
+  std::uint64_t built_ = 0, deopts_ = 0;
+};
+
+
+#endif /* IR_TIER_HH */
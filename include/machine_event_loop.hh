@@ -0,0 +1,90 @@
+#ifndef MACHINE_EVENT_LOOP_HH
+#define MACHINE_EVENT_LOOP_HH
+
+#include <compact_machine.hh>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <signal.h>
+
+
+///\brief Runs machines whose input and output are bound to file descriptors, on one thread.
+///\details
+///Each machine reads integers (separated by white space or commas) from its
+///input descriptor, and writes its output one value per line, like buffered_io.
+///Descriptors are switched to non-blocking mode. When a machine wants input
+///that hasn't arrived, or its output can't be written, it is parked until
+///epoll reports the descriptor ready, and the loop runs other machines.
+///
+///Machines take turns of at most \p time_slice instructions, so a machine
+///that computes for a long time doesn't stall the others.
+///
+///The loop owns the descriptors, and closes them once the machine halts
+///(after writing all its output) or fails. Input and output may be the same
+///descriptor, for example a socket. Regular files are always ready, and are
+///read and written without parking.
+///
+///SIGPIPE is ignored while the loop exists, so a closed peer fails only the
+///machine writing to it. The previous disposition is restored on destruction.
+class machine_event_loop {
+  public:
+  using value_type = compact_machine::value_type;
+  using machine_id = std::size_t;
+
+  enum class machine_status {
+    running, ///< Ready, or parked on I/O.
+    halted,
+    failed
+  };
+
+  explicit machine_event_loop(std::uint64_t time_slice = 10000, std::size_t output_buffer = 64 * 1024);
+  machine_event_loop(const machine_event_loop&) = delete;
+  machine_event_loop& operator=(const machine_event_loop&) = delete;
+  ///\brief Closes the descriptors of all machines that are still running.
+  ~machine_event_loop();
+
+  ///\brief Add machine \p m, reading from \p in_fd and writing to \p out_fd.
+  ///\details
+  ///Machines that share a compact_machine image share its memory, so
+  ///thousands of machines of a single program are cheap.
+  ///\throws std::system_error if the descriptors can't be watched.
+  auto add(compact_machine m, int in_fd, int out_fd) -> machine_id;
+
+  ///\brief Run until all machines have halted or failed.
+  void run();
+  ///\brief Run all ready machines for one turn, then wait up to \p timeout_ms
+  ///milliseconds (-1 waits indefinitely) for parked machines to become ready.
+  ///\return The number of machines still running.
+  auto run_once(int timeout_ms = -1) -> std::size_t;
+
+  auto size() const noexcept -> std::size_t { return machines_.size(); }
+  ///\brief Number of machines still running.
+  auto active() const noexcept -> std::size_t { return active_; }
+  auto status(machine_id id) const -> machine_status;
+  ///\brief Why a machine failed.
+  auto error(machine_id id) const -> const std::string&;
+  auto machine(machine_id id) const -> const compact_machine&;
+
+  private:
+  struct entry;
+
+  void turn_(entry& e);
+  auto next_input_(entry& e, value_type& v) -> bool;
+  auto flush_(entry& e) -> bool;
+  void park_(entry& e, std::uint32_t events);
+  void finish_(entry& e, machine_status s, std::string error = {});
+
+  std::uint64_t time_slice_;
+  std::size_t output_buffer_;
+  int epoll_fd_;
+  std::vector<std::unique_ptr<entry>> machines_;
+  std::deque<entry*> ready_;
+  std::size_t active_ = 0;
+  struct sigaction old_pipe_;
+};
+
+
+#endif /* MACHINE_EVENT_LOOP_HH */
@@ -0,0 +1,27 @@
+#ifndef MAPPED_FILE_HH
+#define MAPPED_FILE_HH
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+
+///\brief Read-only memory mapping of a file.
+class mapped_file {
+  public:
+  explicit mapped_file(const std::string& filename);
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+  ~mapped_file();
+
+  auto data() const noexcept -> const char* { return data_; }
+  auto size() const noexcept -> std::size_t { return size_; }
+  auto view() const noexcept -> std::string_view { return std::string_view(data_, size_); }
+
+  private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+
+#endif /* MAPPED_FILE_HH */
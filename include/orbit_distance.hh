@@ -0,0 +1,67 @@
+#ifndef ORBIT_DISTANCE_HH
+#define ORBIT_DISTANCE_HH
+
+#include <orbit_table.hh>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+///\brief Answers distance queries between bodies of an orbit table.
+///\details
+///Uses a heavy-light decomposition: bodies are renumbered so that every heavy
+///chain is contiguous, and a query walks at most O(log n) chains towards the
+///common ancestor. The per-body data needed for that walk is packed in one array.
+class orbit_distance_index {
+  public:
+  using id_type = orbit_table::id_type;
+  using size_type = std::size_t;
+  using query = std::pair<id_type, id_type>;
+
+  static constexpr id_type npos = orbit_table::npos;
+  ///\brief Distance between bodies in different trees.
+  static constexpr id_type no_path = npos;
+
+  ///\throws std::runtime_error if the table contains a cycle.
+  explicit orbit_distance_index(const orbit_table& t);
+
+  auto size() const noexcept -> size_type { return pos_.size(); }
+
+  ///\brief Number of orbit steps between \p a and \p b.
+  ///\return Distance, or \ref no_path if \p a and \p b are in different trees.
+  auto distance(id_type a, id_type b) const -> id_type;
+  ///\brief Closest body that both \p a and \p b orbit (or are).
+  ///\return Id of the common ancestor, or \ref npos if there is none.
+  auto common_ancestor(id_type a, id_type b) const -> id_type;
+
+  ///\brief Answer the queries in [\p b, \p e), writing each distance to \p out.
+  ///\details
+  ///Queries are bucketed on the position of their first body, so that
+  ///consecutive queries walk nearby chains, and spread over \p threads threads.
+  ///No memory is allocated per query.
+  void distances(const query* b, const query* e, id_type* out,
+      unsigned int threads = std::thread::hardware_concurrency()) const;
+  auto distances(const std::vector<query>& queries,
+      unsigned int threads = std::thread::hardware_concurrency()) const
+  -> std::vector<id_type>;
+
+  private:
+  struct node {
+    id_type head; ///< Position of the top of the heavy chain.
+    id_type parent; ///< Position of the parent.
+    id_type depth;
+  };
+
+  ///\brief Common ancestor of positions \p a and \p b.
+  auto lca_(id_type a, id_type b) const noexcept -> id_type;
+  auto distance_(id_type a, id_type b) const noexcept -> id_type;
+  auto pos_of_(id_type id) const -> id_type;
+
+  std::vector<node> nodes_; ///< Indexed by position.
+  std::vector<id_type> pos_; ///< Position of each id.
+  std::vector<id_type> id_; ///< Id at each position.
+};
+
+
+#endif /* ORBIT_DISTANCE_HH */
@@ -0,0 +1,75 @@
+#ifndef ORBIT_IMAGE_HH
+#define ORBIT_IMAGE_HH
+
+#include <orbit_map.hh>
+#include <orbit_table.hh>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class mapped_file;
+
+
+///\brief Read-only orbit map, backed by a memory mapped binary file.
+///\details
+///The file holds a string table, the parent of each body, optionally the
+///depth of each body, and the body ids sorted by name.
+///Opening an image only validates the header: lookups binary search the
+///sorted index in place, so no hash tables are built at load.
+///
+///Images use the native byte order, and are not portable between
+///little and big endian machines.
+class orbit_image {
+  public:
+  using id_type = orbit_table::id_type;
+  using size_type = std::size_t;
+
+  static constexpr id_type npos = orbit_table::npos;
+
+  ///\brief Write \p t as an image to \p filename.
+  ///\details The file is written under a temporary name and renamed into place.
+  ///\param[in] with_depths If set, depths are computed and stored in the image.
+  static void write(const std::string& filename, const orbit_table& t, bool with_depths = true);
+  static void write(const std::string& filename, const orbit_map& m, bool with_depths = true);
+
+  ///\brief Open an image.
+  ///\throws std::runtime_error if the file is not a valid image.
+  explicit orbit_image(const std::string& filename);
+
+  auto size() const noexcept -> size_type { return count_; }
+  auto empty() const noexcept -> bool { return count_ == 0u; }
+  auto has_depths() const noexcept -> bool { return depth_ != nullptr; }
+
+  auto name(id_type id) const -> std::string_view;
+  auto parent(id_type id) const -> id_type;
+  ///\brief Depth of \p id.
+  ///\details Without stored depths, this walks the parent chain.
+  auto depth(id_type id) const -> size_type;
+
+  ///\brief Find the id of a body, using binary search.
+  ///\return The id of the body, or \ref npos if there is no such body.
+  ///\throw std::runtime_error If the image is corrupt.
+  auto find(std::string_view name) const -> id_type;
+  ///\brief The body that \p s orbits.
+  auto body_of(std::string_view s) const -> std::optional<std::string_view>;
+
+  ///\brief Returns the path to \p s.
+  ///\details Same as orbit_map::path(), but names refer into the image.
+  auto path(std::string_view s, bool include_s) const -> std::vector<std::string_view>;
+
+  private:
+  std::shared_ptr<const mapped_file> file_;
+  std::uint32_t count_ = 0;
+  const std::uint64_t* name_offsets_ = nullptr;
+  const id_type* parent_ = nullptr;
+  const std::uint32_t* depth_ = nullptr;
+  const id_type* sorted_ = nullptr;
+  const char* names_ = nullptr;
+};
+
+
+#endif /* ORBIT_IMAGE_HH */
@@ -1,8 +1,10 @@
 #ifndef ORBIT_MAP_HH
 #define ORBIT_MAP_HH
 
+#include <euler_tour_forest.hh>
 #include <iosfwd>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -32,7 +34,16 @@ class orbit_map {
 
   orbit_map(std::initializer_list<map_type::value_type> il)
   : map_(il.begin(), il.end())
-  {}
+  {
+    rebuild_();
+  }
+
+  template<typename Iter>
+  orbit_map(Iter b, Iter e)
+  : map_(b, e)
+  {
+    rebuild_();
+  }
 
   static auto parse(std::istream& in) -> orbit_map;
 
@@ -63,8 +74,38 @@ class orbit_map {
   ///\return Path from the root node to \p s. \p s will be omitted if \p include_s is false.
   auto path(const satelite& s, bool include_s) const -> std::vector<body>;
 
+  ///\brief Add the orbit \p b)\p s.
+  ///\throws std::invalid_argument if \p s already orbits something,
+  ///or if the orbit would create a cycle.
+  void insert(const body& b, const satelite& s);
+  ///\brief Remove the orbit of \p s.
+  ///\details Satelites of \p s keep orbiting \p s.
+  ///\return True if \p s orbited something.
+  auto erase(const satelite& s) -> bool;
+  ///\brief Make \p s orbit \p b, instead of what it orbits now.
+  ///\throws std::out_of_range if \p s doesn't orbit anything.
+  ///\throws std::invalid_argument if the orbit would create a cycle.
+  void reparent(const satelite& s, const body& b);
+
+  ///\brief Number of direct and indirect orbits.
+  ///\details Maintained on every update, so this is constant time.
+  auto total_orbits() const noexcept -> size_type { return forest_.total_depth(); }
+  ///\brief Number of bodies \p b orbits, directly or indirectly.
+  ///\throws std::out_of_range if \p b is not in the map.
+  auto depth(const body& b) const -> size_type;
+  ///\brief Number of bodies in the subtree rooted at \p b, including \p b.
+  ///\throws std::out_of_range if \p b is not in the map.
+  auto subtree_size(const body& b) const -> size_type;
+
   private:
+  void rebuild_();
+  auto vertex_(const body& b) -> euler_tour_forest::vertex;
+  auto find_vertex_(const body& b) const -> euler_tour_forest::vertex;
+  void drop_if_isolated_(const body& b);
+
   map_type map_;
+  euler_tour_forest forest_;
+  std::unordered_map<body, euler_tour_forest::vertex> vertices_;
 };
 
 
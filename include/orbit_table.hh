@@ -0,0 +1,92 @@
+#ifndef ORBIT_TABLE_HH
+#define ORBIT_TABLE_HH
+
+#include <orbit_map.hh>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+///\brief Index based representation of an orbit map.
+///\details
+///Every body is assigned a dense id.
+///Names are string views into storage owned by the table
+///(a memory mapped file, or a string arena).
+class orbit_table {
+  public:
+  using id_type = std::uint32_t;
+  using size_type = std::size_t;
+
+  ///\brief Parent of bodies that don't orbit anything.
+  static constexpr id_type npos = std::numeric_limits<id_type>::max();
+
+  orbit_table() = default;
+  explicit orbit_table(const orbit_map& m);
+
+  ///\brief Load an orbit map file, in the `A)B` format accepted by orbit_map::parse.
+  ///\details
+  ///The file is memory mapped and parsed in chunks on \p threads threads.
+  ///\throws std::runtime_error if the file can't be parsed, or has duplicate satelites.
+  static auto load(const std::string& filename, unsigned int threads = std::thread::hardware_concurrency())
+  -> orbit_table;
+
+  ///\brief Parse \p text, which must outlive the table.
+  static auto parse(std::string_view text, unsigned int threads = std::thread::hardware_concurrency())
+  -> orbit_table;
+
+  ///\brief Number of bodies.
+  auto size() const noexcept -> size_type { return names_.size(); }
+  auto empty() const noexcept -> bool { return names_.empty(); }
+
+  auto name(id_type id) const -> std::string_view { return names_.at(id); }
+  auto parent(id_type id) const -> id_type { return parent_.at(id); }
+  auto parents() const noexcept -> const std::vector<id_type>& { return parent_; }
+
+  ///\brief Find the id of a body.
+  ///\return The id of the body, or \ref npos if there is no such body.
+  auto find(std::string_view name) const -> id_type;
+
+  ///\brief Compute the depth of every body, indexed by id.
+  ///\details
+  ///With more than one thread, depths are found by pointer jumping,
+  ///which takes a logarithmic number of parallel rounds, even for a single long chain.
+  ///\throws std::runtime_error if the parent array contains a cycle.
+  auto depths(unsigned int threads = std::thread::hardware_concurrency()) const
+  -> std::vector<id_type>;
+  ///\brief Number of direct and indirect orbits (the sum of all depths).
+  auto total_orbits(unsigned int threads = std::thread::hardware_concurrency()) const
+  -> std::uint64_t;
+
+  auto to_orbit_map() const -> orbit_map;
+
+  private:
+  struct name_ref {
+    std::string_view name;
+    std::size_t hash;
+  };
+  using pair_list = std::vector<std::pair<name_ref, name_ref>>; // (body, satelite)
+
+  auto find_(std::string_view name, std::size_t hash) const -> id_type;
+  static auto parse_chunk_(std::string_view text) -> pair_list;
+  static auto split_(std::string_view text, unsigned int chunks) -> std::vector<std::string_view>;
+  void build_(const std::vector<pair_list>& chunks, unsigned int threads);
+  auto sequential_depths_() const -> std::vector<id_type>;
+  auto parallel_depths_(unsigned int threads) const -> std::vector<id_type>;
+
+  std::shared_ptr<const void> storage_;
+  std::vector<std::string_view> names_;
+  std::vector<id_type> parent_;
+  ///\brief Name lookup, partitioned by hash, mapping to ids relative to the partition offset.
+  std::vector<std::unordered_map<std::string_view, id_type>> parts_;
+  std::vector<id_type> part_offsets_;
+};
+
+
+#endif /* ORBIT_TABLE_HH */
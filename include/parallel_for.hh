@@ -0,0 +1,38 @@
+#ifndef PARALLEL_FOR_HH
+#define PARALLEL_FOR_HH
+
+#include <exception>
+#include <thread>
+#include <vector>
+
+
+///\brief Run fn(0) .. fn(n - 1) on separate threads.
+///\details The first exception thrown by any of the invocations is rethrown.
+template<typename Fn>
+void parallel_for(unsigned int n, Fn fn) {
+  if (n <= 1u) {
+    if (n == 1u) fn(0u);
+    return;
+  }
+
+  std::vector<std::exception_ptr> errors(n);
+  std::vector<std::thread> workers;
+  workers.reserve(n);
+  for (unsigned int i = 0; i < n; ++i) {
+    workers.emplace_back(
+        [&fn, &errors, i]() {
+          try {
+            fn(i);
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
+        });
+  }
+  for (auto& w : workers) w.join();
+
+  for (const auto& e : errors)
+    if (e) std::rethrow_exception(e);
+}
+
+
+#endif /* PARALLEL_FOR_HH */
@@ -0,0 +1,94 @@
+#ifndef PERF_COUNTERS_HH
+#define PERF_COUNTERS_HH
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+
+
+///\brief Hardware performance counters of the calling thread.
+///\details
+///Counters are read with perf_event_open(2), counting user space only.
+///Each event is opened on its own, so events the CPU or kernel doesn't
+///support (or that perf_event_paranoid forbids) are reported as unavailable,
+///while the others still work. On systems without perf events, all events
+///are unavailable.
+///
+///Alongside the hardware counts, a reading holds the wall clock time and the
+///number of instructions interpreted by int_computer_state on this thread,
+///so costs can be reported per interpreted instruction.
+class perf_counters {
+  public:
+  enum class event : unsigned int {
+    cycles,
+    instructions,
+    branch_misses,
+    l1d_read_misses,
+    llc_misses
+  };
+  static constexpr std::size_t event_count = 5;
+
+  static auto event_name(event e) noexcept -> const char*;
+
+  struct reading {
+    auto operator[](event e) const noexcept -> const std::optional<std::uint64_t>& {
+      return counts[static_cast<std::size_t>(e)];
+    }
+
+    std::array<std::optional<std::uint64_t>, event_count> counts;
+    std::uint64_t interpreted = 0;
+    std::chrono::nanoseconds elapsed{ 0 };
+  };
+
+  perf_counters();
+  perf_counters(const perf_counters&) = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+  ~perf_counters();
+
+  auto available(event e) const noexcept -> bool { return fds_[static_cast<std::size_t>(e)] != -1; }
+  ///\brief Why counters are unavailable, if none could be opened.
+  auto unavailable_reason() const -> const std::string& { return unavailable_reason_; }
+
+  ///\brief Reset and start counting.
+  void start();
+  ///\brief Stop counting, and return the counts since start().
+  auto stop() -> reading;
+
+  private:
+  std::array<int, event_count> fds_;
+  std::string unavailable_reason_;
+  std::uint64_t interpreted_start_ = 0;
+  std::chrono::steady_clock::time_point start_time_;
+};
+
+///\brief Write \p r, with ratios per interpreted instruction.
+void write_report(std::ostream& out, const std::string& label, const perf_counters::reading& r);
+
+
+///\brief Measures the lifetime of a scope, and reports it on destruction.
+class perf_scope {
+  public:
+  explicit perf_scope(std::string label);
+  perf_scope(std::string label, std::ostream& out);
+  perf_scope(const perf_scope&) = delete;
+  perf_scope& operator=(const perf_scope&) = delete;
+  ~perf_scope();
+
+  ///\brief Create a scope if environment variable \p env is set (to anything).
+  ///\return A scope reporting to std::cerr, or null.
+  static auto from_env(std::string label, const char* env = "INT_COMPUTER_PERF")
+  -> std::unique_ptr<perf_scope>;
+
+  private:
+  std::string label_;
+  std::ostream& out_;
+  perf_counters counters_;
+};
+
+
+#endif /* PERF_COUNTERS_HH */
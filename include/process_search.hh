@@ -0,0 +1,58 @@
+#ifndef PROCESS_SEARCH_HH
+#define PROCESS_SEARCH_HH
+
+#include <int_computer.hh>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+
+///\brief Searches candidates [0, count) of a program, in forked worker processes.
+///\details
+///The program image and a work queue of candidate ranges are placed in
+///shared memory before forking the workers. The image is mapped read-only,
+///and each worker evaluates the ranges it claims against its own copy.
+///
+///A worker publishes the best score of a range when it completes the range,
+///so a crashing worker only loses the range it was working on. Once all
+///workers have exited, unfinished ranges are queued again and a new set of
+///workers is forked, up to \p max_retries times per range. Ranges no worker
+///claimed are queued again without using up a retry.
+///
+///Workers must not rely on threads of the parent: only the forking thread
+///exists in a worker.
+class process_search {
+  public:
+  using value_type = int_computer_state::value_type;
+
+  ///\brief Score of \p candidate, or an empty optional if it doesn't qualify.
+  ///\details Called in the worker process. An exception ends the worker, like a crash.
+  using evaluate_fn = std::function<std::optional<value_type>(const int_computer_state& program, std::uint64_t candidate)>;
+
+  struct result {
+    std::optional<value_type> best; ///< Highest score.
+    std::uint64_t candidate = 0; ///< Lowest candidate with the highest score.
+    std::uint64_t evaluated = 0; ///< Candidates evaluated in completed ranges.
+    unsigned int crashes = 0; ///< Workers that didn't exit cleanly.
+    std::uint64_t retried_ranges = 0; ///< Ranges that were queued again after a crash.
+    std::uint64_t failed_ranges = 0; ///< Ranges given up on after \p max_retries.
+  };
+
+  ///\param workers Number of worker processes.
+  ///\param range_size Number of candidates a worker claims at a time.
+  ///\param max_retries Number of times a range is retried after its worker crashed.
+  explicit process_search(unsigned int workers, std::uint64_t range_size = 64, unsigned int max_retries = 3);
+
+  ///\brief Evaluate all candidates in [0, \p count), returning the best score.
+  ///\throws std::system_error if shared memory can't be mapped or workers can't be forked.
+  auto run(const int_computer_state& program, std::uint64_t count, const evaluate_fn& fn) const -> result;
+
+  private:
+  unsigned int workers_;
+  std::uint64_t range_size_;
+  unsigned int max_retries_;
+};
+
+
+#endif /* PROCESS_SEARCH_HH */
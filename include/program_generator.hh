@@ -0,0 +1,84 @@
+#ifndef PROGRAM_GENERATOR_HH
+#define PROGRAM_GENERATOR_HH
+
+#include <int_computer.hh>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+
+///\brief Parameters of a generated program.
+struct generator_config {
+  ///\brief Relative frequency of each arithmetic opcode.
+  struct opcode_mix {
+    unsigned int add = 4, mul = 1, less_than = 1, equals = 1;
+  };
+
+  std::uint64_t words = 4096; ///< Program size in memory cells; generation stops at the first segment reaching it.
+  unsigned int loop_depth = 2; ///< Nesting depth of the loop around each segment body.
+  std::uint32_t loop_iterations = 10; ///< Upper bound on the iteration count of each loop.
+  std::uint32_t body_size = 16; ///< Instructions in the innermost loop body.
+  opcode_mix mix;
+  std::uint64_t footprint = 256; ///< Data cells the program uses.
+  double io_rate = 0.0; ///< Fraction of body instructions that read or write.
+  double self_modify_rate = 0.0; ///< Fraction of body instructions that rewrite an instruction.
+  std::uint64_t seed = 1;
+};
+
+
+///\brief Generates valid programs of configurable shape, with their input and expected output.
+///\details
+///Memory starts with a jump over the data cells, followed by segments until
+///the program reaches the requested size, and a halt.
+///Each segment is a loop nest around a body of random instructions, followed
+///by a write of an accumulator. Body instructions:
+///- compute from input cells, scratch cells and immediates into scratch cells;
+///- add scratch or input cells to the accumulator;
+///- read an input cell, or write a cell, at \ref generator_config::io_rate;
+///- rewrite the immediate operand of another body instruction, at
+///  \ref generator_config::self_modify_rate.
+///
+///Input cells hold 0..9 and only add and mul read them, and scratch cells are
+///only read by comparisons and the accumulator, so values stay small and
+///loop iteration counts are capped to keep the accumulator in range.
+///
+///The expected output is computed by a model of the segments, as they are
+///generated, so programs can be streamed at any size.
+class program_generator {
+  public:
+  using value_type = int_computer_state::value_type;
+
+  struct stats {
+    std::uint64_t words = 0; ///< Program size.
+    std::uint64_t instructions = 0; ///< Instructions executed until halt, excluding the halt.
+    std::uint64_t segments = 0;
+    std::uint64_t inputs = 0;
+    std::uint64_t outputs = 0;
+  };
+
+  ///\brief A generated program, held in memory.
+  struct program {
+    int_computer_state image;
+    std::vector<value_type> input, expected;
+    stats s;
+  };
+
+  ///\throws std::invalid_argument if the configuration is unusable.
+  explicit program_generator(const generator_config& cfg);
+
+  ///\brief Write the program (comma separated), its input and its expected output (one value per line).
+  auto generate(std::ostream& program, std::ostream& input, std::ostream& expected) const -> stats;
+  auto generate() const -> program;
+
+  private:
+  class sink;
+  class text_sink;
+  class vector_sink;
+
+  auto generate_(sink& program, sink& input, sink& expected) const -> stats;
+
+  generator_config cfg_;
+};
+
+
+#endif /* PROGRAM_GENERATOR_HH */
@@ -0,0 +1,85 @@
+#ifndef RESULT_CACHE_HH
+#define RESULT_CACHE_HH
+
+#include <int_computer.hh>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+///\brief On-disk cache of the outputs of deterministic runs.
+///\details
+///Entries are addressed by a SHA-256 digest of their key (the program image
+///and pc, the inputs, and for amplifier chains the phase settings). Only the
+///digest is stored in the entry, and compared on lookup, so an entry's size
+///is dominated by its outputs rather than by a copy of the program.
+///
+///The cache may be shared by several processes:
+///entries are written to a temporary file and renamed into place, so readers
+///never see partial entries. A hit touches the entry's modification time, and
+///eviction removes the least recently touched entries once the cache grows
+///beyond its size limit. Eviction is serialized with an flock on the cache
+///directory's lock file; a process that finds the lock taken skips eviction.
+class result_cache {
+  public:
+  using value_type = int_computer_state::value_type;
+
+  class key {
+    friend class result_cache;
+
+    public:
+    auto hash() const noexcept -> std::uint64_t { return hash_; }
+
+    private:
+    explicit key(const std::string& bytes);
+
+    std::string digest_; ///< SHA-256 of the key.
+    std::uint64_t hash_; ///< Prefix of the digest, which names the entry file.
+  };
+
+  ///\brief Key for running \p program on \p inputs, collecting all outputs.
+  static auto machine_key(const int_computer_state& program, const std::vector<value_type>& inputs) -> key;
+  ///\brief Key for an amplifier chain of \p program with \p phases, started with \p input.
+  ///\param[in] feedback Distinguishes amplifier_chain::feedback_eval() from eval().
+  static auto chain_key(const int_computer_state& program, const std::vector<value_type>& phases,
+      value_type input, bool feedback) -> key;
+
+  ///\brief Open (and create if needed) the cache in \p directory.
+  explicit result_cache(std::string directory, std::uint64_t max_bytes = std::uint64_t(256) << 20);
+
+  auto lookup(const key& k) -> std::optional<std::vector<value_type>>;
+  void store(const key& k, const std::vector<value_type>& outputs);
+
+  ///\brief Look up \p k, computing and storing the outputs using \p fn on a miss.
+  template<typename Fn>
+  auto get(const key& k, Fn&& fn) -> std::vector<value_type> {
+    auto cached = lookup(k);
+    if (cached.has_value()) return *std::move(cached);
+
+    std::vector<value_type> outputs = fn();
+    store(k, outputs);
+    return outputs;
+  }
+
+  ///\brief Remove least recently used entries, until the cache is below its size limit.
+  void evict();
+
+  auto hits() const noexcept -> std::uint64_t { return hits_; }
+  auto misses() const noexcept -> std::uint64_t { return misses_; }
+
+  private:
+  auto path_(const key& k) const -> std::string;
+  auto scan_size_() const -> std::uint64_t;
+
+  std::string directory_;
+  std::uint64_t max_bytes_;
+  ///\brief Estimate of the cache size, refreshed on every eviction.
+  std::atomic<std::uint64_t> size_estimate_;
+  std::atomic<std::uint64_t> hits_{ 0 }, misses_{ 0 };
+};
+
+
+#endif /* RESULT_CACHE_HH */
@@ -0,0 +1,269 @@
+#ifndef STATIC_INT_COMPUTER_HH
+#define STATIC_INT_COMPUTER_HH
+
+#include <int_computer.hh>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+
+///\brief Int computer with fixed size memory, that can be evaluated at compile time.
+///\details
+///Does not use the heap or std::function: I/O is performed by the caller,
+///whenever eval_until_io_or_halt() returns.
+///Errors are reported by the same exceptions as \ref int_computer_state,
+///which turns them into compilation errors during constant evaluation.
+template<std::size_t N>
+class static_int_computer {
+  public:
+  using value_type = int_computer_state::value_type;
+  using size_type = std::size_t;
+  using io_pending = int_computer_state::io_pending;
+
+  constexpr static_int_computer() = default;
+
+  constexpr static_int_computer(const std::array<value_type, N>& program, size_type pc = 0)
+  : mem_(program),
+    pc_(pc)
+  {}
+
+  constexpr auto size() const noexcept -> size_type { return N; }
+  constexpr auto pc() const noexcept -> size_type { return pc_; }
+  constexpr auto operator[](size_type idx) -> value_type& { return mem_[idx]; }
+  constexpr auto operator[](size_type idx) const -> const value_type& { return mem_[idx]; }
+
+  constexpr auto is_halt() const -> bool {
+    return opcode_() == opcode::halt;
+  }
+
+  constexpr auto eval_until_io_or_halt() -> io_pending {
+    for (;;) {
+      switch (opcode_()) {
+        default:
+          step_();
+          break;
+        case opcode::halt:
+          return io_pending::halt;
+        case opcode::read:
+          return io_pending::read;
+        case opcode::write:
+          return io_pending::write;
+      }
+    }
+  }
+
+  ///\brief Evaluate until halt, without performing I/O.
+  constexpr auto eval() -> static_int_computer& {
+    if (eval_until_io_or_halt() != io_pending::halt) throw io_error("no input/output");
+    return *this;
+  }
+
+  ///\brief Perform the pending read operation.
+  constexpr void read(value_type v) {
+    if (opcode_() != opcode::read) throw io_error("no read pending");
+    check_modes_(1);
+    store_(0, v);
+    pc_ += 2u;
+  }
+
+  ///\brief Perform the pending write operation.
+  constexpr auto write() -> value_type {
+    if (opcode_() != opcode::write) throw io_error("no write pending");
+    check_modes_(1);
+    const value_type v = load_(0);
+    pc_ += 2u;
+    return v;
+  }
+
+  ///\brief Run \p s with the given inputs, and return its only output.
+  template<std::size_t NIn>
+  static constexpr auto single_output(static_int_computer s, const std::array<value_type, NIn>& in) -> value_type {
+    std::size_t in_idx = 0;
+    bool out_called = false;
+    value_type out = 0;
+
+    for (;;) {
+      switch (s.eval_until_io_or_halt()) {
+        case io_pending::halt:
+          if (!out_called) throw io_error("no output value");
+          return out;
+        case io_pending::read:
+          if (in_idx == NIn) throw io_error("too many input values");
+          s.read(in[in_idx++]);
+          break;
+        case io_pending::write:
+          if (out_called) throw io_error("too many output values");
+          out_called = true;
+          out = s.write();
+          break;
+        case io_pending::budget_exhausted:
+          throw std::logic_error("static_int_computer has no budget");
+      }
+    }
+  }
+
+  constexpr auto operator==(const static_int_computer& y) const -> bool {
+    if (pc_ != y.pc_) return false;
+    for (size_type i = 0; i < N; ++i)
+      if (mem_[i] != y.mem_[i]) return false;
+    return true;
+  }
+
+  constexpr auto operator!=(const static_int_computer& y) const -> bool {
+    return !(*this == y);
+  }
+
+  private:
+  constexpr auto word_(size_type idx) const -> value_type {
+    if (idx >= N) throw std::out_of_range("memory access out of range");
+    return mem_[idx];
+  }
+
+  constexpr auto opcode_() const -> opcode {
+    return opcode(word_(pc_) % 100);
+  }
+
+  constexpr auto mode_(size_type arg) const -> addressing_mode {
+    value_type modes = word_(pc_) / 100;
+    for (; arg > 0; --arg) modes /= 10;
+    if (modes % 10 != 0 && modes % 10 != 1)
+      throw invalid_opcode_error("invalid addressing mode");
+    return addressing_mode(modes % 10);
+  }
+
+  constexpr void check_modes_(size_type args) const {
+    if (pc_ + args >= N) throw std::range_error("insufficient arguments");
+    value_type modes = word_(pc_) / 100;
+    for (size_type i = 0; i < args; ++i) {
+      mode_(i);
+      modes /= 10;
+    }
+    if (modes != 0) throw invalid_opcode_error("too many opcode modifiers");
+  }
+
+  constexpr auto load_(size_type arg) const -> value_type {
+    const value_type v = word_(pc_ + 1u + arg);
+    if (mode_(arg) == addressing_mode::immediate) return v;
+    if (v < 0) throw std::out_of_range("memory access out of range");
+    return word_(v);
+  }
+
+  constexpr void store_(size_type arg, value_type new_value) {
+    const value_type v = word_(pc_ + 1u + arg);
+    if (mode_(arg) == addressing_mode::immediate)
+      throw invalid_opcode_error("cannot assign to a immediate value");
+    if (v < 0 || size_type(v) >= N) throw std::out_of_range("memory access out of range");
+    mem_[v] = new_value;
+  }
+
+  constexpr void step_() {
+    switch (opcode_()) {
+      default:
+        throw invalid_opcode_error("bad opcode");
+      case opcode::add:
+        check_modes_(3);
+        store_(2, load_(0) + load_(1));
+        pc_ += 4u;
+        break;
+      case opcode::mul:
+        check_modes_(3);
+        store_(2, load_(0) * load_(1));
+        pc_ += 4u;
+        break;
+      case opcode::jump_if_true:
+        check_modes_(2);
+        pc_ = (load_(0) != 0 ? size_type(load_(1)) : pc_ + 3u);
+        break;
+      case opcode::jump_if_false:
+        check_modes_(2);
+        pc_ = (load_(0) == 0 ? size_type(load_(1)) : pc_ + 3u);
+        break;
+      case opcode::less_than:
+        check_modes_(3);
+        store_(2, load_(0) < load_(1) ? 1 : 0);
+        pc_ += 4u;
+        break;
+      case opcode::equals:
+        check_modes_(3);
+        store_(2, load_(0) == load_(1) ? 1 : 0);
+        pc_ += 4u;
+        break;
+    }
+  }
+
+  std::array<value_type, N> mem_{};
+  size_type pc_ = 0u;
+};
+
+template<std::size_t N>
+constexpr auto make_static_int_computer(const int_computer_state::value_type (&program)[N])
+-> static_int_computer<N> {
+  std::array<int_computer_state::value_type, N> mem{};
+  for (std::size_t i = 0; i < N; ++i) mem[i] = program[i];
+  return static_int_computer<N>(mem);
+}
+
+
+///\brief Compile time evaluable equivalent of \ref amplifier_chain.
+template<std::size_t N, std::size_t Stages>
+class static_amplifier_chain {
+  public:
+  using value_type = int_computer_state::value_type;
+  using io_pending = int_computer_state::io_pending;
+
+  constexpr static_amplifier_chain(const std::array<int, Stages>& phase_settings, const static_int_computer<N>& program)
+  : amps_{}
+  {
+    for (std::size_t i = 0; i < Stages; ++i) {
+      amps_[i] = program;
+      if (amps_[i].eval_until_io_or_halt() != io_pending::read)
+        throw bad_program_error("first input must be phase setting readout");
+      amps_[i].read(phase_settings[i]);
+      eval_until_read_or_halt_(amps_[i]);
+    }
+  }
+
+  constexpr auto is_halt() const -> bool {
+    for (const auto& amp : amps_)
+      if (!amp.is_halt()) return false;
+    return true;
+  }
+
+  constexpr auto operator()(value_type v) -> value_type {
+    for (auto& amp : amps_) {
+      if (amp.is_halt()) throw std::runtime_error("amplifier has halted");
+      amp.read(v);
+      if (amp.eval_until_io_or_halt() != io_pending::write)
+        throw bad_program_error("expected amplifier write");
+      v = amp.write();
+      eval_until_read_or_halt_(amp);
+    }
+    return v;
+  }
+
+  constexpr auto feedback_eval(value_type v) -> value_type {
+    do {
+      v = (*this)(v);
+    } while (!is_halt());
+    return v;
+  }
+
+  private:
+  static constexpr void eval_until_read_or_halt_(static_int_computer<N>& amp) {
+    if (amp.eval_until_io_or_halt() == io_pending::write)
+      throw bad_program_error("after phase input, amplifier must perform a read operation");
+  }
+
+  std::array<static_int_computer<N>, Stages> amps_;
+};
+
+template<std::size_t N, std::size_t Stages>
+constexpr auto make_static_amplifier_chain(const int (&phase_settings)[Stages], const int_computer_state::value_type (&program)[N])
+-> static_amplifier_chain<N, Stages> {
+  std::array<int, Stages> phases{};
+  for (std::size_t i = 0; i < Stages; ++i) phases[i] = phase_settings[i];
+  return static_amplifier_chain<N, Stages>(phases, make_static_int_computer(program));
+}
+
+
+#endif /* STATIC_INT_COMPUTER_HH */
@@ -0,0 +1,16 @@
+#ifndef SWALLOW_EXCEPTIONS_HH
+#define SWALLOW_EXCEPTIONS_HH
+
+
+///\brief Invoke \p fn, discarding any exception it throws.
+///\details Used by destructors that flush, as destructors must not throw.
+template<typename Fn>
+void swallow_exceptions(Fn&& fn) noexcept {
+  try {
+    fn();
+  } catch (...) {
+  }
+}
+
+
+#endif /* SWALLOW_EXCEPTIONS_HH */
@@ -0,0 +1,125 @@
+#ifndef TELEMETRY_HH
+#define TELEMETRY_HH
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+///\brief Process wide counters of interpreter activity.
+///\details
+///Every thread counts in its own cache line aligned block, using a relaxed
+///load and store, so counting takes no locks and no locked instructions,
+///and threads never write to each other's cache lines.
+///Blocks are kept in a lock-free list, which read() walks to sum the
+///blocks of all threads. Blocks of exited threads are reused by new threads,
+///so the counters keep counting totals.
+///
+///Counting is compiled in if INT_COMPUTER_TELEMETRY is defined (the CMake
+///option of the same name, off by default). Otherwise add() does nothing,
+///and all counters read as zero.
+class telemetry {
+  public:
+  enum class counter : unsigned int {
+    instructions,
+    reads,
+    writes,
+    halts,
+    feedback_rounds,
+    searches
+  };
+  static constexpr std::size_t counter_count = 6;
+
+#ifdef INT_COMPUTER_TELEMETRY
+  static constexpr bool enabled = true;
+#else
+  static constexpr bool enabled = false;
+#endif
+
+  using snapshot = std::array<std::uint64_t, counter_count>;
+
+  static auto name(counter c) noexcept -> const char*;
+  static auto help(counter c) noexcept -> const char*;
+
+  static void add([[maybe_unused]] counter c, [[maybe_unused]] std::uint64_t n = 1) noexcept {
+#ifdef INT_COMPUTER_TELEMETRY
+    if (local_ == nullptr) acquire_();
+    auto& v = local_->values[static_cast<std::size_t>(c)];
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+#endif
+  }
+
+  ///\brief The calling thread's count of \p c.
+  ///\details Blocks are reused by new threads, so only differences are meaningful.
+  static auto local([[maybe_unused]] counter c) noexcept -> std::uint64_t {
+#ifdef INT_COMPUTER_TELEMETRY
+    if (local_ == nullptr) acquire_();
+    return local_->values[static_cast<std::size_t>(c)].load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+  }
+
+  ///\brief Sum of the counters of all threads.
+  ///\details Safe to call while other threads count.
+  static auto read() noexcept -> snapshot;
+
+  ///\brief Write the counters in the Prometheus text exposition format.
+  static void write_prometheus(std::ostream& out);
+
+  private:
+  struct alignas(64) block {
+    std::array<std::atomic<std::uint64_t>, counter_count> values{};
+    std::atomic<bool> in_use{ true };
+    block* next = nullptr;
+  };
+
+  static void acquire_();
+
+  static thread_local block* local_;
+  static std::atomic<block*> head_;
+};
+
+
+///\brief Periodically dumps the telemetry counters.
+///\details
+///The target is either a file name, which is rewritten atomically every
+///interval, or `unix:` followed by a path, which serves the counters to
+///every client connecting to the Unix socket at that path.
+class telemetry_dumper {
+  public:
+  explicit telemetry_dumper(std::string target, std::chrono::milliseconds interval = std::chrono::seconds(1));
+  telemetry_dumper(const telemetry_dumper&) = delete;
+  telemetry_dumper& operator=(const telemetry_dumper&) = delete;
+  ///\brief Stop the dumper, writing a final dump to a file target.
+  ~telemetry_dumper();
+
+  ///\brief Create a dumper if the environment variable \p env names a target.
+  ///\return A dumper for the named target, or null if \p env is not set.
+  static auto from_env(const char* env = "INT_COMPUTER_METRICS") -> std::unique_ptr<telemetry_dumper>;
+
+  private:
+  void run_file_();
+  void run_socket_();
+  void write_file_() const;
+
+  std::string target_;
+  std::string socket_path_; ///< Empty for a file target.
+  std::chrono::milliseconds interval_;
+  int listen_fd_ = -1; ///< Only used for a socket target.
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+
+#endif /* TELEMETRY_HH */
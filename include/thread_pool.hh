@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_HH
+#define THREAD_POOL_HH
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+///\brief Fixed size pool of worker threads, running submitted tasks in FIFO order.
+class thread_pool {
+  public:
+  explicit thread_pool(unsigned int threads = std::thread::hardware_concurrency());
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+  ///\brief Runs all queued tasks, then joins the workers.
+  ~thread_pool();
+
+  void submit(std::function<void()> task);
+  ///\brief Wait until all submitted tasks have completed.
+  ///\throws The first exception thrown by a task since the last wait().
+  void wait();
+
+  auto size() const noexcept -> std::size_t { return workers_.size(); }
+
+  private:
+  void worker_();
+
+  std::mutex mtx_;
+  std::condition_variable task_cv_, idle_cv_;
+  std::deque<std::function<void()>> tasks_;
+  std::size_t running_ = 0;
+  bool stop_ = false;
+  std::exception_ptr error_;
+  std::vector<std::thread> workers_;
+};
+
+
+#endif /* THREAD_POOL_HH */
@@ -0,0 +1,97 @@
+#ifndef TRACE_RECORDER_HH
+#define TRACE_RECORDER_HH
+
+#include <int_computer.hh>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+///\brief Fixed size record of a single executed instruction.
+struct trace_record {
+  using value_type = int_computer_state::value_type;
+
+  ///\brief Program counter value marking a dropped-records record.
+  ///\details Its \ref result holds the number of records that were dropped.
+  static constexpr std::uint32_t dropped_marker = 0xffffffffu;
+
+  std::uint32_t pc;
+  value_type instruction; ///< Opcode, including addressing modes.
+  value_type args[3]; ///< Raw argument words, unused words are zero.
+  value_type result; ///< Stored value, written value, or jump target.
+};
+
+static_assert(sizeof(trace_record) == 24, "trace_record must be packed");
+
+
+///\brief Records executed instructions to a file.
+///\details
+///Records are placed in a lock-free single-producer/single-consumer ring buffer,
+///which is written to disk by a background thread.
+///If the buffer is full, records are dropped (and counted) instead of
+///blocking the interpreter.
+///
+///A recorder must only be fed from one thread at a time.
+class trace_recorder {
+  public:
+  explicit trace_recorder(const std::string& filename, std::size_t capacity = 1u << 16);
+  trace_recorder(const trace_recorder&) = delete;
+  trace_recorder& operator=(const trace_recorder&) = delete;
+  ~trace_recorder();
+
+  ///\brief Create a recorder if the environment variable \p env names a file.
+  ///\return A recorder writing to the named file, or null if \p env is not set.
+  static auto from_env(const char* env = "INT_COMPUTER_TRACE") -> std::unique_ptr<trace_recorder>;
+
+  void record(const trace_record& r) noexcept {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= buf_.size()) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+      return;
+    }
+
+    buf_[head & mask_] = r;
+    head_.store(head + 1u, std::memory_order_release);
+  }
+
+  ///\brief Number of records that did not fit in the ring buffer.
+  auto dropped() const noexcept -> std::uint64_t {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  private:
+  void run_();
+  auto drain_() -> bool;
+
+  std::ofstream out_;
+  std::vector<trace_record> buf_;
+  std::size_t mask_;
+  alignas(64) std::atomic<std::uint64_t> head_{ 0u };
+  alignas(64) std::atomic<std::uint64_t> tail_{ 0u };
+  alignas(64) std::atomic<std::uint64_t> dropped_{ 0u };
+  std::atomic<bool> stop_{ false };
+  std::thread writer_;
+};
+
+
+///\brief Reads back a file written by \ref trace_recorder.
+class trace_reader {
+  public:
+  explicit trace_reader(std::istream& in);
+
+  ///\brief Read the next record.
+  ///\return False at the end of the trace.
+  auto next(trace_record& r) -> bool;
+
+  private:
+  std::istream& in_;
+};
+
+
+#endif /* TRACE_RECORDER_HH */
@@ -0,0 +1,120 @@
+#include <program_generator.hh>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+///\brief Parse a count with an optional K, M or G (binary) suffix.
+auto parse_size(const std::string& s) -> std::uint64_t {
+  std::size_t pos;
+  std::uint64_t n = std::stoull(s, &pos);
+  if (pos + 1u == s.size()) {
+    switch (s[pos]) {
+      case 'G': case 'g': n <<= 10; [[fallthrough]];
+      case 'M': case 'm': n <<= 10; [[fallthrough]];
+      case 'K': case 'k': n <<= 10; break;
+      default: throw std::invalid_argument("bad size: " + s);
+    }
+  } else if (pos != s.size()) {
+    throw std::invalid_argument("bad size: " + s);
+  }
+  return n;
+}
+
+auto parse_mix(const std::string& s) -> generator_config::opcode_mix {
+  generator_config::opcode_mix mix;
+  char c1, c2, c3;
+  std::istringstream in(s);
+  if (!(in >> mix.add >> c1 >> mix.mul >> c2 >> mix.less_than >> c3 >> mix.equals) || c1 != ',' || c2 != ',' || c3 != ',')
+    throw std::invalid_argument("bad opcode mix: " + s);
+  return mix;
+}
+
+auto open(const std::string& filename) -> std::ofstream {
+  std::ofstream out(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!out) throw std::runtime_error("unable to open " + filename);
+  return out;
+}
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "intcode_generate";
+  generator_config cfg;
+  std::string base = "generated";
+  bool usage = false;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const bool has_arg = i + 1 < argc;
+      if (std::strcmp(argv[i], "--words") == 0 && has_arg) {
+        cfg.words = parse_size(argv[++i]);
+      } else if (std::strcmp(argv[i], "--depth") == 0 && has_arg) {
+        cfg.loop_depth = std::stoul(argv[++i]);
+      } else if (std::strcmp(argv[i], "--iterations") == 0 && has_arg) {
+        cfg.loop_iterations = std::stoul(argv[++i]);
+      } else if (std::strcmp(argv[i], "--body") == 0 && has_arg) {
+        cfg.body_size = std::stoul(argv[++i]);
+      } else if (std::strcmp(argv[i], "--mix") == 0 && has_arg) {
+        cfg.mix = parse_mix(argv[++i]);
+      } else if (std::strcmp(argv[i], "--footprint") == 0 && has_arg) {
+        cfg.footprint = parse_size(argv[++i]);
+      } else if (std::strcmp(argv[i], "--io-rate") == 0 && has_arg) {
+        cfg.io_rate = std::stod(argv[++i]);
+      } else if (std::strcmp(argv[i], "--self-modify-rate") == 0 && has_arg) {
+        cfg.self_modify_rate = std::stod(argv[++i]);
+      } else if (std::strcmp(argv[i], "--seed") == 0 && has_arg) {
+        cfg.seed = std::stoull(argv[++i]);
+      } else if (std::strcmp(argv[i], "-o") == 0 && has_arg) {
+        base = argv[++i];
+      } else {
+        usage = true;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    usage = true;
+  }
+
+  if (usage) {
+    std::cerr << "Usage: " << progname << " [options] [-o base]\n"
+        << "\n"
+        << "Writes a generated program to base.txt, its input to base.input and its\n"
+        << "expected output to base.expected (default base: generated).\n"
+        << "The same options and seed always generate the same program.\n"
+        << "\n"
+        << "  --words n            program size in memory cells; K, M and G suffixes allowed (default 4096)\n"
+        << "  --depth n            loop nesting depth (default 2)\n"
+        << "  --iterations n       maximum iterations of each loop (default 10)\n"
+        << "  --body n             instructions in each loop body (default 16)\n"
+        << "  --mix a,m,l,e        relative frequency of add, mul, less_than, equals (default 4,1,1,1)\n"
+        << "  --footprint n        data cells (default 256)\n"
+        << "  --io-rate f          fraction of body instructions doing I/O (default 0)\n"
+        << "  --self-modify-rate f fraction of body instructions patching code (default 0)\n"
+        << "  --seed n             random seed (default 1)\n";
+    return 1;
+  }
+
+  try {
+    const program_generator gen(cfg);
+    auto program = open(base + ".txt");
+    auto input = open(base + ".input");
+    auto expected = open(base + ".expected");
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto s = gen.generate(program, input, expected);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+
+    std::cerr << s.words << " words, " << s.segments << " segments, "
+        << s.instructions << " instructions to halt, "
+        << s.inputs << " inputs, " << s.outputs << " outputs; generated in "
+        << elapsed.count() << "s" << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,295 @@
+#include <int_computer.hh>
+#include <result_cache.hh>
+#include <telemetry.hh>
+#include <thread_pool.hh>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+using value_type = int_computer_state::value_type;
+
+///\brief Program images, loaded and parsed once per file name.
+class program_cache {
+  public:
+  using pointer = std::shared_ptr<const int_computer_state>;
+
+  auto get(const std::string& filename) -> pointer {
+    std::unique_lock<std::mutex> lck{ mtx_ };
+    const auto iter = programs_.find(filename);
+    if (iter != programs_.end()) {
+      const auto future = iter->second;
+      lck.unlock();
+      return future.get();
+    }
+
+    // Load outside the lock, so other programs can load concurrently.
+    std::promise<pointer> promise;
+    programs_.emplace(filename, promise.get_future().share());
+    lck.unlock();
+
+    try {
+      auto file = std::ifstream(filename);
+      if (!file) throw std::runtime_error("unable to open " + filename);
+      auto program = std::make_shared<const int_computer_state>(int_computer_state::parse(file));
+      promise.set_value(program);
+      return program;
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+  }
+
+  private:
+  std::mutex mtx_;
+  std::unordered_map<std::string, std::shared_future<pointer>> programs_;
+};
+
+struct job {
+  std::size_t line;
+  std::string program;
+  std::vector<value_type> inputs;
+};
+
+///\brief Parse a manifest line: a program file name, followed by its inputs.
+///\details Inputs are separated by white space or commas.
+auto parse_job(std::size_t line, std::string_view text) -> job {
+  const auto is_sep = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == ','; };
+
+  job result{ line, {}, {} };
+  std::size_t pos = 0;
+  while (pos < text.size() && is_sep(text[pos])) ++pos;
+  const std::size_t program_end = std::min(text.find_first_of(" \t\r", pos), text.size());
+  result.program = std::string(text.substr(pos, program_end - pos));
+
+  for (pos = program_end; pos < text.size(); ) {
+    if (is_sep(text[pos])) {
+      ++pos;
+      continue;
+    }
+
+    value_type v;
+    const auto [ptr, ec] = std::from_chars(text.data() + pos, text.data() + text.size(), v);
+    if (ec != std::errc() || (ptr != text.data() + text.size() && !is_sep(*ptr)))
+      throw std::invalid_argument("invalid input value in manifest line " + std::to_string(line));
+    result.inputs.push_back(v);
+    pos = ptr - text.data();
+  }
+  return result;
+}
+
+///\brief Per job limits.
+struct job_limits {
+  std::uint64_t max_steps = 0; ///< Zero for no limit.
+  std::chrono::milliseconds timeout{ 0 }; ///< Zero for no limit.
+
+  auto budget() const -> eval_budget {
+    eval_budget b;
+    if (max_steps != 0u) b = std::move(b).with_steps(max_steps);
+    if (timeout.count() != 0) b = std::move(b).with_deadline(eval_budget::clock::now() + timeout);
+    return b;
+  }
+};
+
+auto run(const int_computer_state& program, const std::vector<value_type>& inputs, const job_limits& limits) -> std::vector<value_type> {
+  std::vector<value_type> outputs;
+  int_computer_state ic = program;
+  auto next_input = inputs.begin();
+  ic.read_cb = [&inputs, &next_input]() -> value_type {
+    if (next_input == inputs.end()) throw io_error("job ran out of input");
+    return *next_input++;
+  };
+  ic.write_cb = [&outputs](value_type v) { outputs.push_back(v); };
+
+  auto budget = limits.budget();
+  if (ic.eval(budget) == int_computer_state::io_pending::budget_exhausted)
+    throw std::runtime_error("budget exhausted at pc=" + std::to_string(ic.pc()));
+  return outputs;
+}
+
+///\brief Writes result lines as jobs complete.
+class result_writer {
+  public:
+  explicit result_writer(std::ostream& out)
+  : out_(out)
+  {}
+
+  void ok(std::size_t line, std::chrono::microseconds t, const std::vector<value_type>& outputs, bool cached = false) {
+    std::ostringstream s;
+    s << line << (cached ? "\tcached\t" : "\tok\t") << t.count() << "\t";
+    bool first = true;
+    for (const auto& v : outputs) {
+      if (!std::exchange(first, false)) s << ",";
+      s << v;
+    }
+    write_(s.str());
+  }
+
+  void error(std::size_t line, std::chrono::microseconds t, const std::string& what) {
+    ++failed_;
+    std::ostringstream s;
+    s << line << "\terror\t" << t.count() << "\t" << what;
+    write_(s.str());
+  }
+
+  auto failed() const noexcept -> std::size_t { return failed_; }
+
+  private:
+  void write_(const std::string& line) {
+    std::lock_guard<std::mutex> lck{ mtx_ };
+    out_ << line << std::endl;
+  }
+
+  std::mutex mtx_;
+  std::ostream& out_;
+  std::atomic<std::size_t> failed_{ 0 };
+};
+
+///\brief Parse a non-negative decimal option value.
+///\return False unless all of \p text is a number that fits in \p v.
+auto parse_option(const char* text, std::uint64_t& v) -> bool {
+  const char* const end = text + std::strlen(text);
+  const auto [ptr, ec] = std::from_chars(text, end, v);
+  return ec == std::errc() && ptr == end && ptr != text;
+}
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "intcode_runner";
+  unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+  const char* manifest = nullptr;
+  const char* cache_dir = nullptr;
+  std::uint64_t cache_size_mb = 256;
+  job_limits limits;
+
+  for (int i = 1; i < argc; ++i) {
+    bool valid = true;
+    std::uint64_t n = 0;
+    if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      valid = parse_option(argv[++i], n) && n <= std::numeric_limits<unsigned int>::max();
+      threads = std::max(unsigned(n), 1u);
+    } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+      valid = parse_option(argv[++i], cache_size_mb) && cache_size_mb <= (std::numeric_limits<std::uint64_t>::max() >> 20);
+    } else if (std::strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+      valid = parse_option(argv[++i], n);
+      limits.max_steps = n;
+    } else if (std::strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc) {
+      // The deadline is computed as now() + timeout, which must not overflow.
+      const auto max_timeout = std::chrono::duration_cast<std::chrono::milliseconds>(eval_budget::clock::duration::max()) / 2;
+      valid = parse_option(argv[++i], n) && n <= std::uint64_t(max_timeout.count());
+      limits.timeout = std::chrono::milliseconds(n);
+    } else if (manifest == nullptr && argv[i][0] != '-') {
+      manifest = argv[i];
+    } else {
+      valid = false;
+    }
+
+    if (!valid) {
+      std::cerr << "Usage: " << progname << " [-j threads] [--cache dir [--cache-size MiB]]"
+          << " [--max-steps n] [--timeout-ms t] [manifest]\n"
+          << "\n"
+          << "Each manifest line holds a program file, followed by its inputs:\n"
+          << "  day5_part1.txt 5\n"
+          << "Results are written as jobs complete:\n"
+          << "  line<TAB>ok|cached|error<TAB>microseconds<TAB>outputs or error message\n"
+          << "With --cache, outputs of previous runs are reused from the cache directory.\n"
+          << "Jobs exceeding --max-steps instructions or --timeout-ms milliseconds fail.\n"
+          << "If INT_COMPUTER_METRICS names a file (or unix:socket), live counters are published there.\n";
+      return 1;
+    }
+  }
+
+  try {
+    std::ifstream manifest_file;
+    if (manifest != nullptr) {
+      manifest_file.open(manifest);
+      if (!manifest_file) throw std::runtime_error(std::string("unable to open ") + manifest);
+    }
+    std::istream& in = (manifest != nullptr ? manifest_file : std::cin);
+
+    program_cache programs;
+    result_writer results(std::cout);
+    std::unique_ptr<result_cache> cache;
+    if (cache_dir != nullptr) cache = std::make_unique<result_cache>(cache_dir, cache_size_mb << 20);
+    const auto metrics = telemetry_dumper::from_env();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::size_t jobs = 0;
+    {
+      thread_pool pool(threads);
+      std::string text;
+      for (std::size_t line = 1; std::getline(in, text); ++line) {
+        const auto first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos || text[first] == '#') continue;
+
+        ++jobs;
+        pool.submit(
+            [&programs, &results, &cache, &limits, line, text]() {
+              auto start = std::chrono::steady_clock::now();
+              try {
+                const job j = parse_job(line, text);
+                const auto program = programs.get(j.program);
+                start = std::chrono::steady_clock::now();
+
+                std::optional<result_cache::key> key;
+                if (cache != nullptr) {
+                  key = result_cache::machine_key(*program, j.inputs);
+                  if (const auto cached = cache->lookup(*key)) {
+                    results.ok(line,
+                        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start),
+                        *cached, true);
+                    return;
+                  }
+                }
+
+                const auto outputs = run(*program, j.inputs, limits);
+                const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                if (key.has_value()) {
+                  try {
+                    cache->store(*key, outputs);
+                  } catch (const std::exception& e) {
+                    std::cerr << "unable to store result of line " << line << ": " << e.what() << "\n";
+                  }
+                }
+                results.ok(line, elapsed, outputs);
+              } catch (const std::exception& e) {
+                results.error(line,
+                    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start),
+                    e.what());
+              }
+            });
+      }
+      pool.wait();
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+    std::cerr << jobs << " jobs (" << results.failed() << " failed) on " << threads << " threads in "
+        << elapsed.count() << "s, " << jobs / elapsed.count() << " jobs/s" << std::endl;
+    if (cache != nullptr)
+      std::cerr << "cache: " << cache->hits() << " hits, " << cache->misses() << " misses" << std::endl;
+    return results.failed() == 0u ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,167 @@
+#include <amplifier.hh>
+#include <int_computer.hh>
+#include <process_search.hh>
+#include <result_cache.hh>
+#include <telemetry.hh>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+using value_type = int_computer_state::value_type;
+
+///\brief The \p idx'th permutation, in lexicographic order, of \p n phase settings starting at \p first.
+auto nth_permutation(std::uint64_t idx, unsigned int n, int first) -> std::vector<int> {
+  std::vector<int> available(n);
+  for (unsigned int i = 0; i < n; ++i) available[i] = first + int(i);
+
+  std::vector<std::uint64_t> factorial(n + 1u, 1u);
+  for (unsigned int i = 1; i <= n; ++i) factorial[i] = factorial[i - 1u] * i;
+
+  std::vector<int> result;
+  result.reserve(n);
+  for (unsigned int i = n; i > 0; --i) {
+    const std::uint64_t pos = idx / factorial[i - 1u];
+    idx %= factorial[i - 1u];
+    result.push_back(available[pos]);
+    available.erase(available.begin() + pos);
+  }
+  return result;
+}
+
+auto load_program(const std::string& filename) -> int_computer_state {
+  auto file = std::ifstream(filename);
+  if (!file) throw std::runtime_error("unable to open " + filename);
+  return int_computer_state::parse(file);
+}
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "intcode_search";
+  unsigned int workers = std::max(std::thread::hardware_concurrency(), 1u);
+  std::uint64_t range_size = 64;
+  unsigned int retries = 3;
+  unsigned int amplifiers = 5;
+  const char* cache_dir = nullptr;
+  std::uint64_t cache_size_mb = 256;
+  std::vector<const char*> args;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      workers = std::max(std::stoul(argv[++i]), 1ul);
+    } else if (std::strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+      range_size = std::max(std::stoull(argv[++i]), 1ull);
+    } else if (std::strcmp(argv[i], "--retries") == 0 && i + 1 < argc) {
+      retries = std::stoul(argv[++i]);
+    } else if (std::strcmp(argv[i], "--amplifiers") == 0 && i + 1 < argc) {
+      amplifiers = std::stoul(argv[++i]);
+    } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+      cache_size_mb = std::stoull(argv[++i]);
+    } else if (argv[i][0] != '-') {
+      args.push_back(argv[i]);
+    } else {
+      args.clear();
+      break;
+    }
+  }
+
+  const bool nounverb = args.size() == 3u && std::strcmp(args[0], "nounverb") == 0;
+  const bool phases = (args.size() == 2u || args.size() == 3u) && std::strcmp(args[0], "phases") == 0;
+  if ((!nounverb && !phases) || amplifiers == 0u || amplifiers > 20u) {
+    std::cerr << "Usage: " << progname << " [-j workers] [--range n] [--retries n] nounverb program target\n"
+        << "       " << progname << " [-j workers] [--range n] [--retries n] [--amplifiers n]\n"
+        << "           [--cache dir [--cache-size MiB]] phases program [first_phase]\n"
+        << "\n"
+        << "Searches in worker processes, which claim ranges of candidates from shared memory.\n"
+        << "A range whose worker crashes is retried by a new worker, up to --retries times.\n"
+        << "\n"
+        << "nounverb: find the highest 100*noun+verb for which the program computes target.\n"
+        << "phases:   find the phase settings giving the highest amplifier chain output.\n"
+        << "          Phase settings start at first_phase (default 5); settings of 5 and up\n"
+        << "          run the chain in a feedback loop. With --cache, chain outputs of\n"
+        << "          previous searches are reused from the cache directory.\n";
+    return 1;
+  }
+
+  try {
+    const int_computer_state program = load_program(args[1]);
+    const auto metrics = telemetry_dumper::from_env();
+
+    std::uint64_t count;
+    process_search::evaluate_fn fn;
+    int first_phase = 5;
+    if (nounverb) {
+      const value_type target = std::stoll(args[2]);
+      count = 100u * 100u;
+      fn = [target](const int_computer_state& program, std::uint64_t candidate) -> std::optional<value_type> {
+        auto testcase = program;
+        testcase[1] = value_type(candidate / 100u);
+        testcase[2] = value_type(candidate % 100u);
+        if (testcase.eval_and_get() != target) return {};
+        return value_type(candidate);
+      };
+    } else {
+      if (args.size() == 3u) first_phase = std::stoi(args[2]);
+      count = 1;
+      for (unsigned int i = 2; i <= amplifiers; ++i) count *= i;
+
+      const bool feedback = first_phase >= 5;
+      // Each worker builds its own caches and chain, on its first candidate.
+      std::shared_ptr<phase_cache> cache;
+      std::shared_ptr<amplifier_chain> chain;
+      std::shared_ptr<result_cache> results;
+      fn = [=](const int_computer_state& program, std::uint64_t candidate) mutable -> std::optional<value_type> {
+        if (cache == nullptr) {
+          cache = std::make_shared<phase_cache>(program);
+          chain = std::make_shared<amplifier_chain>();
+          if (cache_dir != nullptr) results = std::make_shared<result_cache>(cache_dir, cache_size_mb << 20);
+        }
+        const auto settings = nth_permutation(candidate, amplifiers, first_phase);
+        const auto run = [&]() -> value_type {
+          chain->reset(settings.begin(), settings.end(), *cache);
+          return feedback ? chain->feedback_eval(0) : (*chain)(0);
+        };
+        if (results == nullptr) return run();
+
+        const auto key = result_cache::chain_key(program, std::vector<value_type>(settings.begin(), settings.end()), 0, feedback);
+        return results->get(key, [&run]() { return std::vector<value_type>{ run() }; }).at(0);
+      };
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto result = process_search(workers, range_size, retries).run(program, count, fn);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+
+    if (result.best.has_value()) {
+      std::cout << *result.best;
+      if (phases) {
+        std::cout << "\t";
+        bool first = true;
+        for (const int s : nth_permutation(result.candidate, amplifiers, first_phase))
+          std::cout << (std::exchange(first, false) ? "" : ",") << s;
+      }
+      std::cout << std::endl;
+    }
+    std::cerr << result.evaluated << " of " << count << " candidates on " << workers << " workers in "
+        << elapsed.count() << "s; " << result.crashes << " crashed workers, "
+        << result.retried_ranges << " retried ranges, " << result.failed_ranges << " failed ranges" << std::endl;
+
+    if (result.failed_ranges != 0u) return 2;
+    return result.best.has_value() ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,304 @@
+#include <control_flow.hh>
+#include <int_computer.hh>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using value_type = int_computer_state::value_type;
+using size_type = int_computer_state::size_type;
+using operand = control_flow_graph::operand;
+using decoded_instruction = control_flow_graph::decoded_instruction;
+using basic_block = control_flow_graph::basic_block;
+
+
+class emitter {
+  public:
+  emitter(std::ostream& out, const int_computer_state& image)
+  : out_(out),
+    image_(image),
+    cfg_(image)
+  {}
+
+  void emit(const std::string& name, bool with_main) {
+    emit_prologue_();
+    for (const auto& b : cfg_.blocks()) emit_block_(b);
+    emit_entry_(name);
+    if (with_main) emit_main_(name);
+  }
+
+  private:
+  void emit_prologue_() {
+    out_ << "// Generated by intcode_transpile. Do not edit.\n"
+        << "#include <buffered_io.hh>\n"
+        << "#include <int_computer.hh>\n"
+        << "#include <algorithm>\n"
+        << "#include <exception>\n"
+        << "#include <iostream>\n"
+        << "#include <iterator>\n"
+        << "#include <utility>\n"
+        << "\n"
+        << "namespace {\n"
+        << "\n"
+        << "using value_type = int_computer_state::value_type;\n"
+        << "using size_type = int_computer_state::size_type;\n"
+        << "\n"
+        << "constexpr value_type image[] = {";
+    for (size_type i = 0; i < image_.size(); ++i) {
+      if (i % 16u == 0u) out_ << "\n   ";
+      out_ << " " << image_[i] << ",";
+    }
+    out_ << "\n};\n"
+        << "\n"
+        << "// Ranges of instruction words the blocks were compiled from.\n"
+        << "constexpr size_type code_ranges[][2] = {";
+    for (size_type i = 0; i < image_.size(); ) {
+      if (!cfg_.is_code(i)) {
+        ++i;
+        continue;
+      }
+      const size_type begin = i;
+      while (cfg_.is_code(i)) ++i;
+      out_ << "\n    { " << begin << "u, " << i << "u },";
+    }
+    out_ << "\n    { 0u, 0u }\n};\n"
+        << "\n"
+        << "struct context {\n"
+        << "  int_computer_state& s;\n"
+        << "  value_type* m;\n"
+        << "  size_type pc;\n"
+        << "  bool dirty; // Code may differ from the image.\n"
+        << "  bool exit; // Program halted.\n"
+        << "};\n"
+        << "\n"
+        << "[[maybe_unused]] auto read_(context& c) -> value_type {\n"
+        << "  if (!c.s.read_cb) throw io_error(\"no input\");\n"
+        << "  return c.s.read_cb();\n"
+        << "}\n"
+        << "\n"
+        << "[[maybe_unused]] void write_(context& c, value_type v) {\n"
+        << "  if (!c.s.write_cb) throw io_error(\"no output\");\n"
+        << "  c.s.write_cb(v);\n"
+        << "}\n"
+        << "\n"
+        << "auto matches_image(const int_computer_state& s) -> bool {\n"
+        << "  if (s.size() != std::size(image)) return false;\n"
+        << "  for (const auto& r : code_ranges) {\n"
+        << "    if (!std::equal(s.begin() + r[0], s.begin() + r[1], image + r[0])) return false;\n"
+        << "  }\n"
+        << "  return true;\n"
+        << "}\n"
+        << "\n"
+        << "auto is_code_(value_type addr) -> bool {\n"
+        << "  for (const auto& r : code_ranges) {\n"
+        << "    if (addr >= value_type(r[0]) && addr < value_type(r[1])) return true;\n"
+        << "  }\n"
+        << "  return false;\n"
+        << "}\n"
+        << "\n"
+        << "// Address the instruction at pc stores to, or -1 if it doesn't store.\n"
+        << "auto store_target_(const context& c) -> value_type {\n"
+        << "  size_type out;\n"
+        << "  switch (c.m[c.pc] % 100) {\n"
+        << "    case 1: case 2: case 7: case 8: out = c.pc + 3u; break;\n"
+        << "    case 3: out = c.pc + 1u; break;\n"
+        << "    default: return -1;\n"
+        << "  }\n"
+        << "  return out < c.s.size() ? c.m[out] : -1;\n"
+        << "}\n"
+        << "\n"
+        << "void interpret_(context& c) {\n"
+        << "  c.s.jump(c.pc);\n"
+        << "  if (c.s.is_halt()) {\n"
+        << "    c.exit = true;\n"
+        << "    return;\n"
+        << "  }\n"
+        << "  const value_type target = store_target_(c);\n"
+        << "  c.s.eval1();\n"
+        << "  c.pc = c.s.pc();\n"
+        << "  if (is_code_(target)) c.dirty = true;\n"
+        << "}\n"
+        << "\n"
+        << "// Once the code may have been modified, a block is only entered\n"
+        << "// if its instruction words still match the image.\n"
+        << "auto enter_(context& c, size_type begin, size_type end) -> bool {\n"
+        << "  if (!c.dirty || std::equal(c.m + begin, c.m + end, image + begin)) return true;\n"
+        << "  interpret_(c);\n"
+        << "  return false;\n"
+        << "}\n";
+  }
+
+  auto operand_(const operand& arg) const -> std::string {
+    if (arg.mode == addressing_mode::immediate)
+      return "value_type(" + std::to_string(arg.value) + ")";
+    return "m[" + std::to_string(arg.value) + "]";
+  }
+
+  static auto same_(const operand& x, const operand& y) noexcept -> bool {
+    return x.mode == y.mode && x.value == y.value;
+  }
+
+  void emit_store_(const decoded_instruction& d, const std::string& expr) {
+    const auto target = d.output().value;
+    out_ << "  m[" << target << "] = " << expr << ";\n";
+    if (cfg_.is_code(target)) {
+      // Self-modifying code: compiled blocks must be validated from here on.
+      out_ << "  c.pc = " << d.next() << "u;\n"
+          << "  c.dirty = true;\n"
+          << "  return;\n";
+    }
+  }
+
+  void emit_jump_(const decoded_instruction& d, const char* cond) {
+    out_ << "  c.pc = (" << operand_(d.args[0]) << cond << ")\n"
+        << "      ? static_cast<size_type>(" << operand_(d.args[1]) << ")\n"
+        << "      : " << d.next() << "u;\n";
+  }
+
+  void emit_block_(const basic_block& b) {
+    out_ << "\n"
+        << "void block_" << b.begin << "(context& c) {\n"
+        << "  [[maybe_unused]] value_type* const m = c.m;\n";
+
+    for (const auto& d : b.instrs) {
+      out_ << "  // pc=" << d.pc << "\n";
+      switch (d.op) {
+        case opcode::add:
+          emit_store_(d, operand_(d.args[0]) + " + " + operand_(d.args[1]));
+          break;
+        case opcode::mul:
+          emit_store_(d, operand_(d.args[0]) + " * " + operand_(d.args[1]));
+          break;
+        case opcode::less_than:
+          // Identical operands are folded, as comparing a cell to itself draws warnings.
+          if (same_(d.args[0], d.args[1]))
+            emit_store_(d, "value_type(0)");
+          else
+            emit_store_(d, operand_(d.args[0]) + " < " + operand_(d.args[1]) + " ? 1 : 0");
+          break;
+        case opcode::equals:
+          if (same_(d.args[0], d.args[1]))
+            emit_store_(d, "value_type(1)");
+          else
+            emit_store_(d, operand_(d.args[0]) + " == " + operand_(d.args[1]) + " ? 1 : 0");
+          break;
+        case opcode::read:
+          emit_store_(d, "read_(c)");
+          break;
+        case opcode::write:
+          out_ << "  write_(c, " << operand_(d.args[0]) << ");\n";
+          break;
+        case opcode::jump_if_true:
+          emit_jump_(d, " != 0");
+          return close_block_();
+        case opcode::jump_if_false:
+          emit_jump_(d, " == 0");
+          return close_block_();
+        case opcode::halt:
+          out_ << "  c.pc = " << d.pc << "u;\n"
+              << "  c.exit = true;\n";
+          return close_block_();
+      }
+    }
+
+    out_ << "  c.pc = " << b.end << "u;\n";
+    close_block_();
+  }
+
+  void close_block_() {
+    out_ << "}\n";
+  }
+
+  void emit_entry_(const std::string& name) {
+    out_ << "\n"
+        << "} /* namespace <unnamed> */\n"
+        << "\n"
+        << "///\\brief Equivalent to int_computer_state::eval(), for the compiled program.\n"
+        << "///\\details Instructions outside compiled blocks, and blocks whose code\n"
+        << "///was modified, are executed by the interpreter.\n"
+        << "auto " << name << "(int_computer_state& s) -> int_computer_state& {\n"
+        << "  if (s.size() != std::size(image)) return s.eval();\n"
+        << "\n"
+        << "  const bool dirty = !matches_image(std::as_const(s));\n"
+        << "  context c{ s, &*s.begin(), s.pc(), dirty, false };\n"
+        << "  while (!c.exit) {\n"
+        << "    switch (c.pc) {\n"
+        << "      default:\n"
+        << "        interpret_(c);\n"
+        << "        break;\n";
+    for (const auto& b : cfg_.blocks()) {
+      out_ << "      case " << b.begin << "u: if (enter_(c, " << b.begin << "u, " << b.end << "u)) "
+          << "block_" << b.begin << "(c); break;\n";
+    }
+    out_ << "    }\n"
+        << "  }\n"
+        << "\n"
+        << "  s.jump(c.pc);\n"
+        << "  return s.eval();\n"
+        << "}\n";
+  }
+
+  void emit_main_(const std::string& name) {
+    out_ << "\n"
+        << "int main() {\n"
+        << "  try {\n"
+        << "    int_computer_state ic(std::begin(image), std::end(image));\n"
+        << "    buffered_io io;\n"
+        << "    io.attach(ic);\n"
+        << "\n"
+        << "    " << name << "(ic);\n"
+        << "    io.flush();\n"
+        << "  } catch (const std::exception& e) {\n"
+        << "    std::cerr << e.what() << std::endl;\n"
+        << "    return 1;\n"
+        << "  }\n"
+        << "}\n";
+  }
+
+  std::ostream& out_;
+  const int_computer_state& image_;
+  const control_flow_graph cfg_;
+};
+
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "intcode_transpile";
+  std::string name = "transpiled_eval";
+  std::string output;
+  std::string input;
+  bool with_main = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--main") {
+      with_main = true;
+    } else if (arg == "--name" && i + 1 < argc) {
+      name = argv[++i];
+    } else if (arg == "-o" && i + 1 < argc) {
+      output = argv[++i];
+    } else if (input.empty() && arg.substr(0, 1) != "-") {
+      input = arg;
+    } else {
+      std::cerr << "Usage: " << progname << " [--main] [--name function] [-o output.cc] program.txt" << std::endl;
+      return 1;
+    }
+  }
+
+  try {
+    auto in = std::ifstream(input);
+    if (input.empty() || !in) throw std::runtime_error("unable to open program " + input);
+    const auto image = int_computer_state::parse(in);
+
+    std::ofstream out_file;
+    if (!output.empty()) {
+      out_file.open(output);
+      if (!out_file) throw std::runtime_error("unable to create " + output);
+    }
+
+    emitter(output.empty() ? std::cout : out_file, image).emit(name, with_main);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,95 @@
+#include <orbit_table.hh>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+///\brief Generate an orbit map with \p n bodies.
+///\details
+///In a shallow map, each body orbits a uniformly chosen earlier body,
+///giving logarithmic depth.
+///In a deep map, each body orbits one of the 4 bodies before it,
+///giving depth linear in \p n.
+auto generate(std::size_t n, bool deep) -> std::string {
+  std::mt19937_64 rng(n);
+  std::string text;
+  text.reserve(n * 20u);
+  for (std::size_t i = 1; i < n; ++i) {
+    const std::size_t window = deep ? std::min<std::size_t>(i, 4u) : i;
+    const std::size_t parent = i - 1u - rng() % window;
+    text += 'B';
+    text += std::to_string(parent);
+    text += ")B";
+    text += std::to_string(i);
+    text += '\n';
+  }
+  return text;
+}
+
+auto time_depths(const orbit_table& t, unsigned int threads, std::uint64_t& total) -> double {
+  double best = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    const auto t0 = std::chrono::steady_clock::now();
+    total = t.total_orbits(threads);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+    if (i == 0 || elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "orbit_depth_bench";
+  bool deep = false;
+  if (argc >= 2 && std::strcmp(argv[1], "--deep") == 0) {
+    deep = true;
+    --argc;
+    ++argv;
+  }
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: " << progname << " [--deep] bodies [max_threads]" << std::endl;
+    return 1;
+  }
+
+  try {
+    const std::size_t n = std::stoull(argv[1]);
+    const unsigned int max_threads = (argc == 3
+        ? std::stoul(argv[2])
+        : std::max(std::thread::hardware_concurrency(), 1u));
+
+    const std::string text = generate(n, deep);
+    const auto t = orbit_table::parse(text, max_threads);
+    std::cout << t.size() << " bodies, " << (deep ? "deep" : "shallow") << " map\n";
+
+    std::uint64_t expected = 0;
+    const double baseline = time_depths(t, 1, expected);
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int threads = 1; threads < max_threads; threads *= 2u) thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    std::cout << "threads    seconds   Mbodies/s  speedup\n";
+    for (const unsigned int threads : thread_counts) {
+      std::uint64_t total;
+      const double elapsed = (threads == 1u ? baseline : time_depths(t, threads, total));
+      if (threads != 1u && total != expected)
+        throw std::runtime_error("total orbits mismatch at " + std::to_string(threads) + " threads");
+
+      std::cout << std::setw(7) << threads
+          << std::fixed << std::setprecision(4) << std::setw(11) << elapsed
+          << std::setprecision(2) << std::setw(12) << t.size() / elapsed / 1e6
+          << std::setw(9) << baseline / elapsed << "\n";
+    }
+    std::cout << "total orbits: " << expected << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
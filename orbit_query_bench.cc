@@ -0,0 +1,108 @@
+#include <orbit_distance.hh>
+#include <orbit_table.hh>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+///\brief Generate an orbit map with \p n bodies.
+///\details
+///In a shallow map, each body orbits a uniformly chosen earlier body.
+///In a deep map, each body orbits one of the 4 bodies before it.
+auto generate(std::size_t n, bool deep) -> std::string {
+  std::mt19937_64 rng(n);
+  std::string text;
+  text.reserve(n * 20u);
+  for (std::size_t i = 1; i < n; ++i) {
+    const std::size_t window = deep ? std::min<std::size_t>(i, 4u) : i;
+    const std::size_t parent = i - 1u - rng() % window;
+    text += 'B';
+    text += std::to_string(parent);
+    text += ")B";
+    text += std::to_string(i);
+    text += '\n';
+  }
+  return text;
+}
+
+template<typename Fn>
+auto best_of_3(Fn fn) -> double {
+  double best = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    const auto t0 = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+    if (i == 0 || elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "orbit_query_bench";
+  bool deep = false;
+  if (argc >= 2 && std::strcmp(argv[1], "--deep") == 0) {
+    deep = true;
+    --argc;
+    ++argv;
+  }
+  if (argc < 3 || argc > 4) {
+    std::cerr << "Usage: " << progname << " [--deep] bodies queries [max_threads]" << std::endl;
+    return 1;
+  }
+
+  try {
+    const std::size_t n = std::stoull(argv[1]);
+    const std::size_t nqueries = std::stoull(argv[2]);
+    const unsigned int max_threads = (argc == 4
+        ? std::stoul(argv[3])
+        : std::max(std::thread::hardware_concurrency(), 1u));
+
+    const std::string text = generate(n, deep);
+    const auto t = orbit_table::parse(text, max_threads);
+    const orbit_distance_index idx(t);
+    std::cout << t.size() << " bodies, " << (deep ? "deep" : "shallow") << " map, "
+        << nqueries << " queries\n";
+
+    std::mt19937_64 rng(nqueries);
+    std::vector<orbit_distance_index::query> queries(nqueries);
+    for (auto& q : queries) q = { rng() % t.size(), rng() % t.size() };
+    std::vector<orbit_distance_index::id_type> expected(nqueries), result(nqueries);
+
+    const double unbatched = best_of_3(
+        [&]() {
+          for (std::size_t i = 0; i < nqueries; ++i)
+            expected[i] = idx.distance(queries[i].first, queries[i].second);
+        });
+    std::cout << "unbatched      " << std::fixed << std::setprecision(4) << std::setw(9) << unbatched
+        << std::setprecision(2) << std::setw(12) << nqueries / unbatched / 1e6 << " Mqueries/s\n";
+
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int threads = 1; threads < max_threads; threads *= 2u) thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    for (const unsigned int threads : thread_counts) {
+      const double elapsed = best_of_3(
+          [&]() {
+            idx.distances(queries.data(), queries.data() + queries.size(), result.data(), threads);
+          });
+      if (result != expected)
+        throw std::runtime_error("batch result mismatch at " + std::to_string(threads) + " threads");
+
+      std::cout << "batch, " << std::setw(2) << threads << " thr"
+          << std::fixed << std::setprecision(4) << std::setw(9) << elapsed
+          << std::setprecision(2) << std::setw(12) << nqueries / elapsed / 1e6 << " Mqueries/s\n";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -1,12 +1,22 @@
 #include <amplifier.hh>
+#include <control_flow.hh>
 #include <stdexcept>
 #include <utility>
 
 
-amplifier::amplifier(int_computer_state program, int phase_setting)
-: s_(std::move(program))
+feedback_loop_error::feedback_loop_error(std::size_t period)
+: std::runtime_error("feedback loop does not halt"),
+  period_(period)
+{}
+
+feedback_loop_error::~feedback_loop_error() = default;
+
+
+amplifier::amplifier(int_computer_state program, int phase_setting, std::shared_ptr<const control_flow_graph> cfg)
+: s_(std::move(program)),
+  cfg_(std::move(cfg))
 {
-  auto io = s_.eval_until_io_or_halt();
+  auto io = eval_until_io_or_halt_();
   if (io != int_computer_state::io_pending::read)
     throw bad_program_error("first input must be phase setting readout");
 
@@ -17,6 +27,15 @@ amplifier::amplifier(int_computer_state program, int phase_setting)
   eval_until_read_or_halt_();
 }
 
+auto amplifier::resume(int_computer_state s, std::shared_ptr<const control_flow_graph> cfg) -> amplifier {
+  amplifier result;
+  result.s_ = std::move(s);
+  result.cfg_ = std::move(cfg);
+  // A restored machine doesn't know whether it modified its code.
+  if (result.cfg_ != nullptr && !result.cfg_->matches(result.s_)) result.s_.assume_code_modified();
+  return result;
+}
+
 auto amplifier::operator()(value_type v) -> value_type {
   value_type result;
   if (s_.is_halt()) throw std::runtime_error("amplifier has halted");
@@ -25,7 +44,7 @@ auto amplifier::operator()(value_type v) -> value_type {
   s_.eval1(); // consume the input
   s_.read_cb = nullptr;
 
-  auto io = s_.eval_until_io_or_halt();
+  auto io = eval_until_io_or_halt_();
   if (io != int_computer_state::io_pending::write)
     throw bad_program_error("expected amplifier write");
   s_.write_cb = [&result](value_type v) { result = v; };
@@ -36,8 +55,12 @@ auto amplifier::operator()(value_type v) -> value_type {
   return result;
 }
 
+auto amplifier::eval_until_io_or_halt_() -> int_computer_state::io_pending {
+  return cfg_ ? s_.eval_until_io_or_halt(*cfg_) : s_.eval_until_io_or_halt();
+}
+
 void amplifier::eval_until_read_or_halt_() {
-  switch (s_.eval_until_io_or_halt()) {
+  switch (eval_until_io_or_halt_()) {
     default:
       throw bad_program_error("after phase input, amplifier must perform a read operation");
     case int_computer_state::io_pending::read: [[fallthrough]];
@@ -47,18 +70,38 @@ void amplifier::eval_until_read_or_halt_() {
 }
 
 
+phase_cache::phase_cache(int_computer_state program)
+: program_(std::move(program)),
+  cfg_(std::make_shared<const control_flow_graph>(program_))
+{}
+
+auto phase_cache::get(int phase_setting) -> const amplifier& {
+  std::lock_guard<std::mutex> lck{ mtx_ };
+  auto iter = amps_.find(phase_setting);
+  if (iter == amps_.end())
+    iter = amps_.emplace(phase_setting, amplifier(program_, phase_setting, cfg_)).first;
+  return iter->second;
+}
+
+
 amplifier_chain::amplifier_chain(std::initializer_list<int> phase_settings, const int_computer_state& program)
 : amplifier_chain(phase_settings.begin(), phase_settings.end(), program)
 {}
 
+auto amplifier_chain::make_cfg_(const int_computer_state& program) -> std::shared_ptr<const control_flow_graph> {
+  return std::make_shared<const control_flow_graph>(program);
+}
+
 auto amplifier_chain::operator()(value_type v) -> value_type {
   for (auto& amp : elems_) v = amp(v);
   return v;
 }
 
 auto amplifier_chain::feedback_eval(value_type v) -> value_type {
-  do {
-    v = operator()(v);
-  } while (!is_halt());
+  feedback_eval_(*this, v, std::numeric_limits<std::uint64_t>::max());
   return v;
 }
+
+auto amplifier_chain::feedback_rounds(value_type& v, std::uint64_t max_rounds) -> bool {
+  return feedback_eval_(*this, v, max_rounds);
+}
@@ -0,0 +1,44 @@
+#include <atomic_file.hh>
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+void atomic_replace_file(const std::string& path, std::string_view bytes) {
+  static std::atomic<unsigned int> tmp_counter{ 0 };
+  const auto name_pos = path.rfind('/') + 1u; // Zero if path has no directory.
+  const std::string tmp_path = path.substr(0, name_pos) + "." + path.substr(name_pos)
+      + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(tmp_counter++);
+
+  const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd == -1) throw std::system_error(errno, std::system_category(), "open " + tmp_path);
+
+  int error = 0;
+  const char* op = nullptr;
+  for (std::size_t done = 0; done < bytes.size(); ) {
+    const ::ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+    if (n == -1 && errno == EINTR) continue;
+    if (n == -1) {
+      error = errno;
+      op = "write ";
+      break;
+    }
+    done += n;
+  }
+  // The descriptor is released even if close fails, so it is closed exactly once.
+  if (::close(fd) == -1 && error == 0) {
+    error = errno;
+    op = "close ";
+  }
+  if (error == 0 && ::rename(tmp_path.c_str(), path.c_str()) == -1) {
+    error = errno;
+    op = "rename ";
+  }
+
+  if (error != 0) {
+    ::unlink(tmp_path.c_str());
+    throw std::system_error(error, std::system_category(), op + tmp_path);
+  }
+}
@@ -0,0 +1,103 @@
+#include <buffered_io.hh>
+#include <int_scanner.hh>
+#include <swallow_exceptions.hh>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+
+
+namespace {
+
+///\brief Longest text representation of a value, plus a newline.
+constexpr std::size_t max_value_len = 24;
+
+} /* namespace <unnamed> */
+
+
+buffered_io::buffered_io(int in_fd, int out_fd, std::size_t buffer_size)
+: in_fd_(in_fd),
+  out_fd_(out_fd),
+  buffer_size_(std::max(buffer_size, 2u * max_value_len)),
+  in_buf_(std::make_unique<char[]>(buffer_size_)),
+  out_buf_(std::make_unique<char[]>(buffer_size_))
+{}
+
+buffered_io::~buffered_io() {
+  swallow_exceptions([this]() { flush(); });
+}
+
+auto buffered_io::read() -> value_type {
+  for (;;) {
+    value_type v;
+    switch (scan_int(std::string_view(in_buf_.get(), in_end_), in_pos_, in_eof_, v)) {
+      case scan_status::value:
+        return v;
+      case scan_status::end:
+        throw io_error("unexpected end of input");
+      case scan_status::need_more:
+        break;
+    }
+
+    if (in_pos_ == 0u && in_end_ == buffer_size_) throw io_error("input number too long");
+    fill_();
+  }
+}
+
+void buffered_io::write(value_type v) {
+  if (buffer_size_ - out_end_ < max_value_len) flush();
+
+  char* const b = out_buf_.get() + out_end_;
+  const auto [ptr, ec] = std::to_chars(b, out_buf_.get() + buffer_size_ - 1u, v);
+  *ptr = '\n';
+  out_end_ = ptr + 1 - out_buf_.get();
+}
+
+void buffered_io::flush() {
+  std::size_t written = 0;
+  while (written != out_end_) {
+    const ::ssize_t n = ::write(out_fd_, out_buf_.get() + written, out_end_ - written);
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      const int e = errno;
+      std::memmove(out_buf_.get(), out_buf_.get() + written, out_end_ - written);
+      out_end_ -= written;
+      throw std::system_error(e, std::system_category(), "write");
+    }
+    written += n;
+  }
+  out_end_ = 0;
+}
+
+void buffered_io::attach(int_computer_state& m) {
+  m.read_cb = [this]() -> value_type { return read(); };
+  m.write_cb = [this](value_type v) { write(v); };
+}
+
+///\brief Read more input, after the unconsumed input.
+///\details Flushes output first, as the read may block.
+///\return False on end of input.
+auto buffered_io::fill_() -> bool {
+  if (in_eof_) return false;
+  flush();
+
+  std::memmove(in_buf_.get(), in_buf_.get() + in_pos_, in_end_ - in_pos_);
+  in_end_ -= in_pos_;
+  in_pos_ = 0;
+
+  for (;;) {
+    const ::ssize_t n = ::read(in_fd_, in_buf_.get() + in_end_, buffer_size_ - in_end_);
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      throw std::system_error(errno, std::system_category(), "read");
+    }
+    if (n == 0) {
+      in_eof_ = true;
+      return false;
+    }
+    in_end_ += n;
+    return true;
+  }
+}
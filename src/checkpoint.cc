@@ -0,0 +1,232 @@
+#include <checkpoint.hh>
+#include <atomic_file.hh>
+#include <control_flow.hh>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+
+namespace {
+
+constexpr char magic[8] = { 'I', 'C', 'C', 'K', 'P', 'T', '0', '1' };
+
+volatile std::sig_atomic_t checkpoint_signalled = 0;
+volatile std::sig_atomic_t stop_signalled = 0;
+std::atomic<bool> trigger_exists{ false };
+
+extern "C" void on_checkpoint_signal(int sig) {
+  checkpoint_signalled = 1;
+  if (sig != SIGUSR1) stop_signalled = 1;
+}
+
+///\brief FNV-1a over \p n bytes.
+auto checksum(const char* data, std::size_t n) noexcept -> std::uint64_t {
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (std::size_t i = 0; i < n; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+auto zigzag(std::int64_t v) noexcept -> std::uint64_t {
+  return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+auto unzigzag(std::uint64_t v) noexcept -> std::int64_t {
+  return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1u);
+}
+
+} /* namespace <unnamed> */
+
+
+checkpoint_error::~checkpoint_error() = default;
+
+
+checkpoint_writer::checkpoint_writer()
+: buf_(magic, sizeof(magic))
+{}
+
+void checkpoint_writer::write(std::uint64_t v) {
+  tag_('U');
+  varint_(v);
+}
+
+void checkpoint_writer::write_value(value_type v) {
+  tag_('V');
+  varint_(zigzag(v));
+}
+
+void checkpoint_writer::write(const std::vector<value_type>& v) {
+  tag_('L');
+  varint_(v.size());
+  for (const value_type x : v) varint_(zigzag(x));
+}
+
+void checkpoint_writer::write(const int_computer_state& s) {
+  tag_('M');
+  varint_(s.pc());
+  varint_(s.size());
+  for (const value_type x : s) varint_(zigzag(x));
+}
+
+void checkpoint_writer::write(const amplifier& a) {
+  tag_('A');
+  write(a.state());
+}
+
+void checkpoint_writer::write(const amplifier_chain& c) {
+  begin_chain_(c.size());
+  for (const amplifier& a : c) write(a);
+}
+
+void checkpoint_writer::commit(const std::string& filename) const {
+  std::string data = buf_;
+  const std::uint64_t sum = checksum(data.data(), data.size());
+  data.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+
+  atomic_replace_file(filename, data);
+}
+
+void checkpoint_writer::begin_chain_(std::size_t n) {
+  tag_('C');
+  varint_(n);
+}
+
+///\brief LEB128.
+void checkpoint_writer::varint_(std::uint64_t v) {
+  while (v >= 0x80u) {
+    buf_ += static_cast<char>((v & 0x7fu) | 0x80u);
+    v >>= 7;
+  }
+  buf_ += static_cast<char>(v);
+}
+
+
+checkpoint_reader::checkpoint_reader(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) throw checkpoint_error("unable to open " + filename);
+  data_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+  std::uint64_t sum;
+  if (data_.size() < sizeof(magic) + sizeof(sum)
+      || std::memcmp(data_.data(), magic, sizeof(magic)) != 0)
+    throw checkpoint_error(filename + ": not a checkpoint");
+  std::memcpy(&sum, data_.data() + data_.size() - sizeof(sum), sizeof(sum));
+  data_.resize(data_.size() - sizeof(sum));
+  if (checksum(data_.data(), data_.size()) != sum)
+    throw checkpoint_error(filename + ": checksum mismatch");
+  pos_ = sizeof(magic);
+}
+
+auto checkpoint_reader::read_u64() -> std::uint64_t {
+  expect_('U');
+  return varint_();
+}
+
+auto checkpoint_reader::read_value() -> value_type {
+  expect_('V');
+  return static_cast<value_type>(unzigzag(varint_()));
+}
+
+auto checkpoint_reader::read_values() -> std::vector<value_type> {
+  expect_('L');
+  const std::uint64_t n = varint_();
+  if (n > data_.size() - pos_) throw checkpoint_error("checkpoint truncated");
+
+  std::vector<value_type> result(n);
+  for (auto& x : result) x = static_cast<value_type>(unzigzag(varint_()));
+  return result;
+}
+
+auto checkpoint_reader::read_state() -> int_computer_state {
+  expect_('M');
+  return read_state_();
+}
+
+auto checkpoint_reader::read_amplifier() -> amplifier {
+  expect_('A');
+  return amplifier::resume(read_state());
+}
+
+auto checkpoint_reader::read_chain(const int_computer_state& program) -> amplifier_chain {
+  expect_('C');
+  const std::uint64_t n = varint_();
+  const auto cfg = amplifier_chain::make_cfg_(program);
+
+  amplifier_chain result;
+  for (std::uint64_t i = 0; i < n; ++i) {
+    expect_('A');
+    int_computer_state s = read_state();
+    if (s.size() != program.size()) throw checkpoint_error("checkpoint is of a different program");
+    result |= amplifier::resume(std::move(s), cfg);
+  }
+  return result;
+}
+
+void checkpoint_reader::expect_(char t) {
+  if (pos_ == data_.size()) throw checkpoint_error("checkpoint truncated");
+  if (data_[pos_] != t) throw checkpoint_error("unexpected item in checkpoint");
+  ++pos_;
+}
+
+auto checkpoint_reader::varint_() -> std::uint64_t {
+  std::uint64_t result = 0;
+  for (unsigned int shift = 0; ; shift += 7u) {
+    if (pos_ == data_.size() || shift >= 64u) throw checkpoint_error("checkpoint truncated");
+    const auto byte = static_cast<unsigned char>(data_[pos_++]);
+    result |= std::uint64_t(byte & 0x7fu) << shift;
+    if ((byte & 0x80u) == 0u) return result;
+  }
+}
+
+auto checkpoint_reader::read_state_() -> int_computer_state {
+  const std::uint64_t pc = varint_();
+  const std::uint64_t n = varint_();
+  if (n > data_.size() - pos_ || (n != 0u && pc >= n)) throw checkpoint_error("bad machine in checkpoint");
+
+  std::vector<value_type> memory(n);
+  for (auto& x : memory) x = static_cast<value_type>(unzigzag(varint_()));
+  int_computer_state result(memory.begin(), memory.end());
+  result.jump(pc);
+  return result;
+}
+
+
+checkpoint_trigger::checkpoint_trigger(std::chrono::steady_clock::duration interval)
+: interval_(interval),
+  next_(std::chrono::steady_clock::now() + interval)
+{
+  if (trigger_exists.exchange(true)) throw std::logic_error("only one checkpoint_trigger may exist");
+  checkpoint_signalled = 0;
+  stop_signalled = 0;
+
+  struct sigaction sa{};
+  sa.sa_handler = &on_checkpoint_signal;
+  sigemptyset(&sa.sa_mask);
+  ::sigaction(SIGUSR1, &sa, &old_usr1_);
+  ::sigaction(SIGINT, &sa, &old_int_);
+  ::sigaction(SIGTERM, &sa, &old_term_);
+}
+
+checkpoint_trigger::~checkpoint_trigger() {
+  ::sigaction(SIGUSR1, &old_usr1_, nullptr);
+  ::sigaction(SIGINT, &old_int_, nullptr);
+  ::sigaction(SIGTERM, &old_term_, nullptr);
+  trigger_exists = false;
+}
+
+auto checkpoint_trigger::due() noexcept -> bool {
+  const auto now = std::chrono::steady_clock::now();
+  if (checkpoint_signalled == 0 && now < next_) return false;
+
+  checkpoint_signalled = 0;
+  next_ = now + interval_;
+  return true;
+}
+
+auto checkpoint_trigger::stop_requested() const noexcept -> bool {
+  return stop_signalled != 0;
+}
@@ -0,0 +1,248 @@
+#include <compact_machine.hh>
+#include <telemetry.hh>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+auto as_opcode(compact_machine::value_type v) noexcept -> opcode {
+  return opcode(v % 100);
+}
+
+///\brief Returns true if argument \p i (zero based) of \p instr is immediate.
+auto is_immediate(compact_machine::value_type instr, unsigned int i) -> bool {
+  static constexpr compact_machine::value_type divisor[] = { 100, 1000, 10000 };
+  switch (instr / divisor[i] % 10) {
+    case 0:
+      return false;
+    case 1:
+      return true;
+  }
+  throw invalid_opcode_error("invalid addressing mode");
+}
+
+///\brief Throws unless \p instr has no addressing modes beyond its \p args arguments.
+void check_modes(compact_machine::value_type instr, unsigned int args) {
+  static constexpr compact_machine::value_type divisor[] = { 100, 1000, 10000, 100000 };
+  if (instr / divisor[args] != 0) throw invalid_opcode_error("too many opcode modifiers");
+}
+
+} /* namespace <unnamed> */
+
+
+compact_machine::compact_machine(std::shared_ptr<const image_type> image, size_type pc)
+: image_(std::move(image)),
+  pc_(pc)
+{
+  if (image_ && image_->size() > std::numeric_limits<size_type>::max())
+    throw std::length_error("program too large");
+}
+
+compact_machine::compact_machine(const int_computer_state& s)
+: compact_machine(make_image(s), s.pc())
+{}
+
+compact_machine::compact_machine(const compact_machine& y)
+: image_(y.image_),
+  pc_(y.pc_)
+{
+  if (y.pages_) {
+    pages_ = std::make_unique<std::unique_ptr<page>[]>(page_count_());
+    for (size_type i = 0; i < page_count_(); ++i)
+      if (y.pages_[i]) pages_[i] = std::make_unique<page>(*y.pages_[i]);
+  }
+}
+
+auto compact_machine::operator=(const compact_machine& y) -> compact_machine& {
+  if (this != &y) *this = compact_machine(y);
+  return *this;
+}
+
+auto compact_machine::make_image(const int_computer_state& s) -> std::shared_ptr<const image_type> {
+  return std::make_shared<const image_type>(s.begin(), s.end());
+}
+
+void compact_machine::store(size_type idx, value_type v) {
+  if (idx >= size()) throw std::out_of_range("address out of range");
+
+  if (!pages_) pages_ = std::make_unique<std::unique_ptr<page>[]>(page_count_());
+  auto& p = pages_[idx / page_size];
+  if (!p) {
+    // Copy on write.
+    p = std::make_unique<page>();
+    const size_type base = idx / page_size * page_size;
+    const size_type n = std::min(page_size, size() - base);
+    std::copy_n(image_->begin() + base, n, p->data);
+    std::fill(p->data + n, p->data + page_size, value_type(0));
+  }
+  p->data[idx % page_size] = v;
+}
+
+auto compact_machine::is_halt() const -> bool {
+  if (empty()) throw bad_program_error("empty program");
+  return as_opcode(load_checked_(pc_)) == opcode::halt;
+}
+
+auto compact_machine::eval_until_io_or_halt() -> io_pending {
+  if (empty()) throw bad_program_error("empty program");
+  while (step_());
+  switch (as_opcode(load_(pc_))) {
+    case opcode::read:
+      return io_pending::read;
+    case opcode::write:
+      return io_pending::write;
+    default:
+      telemetry::add(telemetry::counter::halts);
+      return io_pending::halt;
+  }
+}
+
+auto compact_machine::eval_until_io_or_halt(eval_budget& budget) -> io_pending {
+  if (empty()) throw bad_program_error("empty program");
+  for (;;) {
+    switch (as_opcode(load_checked_(pc_))) {
+      case opcode::halt:
+        telemetry::add(telemetry::counter::halts);
+        return io_pending::halt;
+      case opcode::read:
+        return io_pending::read;
+      case opcode::write:
+        return io_pending::write;
+      default:
+        break;
+    }
+
+    if (!budget.step()) return io_pending::budget_exhausted;
+    step_();
+  }
+}
+
+void compact_machine::read(value_type v) {
+  const value_type instr = load_checked_(pc_);
+  if (as_opcode(instr) != opcode::read) throw io_error("machine is not reading");
+  check_modes(instr, 1);
+  if (is_immediate(instr, 0)) throw invalid_opcode_error("cannot assign to a immediate value");
+
+  store_checked_(load_checked_(pc_ + 1u), v);
+  pc_ += 2u;
+  telemetry::add(telemetry::counter::reads);
+}
+
+auto compact_machine::write() -> value_type {
+  const value_type instr = load_checked_(pc_);
+  if (as_opcode(instr) != opcode::write) throw io_error("machine is not writing");
+  check_modes(instr, 1);
+
+  const value_type arg = load_checked_(pc_ + 1u);
+  const value_type result = is_immediate(instr, 0) ? arg : load_checked_(arg);
+  pc_ += 2u;
+  telemetry::add(telemetry::counter::writes);
+  return result;
+}
+
+auto compact_machine::to_state() const -> int_computer_state {
+  std::vector<value_type> memory(size());
+  for (size_type i = 0; i < size(); ++i) memory[i] = load_(i);
+
+  int_computer_state result(memory.begin(), memory.end());
+  result.jump(pc_);
+  return result;
+}
+
+auto compact_machine::memory_usage() const noexcept -> memory_report {
+  memory_report r;
+  r.object = sizeof(*this);
+  if (pages_) {
+    r.page_table = page_count_() * sizeof(pages_[0]);
+    for (size_type i = 0; i < page_count_(); ++i)
+      if (pages_[i]) ++r.owned_pages;
+    r.pages = r.owned_pages * sizeof(page);
+  }
+  if (image_) r.shared_image = sizeof(*image_) + image_->capacity() * sizeof(value_type);
+  return r;
+}
+
+auto compact_machine::operator==(const compact_machine& y) const noexcept -> bool {
+  if (pc_ != y.pc_ || size() != y.size()) return false;
+  if (image_ != y.image_) {
+    for (size_type i = 0; i < size(); ++i)
+      if (load_(i) != y.load_(i)) return false;
+    return true;
+  }
+
+  // Same image: only pages owned by either machine can differ.
+  for (size_type i = 0; i < page_count_(); ++i) {
+    const size_type base = i * page_size;
+    if (owned_page_(base) == nullptr && y.owned_page_(base) == nullptr) continue;
+    const size_type end = std::min(base + page_size, size());
+    for (size_type j = base; j < end; ++j)
+      if (load_(j) != y.load_(j)) return false;
+  }
+  return true;
+}
+
+auto compact_machine::load_checked_(value_type idx) const -> value_type {
+  if (idx < 0 || size_type(idx) >= size()) throw std::out_of_range("address out of range");
+  return load_(idx);
+}
+
+void compact_machine::store_checked_(value_type idx, value_type v) {
+  if (idx < 0) throw std::out_of_range("address out of range");
+  store(idx, v);
+}
+
+///\brief Execute a single instruction, unless it is I/O or halt.
+///\return False if the machine is at an I/O or halt instruction.
+auto compact_machine::step_() -> bool {
+  const value_type instr = load_checked_(pc_);
+  const auto arg = [this, instr](unsigned int i) -> value_type {
+    const value_type v = load_checked_(pc_ + 1u + i);
+    return is_immediate(instr, i) ? v : load_checked_(v);
+  };
+  const auto out = [this, instr](unsigned int i, value_type v) {
+    if (is_immediate(instr, i)) throw invalid_opcode_error("cannot assign to a immediate value");
+    store_checked_(load_checked_(pc_ + 1u + i), v);
+  };
+
+  switch (as_opcode(instr)) {
+    default:
+      throw invalid_opcode_error("bad opcode");
+    case opcode::halt: [[fallthrough]];
+    case opcode::read: [[fallthrough]];
+    case opcode::write:
+      return false;
+    case opcode::add:
+      check_modes(instr, 3);
+      out(2, arg(0) + arg(1));
+      pc_ += 4u;
+      break;
+    case opcode::mul:
+      check_modes(instr, 3);
+      out(2, arg(0) * arg(1));
+      pc_ += 4u;
+      break;
+    case opcode::less_than:
+      check_modes(instr, 3);
+      out(2, arg(0) < arg(1) ? 1 : 0);
+      pc_ += 4u;
+      break;
+    case opcode::equals:
+      check_modes(instr, 3);
+      out(2, arg(0) == arg(1) ? 1 : 0);
+      pc_ += 4u;
+      break;
+    case opcode::jump_if_true:
+      check_modes(instr, 2);
+      pc_ = (arg(0) != 0 ? size_type(arg(1)) : pc_ + 3u);
+      break;
+    case opcode::jump_if_false:
+      check_modes(instr, 2);
+      pc_ = (arg(0) == 0 ? size_type(arg(1)) : pc_ + 3u);
+      break;
+  }
+  int_computer_state::count_interpreted_(1);
+  return true;
+}
@@ -0,0 +1,275 @@
+#include <control_flow.hh>
+#include <algorithm>
+#include <ostream>
+
+
+namespace {
+
+using size_type = control_flow_graph::size_type;
+using value_type = control_flow_graph::value_type;
+using decoded_instruction = control_flow_graph::decoded_instruction;
+
+auto decode_(const value_type* m, size_type size, size_type pc) -> std::optional<decoded_instruction> {
+  if (pc >= size || m[pc] < 0) return {};
+
+  const auto& instr_map = int_computer_state::instructions();
+  const auto instr_iter = instr_map.find(opcode(m[pc] % 100));
+  if (instr_iter == instr_map.end()) return {};
+  if (pc + 1u + instr_iter->second.arguments > size) return {};
+
+  decoded_instruction d{ pc, instr_iter->first, std::uint8_t(instr_iter->second.arguments), {} };
+  value_type modifiers = m[pc] / 100;
+  for (std::size_t i = 0; i < d.arg_count; ++i, modifiers /= 10) {
+    if (modifiers % 10 != 0 && modifiers % 10 != 1) return {};
+    d.args[i] = { addressing_mode(modifiers % 10), m[pc + 1u + i] };
+    if (d.args[i].mode == addressing_mode::position
+        && (d.args[i].value < 0 || size_type(d.args[i].value) >= size))
+      return {};
+  }
+  if (modifiers != 0) return {};
+  if (control_flow_graph::stores(d.op) && d.output().mode != addressing_mode::position) return {};
+  return d;
+}
+
+auto ends_block(opcode op) -> bool {
+  switch (op) {
+    default:
+      return false;
+    case opcode::read: [[fallthrough]];
+    case opcode::write: [[fallthrough]];
+    case opcode::jump_if_true: [[fallthrough]];
+    case opcode::jump_if_false: [[fallthrough]];
+    case opcode::halt:
+      return true;
+  }
+}
+
+auto is_jump(opcode op) -> bool {
+  return op == opcode::jump_if_true || op == opcode::jump_if_false;
+}
+
+} /* namespace <unnamed> */
+
+
+control_flow_graph::control_flow_graph(const int_computer_state& program)
+: image_(program.begin(), program.end()),
+  block_at_(program.size(), 0u),
+  code_(program.size(), false)
+{
+  std::vector<bool> leaders(image_.size(), false);
+  find_leaders_(leaders, { 0u });
+
+  // Values in data words may be the targets of computed jumps.
+  std::vector<bool> covered(image_.size(), false);
+  for (size_type pc = 0; pc < image_.size(); ++pc) {
+    if (!leaders[pc]) continue;
+    for (auto d = decode_(image_.data(), image_.size(), pc); d; d = decode_(image_.data(), image_.size(), d->next())) {
+      std::fill(covered.begin() + d->pc, covered.begin() + d->next(), true);
+      if (ends_block(d->op) || d->next() >= image_.size() || leaders[d->next()]) break;
+    }
+  }
+  std::vector<size_type> todo;
+  for (size_type i = 0; i < image_.size(); ++i) {
+    if (!covered[i] && image_[i] >= 0 && size_type(image_[i]) < image_.size()
+        && decode_(image_.data(), image_.size(), image_[i]))
+      todo.push_back(image_[i]);
+  }
+  find_leaders_(leaders, std::move(todo));
+
+  // Create the blocks.
+  for (size_type leader = 0; leader < image_.size(); ++leader) {
+    if (!leaders[leader]) continue;
+
+    basic_block b{ leader, leader, {}, terminator::fallthrough, {} };
+    for (;;) {
+      const auto d = decode_(image_.data(), image_.size(), b.end);
+      if (!d) {
+        b.kind = terminator::undecodable;
+        break;
+      }
+      b.instrs.push_back(*d);
+      b.end = d->next();
+
+      if (d->op == opcode::halt) {
+        b.kind = terminator::halt;
+        break;
+      } else if (is_jump(d->op)) {
+        b.kind = terminator::jump;
+        if (d->args[1].mode == addressing_mode::immediate) {
+          if (d->args[1].value >= 0 && size_type(d->args[1].value) < image_.size())
+            b.successors.push_back(d->args[1].value);
+        } else {
+          b.computed_jump = true;
+        }
+        if (b.end < image_.size()) b.successors.push_back(b.end);
+        break;
+      } else if (ends_block(d->op)) {
+        b.kind = terminator::io;
+        if (b.end < image_.size()) b.successors.push_back(b.end);
+        break;
+      } else if (b.end < image_.size() && leaders[b.end]) {
+        b.successors.push_back(b.end);
+        break;
+      }
+    }
+
+    // A leader at an undecodable word (say, a jump target in data that is
+    // only patched at run time) starts no block: the interpreter executes it.
+    if (b.instrs.empty()) continue;
+
+    for (const auto& d : b.instrs)
+      std::fill(code_.begin() + d.pc, code_.begin() + d.next(), true);
+    block_at_[leader] = blocks_.size() + 1u;
+    blocks_.push_back(std::move(b));
+  }
+}
+
+auto control_flow_graph::decode(const int_computer_state& program, size_type pc) -> std::optional<decoded_instruction> {
+  if (program.empty()) return {};
+  return decode_(&*program.cbegin(), program.size(), pc);
+}
+
+auto control_flow_graph::stores(opcode op) noexcept -> bool {
+  switch (op) {
+    default:
+      return false;
+    case opcode::add: [[fallthrough]];
+    case opcode::mul: [[fallthrough]];
+    case opcode::read: [[fallthrough]];
+    case opcode::less_than: [[fallthrough]];
+    case opcode::equals:
+      return true;
+  }
+}
+
+auto control_flow_graph::matches(const basic_block& b, const int_computer_state& s) const noexcept -> bool {
+  if (s.size() != image_.size()) return false;
+  return std::equal(image_.begin() + b.begin, image_.begin() + b.end, s.cbegin() + b.begin);
+}
+
+auto control_flow_graph::matches(const int_computer_state& s) const noexcept -> bool {
+  return std::all_of(blocks_.begin(), blocks_.end(),
+      [this, &s](const basic_block& b) { return matches(b, s); });
+}
+
+///\brief Find block entry points reachable from \p todo.
+void control_flow_graph::find_leaders_(std::vector<bool>& leaders, std::vector<size_type> todo) const {
+  while (!todo.empty()) {
+    size_type pc = todo.back();
+    todo.pop_back();
+    if (pc >= image_.size() || leaders[pc]) continue;
+    leaders[pc] = true;
+
+    for (;;) {
+      const auto d = decode_(image_.data(), image_.size(), pc);
+      if (!d) {
+        // Likely an instruction that the program patches before executing it.
+        // Guess where the next instruction starts: a wrong guess only adds
+        // a block that is never entered, or splits an existing block.
+        for (size_type len = 2; len <= 4; ++len) {
+          if (decode_(image_.data(), image_.size(), pc + len)) todo.push_back(pc + len);
+        }
+        break;
+      }
+
+      if (is_jump(d->op) && d->args[1].mode == addressing_mode::immediate
+          && d->args[1].value >= 0)
+        todo.push_back(d->args[1].value);
+      if (d->op == opcode::halt) break;
+      if (ends_block(d->op)) {
+        todo.push_back(d->next());
+        break;
+      }
+
+      pc = d->next();
+      if (pc >= image_.size() || leaders[pc]) break;
+    }
+  }
+}
+
+auto control_flow_graph::loops() const -> std::vector<loop> {
+  enum class color : std::uint8_t { white, grey, black };
+  std::vector<color> colors(blocks_.size(), color::white);
+  std::vector<std::pair<std::size_t, std::size_t>> back_edges; // (latch, header)
+
+  // Iterative depth first search, recording edges into blocks on the stack.
+  std::vector<std::pair<std::size_t, std::size_t>> stack; // (block, next successor)
+  for (std::size_t root = 0; root < blocks_.size(); ++root) {
+    if (colors[root] != color::white) continue;
+    colors[root] = color::grey;
+    stack.emplace_back(root, 0u);
+
+    while (!stack.empty()) {
+      auto& [b, succ] = stack.back();
+      if (succ == blocks_[b].successors.size()) {
+        colors[b] = color::black;
+        stack.pop_back();
+        continue;
+      }
+
+      const auto next = block_index(blocks_[b].successors[succ++]);
+      if (!next) continue;
+      if (colors[*next] == color::grey) {
+        back_edges.emplace_back(b, *next);
+      } else if (colors[*next] == color::white) {
+        colors[*next] = color::grey;
+        stack.emplace_back(*next, 0u);
+      }
+    }
+  }
+
+  // Predecessor lists, for walking the loop bodies backwards.
+  std::vector<std::vector<std::size_t>> preds(blocks_.size());
+  for (std::size_t b = 0; b < blocks_.size(); ++b) {
+    for (const auto s : blocks_[b].successors) {
+      if (const auto idx = block_index(s)) preds[*idx].push_back(b);
+    }
+  }
+
+  std::vector<loop> result;
+  for (const auto& [latch, header] : back_edges) {
+    std::vector<bool> in_loop(blocks_.size(), false);
+    std::vector<std::size_t> todo = { latch };
+    in_loop[header] = true;
+    while (!todo.empty()) {
+      const auto b = todo.back();
+      todo.pop_back();
+      if (in_loop[b]) continue;
+      in_loop[b] = true;
+      todo.insert(todo.end(), preds[b].begin(), preds[b].end());
+    }
+
+    loop l{ blocks_[header].begin, {} };
+    for (std::size_t b = 0; b < blocks_.size(); ++b)
+      if (in_loop[b]) l.blocks.push_back(blocks_[b].begin);
+    result.push_back(std::move(l));
+  }
+  return result;
+}
+
+void control_flow_graph::write_dot(std::ostream& out, const std::vector<std::uint64_t>& block_counts) const {
+  const std::uint64_t max_count = block_counts.empty()
+      ? 0u
+      : *std::max_element(block_counts.begin(), block_counts.end());
+
+  out << "digraph program {\n"
+      << "  node [shape=box];\n";
+  for (std::size_t i = 0; i < blocks_.size(); ++i) {
+    const auto& b = blocks_[i];
+    out << "  b" << b.begin << " [label=\"" << b.begin << ".." << b.end;
+    if (i < block_counts.size()) out << "\\n" << block_counts[i] << "x";
+    out << "\"";
+    if (i < block_counts.size() && max_count != 0u && block_counts[i] * 10u >= max_count)
+      out << ", style=filled, fillcolor=orange";
+    out << "];\n";
+
+    for (const auto s : b.successors) {
+      if (find(s)) out << "  b" << b.begin << " -> b" << s << ";\n";
+    }
+    if (b.computed_jump) {
+      out << "  b" << b.begin << " -> computed" << b.begin << " [style=dashed];\n"
+          << "  computed" << b.begin << " [shape=point];\n";
+    }
+  }
+  out << "}\n";
+}
@@ -0,0 +1,259 @@
+#include <euler_tour_forest.hh>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+
+auto euler_tour_forest::add_vertex() -> vertex {
+  vertex v;
+  if (!free_.empty()) {
+    v = free_.back();
+    free_.pop_back();
+  } else {
+    if (parent_.size() >= npos / 2u) throw std::length_error("too many vertices");
+    v = parent_.size();
+    parent_.push_back(npos);
+    nodes_.resize(nodes_.size() + 2u);
+  }
+
+  parent_[v] = npos;
+  nodes_[enter_(v)] = node{};
+  nodes_[enter_(v)].value = 1;
+  nodes_[enter_(v)].priority = next_priority_();
+  nodes_[exit_(v)] = node{};
+  nodes_[exit_(v)].value = -1;
+  nodes_[exit_(v)].priority = next_priority_();
+  update_(enter_(v));
+  update_(exit_(v));
+  merge_(enter_(v), exit_(v));
+  return v;
+}
+
+void euler_tour_forest::remove_vertex(vertex v) {
+  if (parent_.at(v) != npos || subtree_size(v) != 1u)
+    throw std::invalid_argument("vertex is not isolated");
+  free_.push_back(v);
+}
+
+void euler_tour_forest::link(vertex child, vertex parent) {
+  if (parent_.at(child) != npos) throw std::invalid_argument("vertex already has a parent");
+  if (connected(child, parent)) throw std::invalid_argument("link would create a cycle");
+
+  const size_type child_size = subtree_size(child);
+  const size_type child_depth = depth(parent) + 1u;
+
+  const node_id child_tree = root_(enter_(child));
+  node_id l, r;
+  split_(root_(enter_(parent)), position_(enter_(parent)) + 1u, l, r);
+  merge_(merge_(l, child_tree), r);
+
+  parent_[child] = parent;
+  total_depth_ += child_size * child_depth;
+}
+
+void euler_tour_forest::cut(vertex child) {
+  if (parent_.at(child) == npos) return;
+
+  const size_type child_size = subtree_size(child);
+  const size_type child_depth = depth(child);
+
+  const size_type begin = position_(enter_(child));
+  const size_type end = position_(exit_(child)) + 1u;
+  node_id before, subtree, after;
+  split_(root_(enter_(child)), begin, before, subtree);
+  split_(subtree, end - begin, subtree, after);
+  merge_(before, after);
+
+  parent_[child] = npos;
+  total_depth_ -= child_size * child_depth;
+}
+
+void euler_tour_forest::assign(const std::vector<vertex>& parents) {
+  const size_type n = parents.size();
+  if (n >= npos / 2u) throw std::length_error("too many vertices");
+
+  // Children of each vertex, in compressed form.
+  std::vector<vertex> child_begin(n + 1u, 0u);
+  for (const vertex p : parents) {
+    if (p == npos) continue;
+    if (p >= n) throw std::out_of_range("parent out of range");
+    ++child_begin[p + 1u];
+  }
+  std::partial_sum(child_begin.begin(), child_begin.end(), child_begin.begin());
+  std::vector<vertex> children(child_begin.back());
+  {
+    std::vector<vertex> fill(child_begin.begin(), child_begin.end() - 1);
+    for (vertex v = 0; v < n; ++v)
+      if (parents[v] != npos) children[fill[parents[v]]++] = v;
+  }
+
+  nodes_.assign(2u * n, node{});
+  parent_ = parents;
+  free_.clear();
+  total_depth_ = 0;
+
+  size_type visited = 0;
+  std::vector<node_id> tour;
+  std::vector<std::pair<vertex, vertex>> stack; // (vertex, next child index)
+  for (vertex root = 0; root < n; ++root) {
+    if (parents[root] != npos) continue;
+
+    tour.clear();
+    stack.emplace_back(root, child_begin[root]);
+    tour.push_back(enter_(root));
+    while (!stack.empty()) {
+      auto& [v, next_child] = stack.back();
+      if (next_child == child_begin[v + 1u]) {
+        tour.push_back(exit_(v));
+        stack.pop_back();
+        continue;
+      }
+
+      const vertex c = children[next_child++];
+      total_depth_ += stack.size();
+      tour.push_back(enter_(c));
+      stack.emplace_back(c, child_begin[c]);
+    }
+
+    visited += tour.size() / 2u;
+    build_(tour);
+  }
+
+  if (visited != n) throw std::invalid_argument("parent array contains a cycle");
+}
+
+auto euler_tour_forest::depth(vertex v) const -> size_type {
+  if (v >= parent_.size()) throw std::out_of_range("no such vertex");
+  return prefix_sum_(enter_(v)) - 1;
+}
+
+auto euler_tour_forest::subtree_size(vertex v) const -> size_type {
+  if (v >= parent_.size()) throw std::out_of_range("no such vertex");
+  return (position_(exit_(v)) - position_(enter_(v)) + 1u) / 2u;
+}
+
+auto euler_tour_forest::connected(vertex x, vertex y) const -> bool {
+  if (x >= parent_.size() || y >= parent_.size()) throw std::out_of_range("no such vertex");
+  return root_(enter_(x)) == root_(enter_(y));
+}
+
+void euler_tour_forest::update_(node_id n) noexcept {
+  node& nd = nodes_[n];
+  nd.size = 1u + size_(nd.left) + size_(nd.right);
+  nd.sum = nd.value + sum_(nd.left) + sum_(nd.right);
+  if (nd.left != nil) nodes_[nd.left].up = n;
+  if (nd.right != nil) nodes_[nd.right].up = n;
+}
+
+auto euler_tour_forest::root_(node_id n) const noexcept -> node_id {
+  while (nodes_[n].up != nil) n = nodes_[n].up;
+  return n;
+}
+
+///\brief Index of \p n in its tour.
+auto euler_tour_forest::position_(node_id n) const noexcept -> size_type {
+  size_type result = size_(nodes_[n].left);
+  for (node_id p = nodes_[n].up; p != nil; n = p, p = nodes_[p].up) {
+    if (nodes_[p].right == n) result += size_(nodes_[p].left) + 1u;
+  }
+  return result;
+}
+
+///\brief Sum of token values in its tour, up to and including \p n.
+auto euler_tour_forest::prefix_sum_(node_id n) const noexcept -> std::int64_t {
+  std::int64_t result = sum_(nodes_[n].left) + nodes_[n].value;
+  for (node_id p = nodes_[n].up; p != nil; n = p, p = nodes_[p].up) {
+    if (nodes_[p].right == n) result += sum_(nodes_[p].left) + nodes_[p].value;
+  }
+  return result;
+}
+
+///\brief Split \p t in its first \p k tokens \p l and the remainder \p r.
+void euler_tour_forest::split_(node_id t, size_type k, node_id& l, node_id& r) {
+  if (t == nil) {
+    l = r = nil;
+    return;
+  }
+
+  if (size_(nodes_[t].left) < k) {
+    node_id right_l;
+    split_(nodes_[t].right, k - size_(nodes_[t].left) - 1u, right_l, r);
+    nodes_[t].right = right_l;
+    l = t;
+  } else {
+    node_id left_r;
+    split_(nodes_[t].left, k, l, left_r);
+    nodes_[t].left = left_r;
+    r = t;
+  }
+  update_(t);
+
+  if (l != nil) nodes_[l].up = nil;
+  if (r != nil) nodes_[r].up = nil;
+}
+
+auto euler_tour_forest::merge_(node_id l, node_id r) -> node_id {
+  node_id result;
+  if (l == nil) {
+    result = r;
+  } else if (r == nil) {
+    result = l;
+  } else if (nodes_[l].priority > nodes_[r].priority) {
+    nodes_[l].right = merge_(nodes_[l].right, r);
+    update_(l);
+    result = l;
+  } else {
+    nodes_[r].left = merge_(l, nodes_[r].left);
+    update_(r);
+    result = r;
+  }
+
+  if (result != nil) nodes_[result].up = nil;
+  return result;
+}
+
+///\brief Build a treap holding \p tour, in linear time.
+auto euler_tour_forest::build_(const std::vector<node_id>& tour) -> node_id {
+  // Cartesian tree on random priorities.
+  std::vector<node_id> stack;
+  for (const node_id n : tour) {
+    nodes_[n] = node{};
+    nodes_[n].value = (n % 2u == 0u ? 1 : -1);
+    nodes_[n].priority = next_priority_();
+
+    node_id last = nil;
+    while (!stack.empty() && nodes_[stack.back()].priority < nodes_[n].priority) {
+      last = stack.back();
+      stack.pop_back();
+    }
+    nodes_[n].left = last;
+    if (!stack.empty()) nodes_[stack.back()].right = n;
+    stack.push_back(n);
+  }
+  if (stack.empty()) return nil;
+  const node_id root = stack.front();
+
+  // Compute the aggregates bottom-up (reverse pre-order).
+  std::vector<node_id> order;
+  order.reserve(tour.size());
+  stack.assign(1, root);
+  while (!stack.empty()) {
+    const node_id n = stack.back();
+    stack.pop_back();
+    order.push_back(n);
+    if (nodes_[n].left != nil) stack.push_back(nodes_[n].left);
+    if (nodes_[n].right != nil) stack.push_back(nodes_[n].right);
+  }
+  std::for_each(order.rbegin(), order.rend(), [this](node_id n) { update_(n); });
+  nodes_[root].up = nil;
+  return root;
+}
+
+///\brief xorshift64*
+auto euler_tour_forest::next_priority_() noexcept -> std::uint32_t {
+  rng_ ^= rng_ >> 12;
+  rng_ ^= rng_ << 25;
+  rng_ ^= rng_ >> 27;
+  return static_cast<std::uint32_t>((rng_ * 0x2545f4914f6cdd1dull) >> 32);
+}
@@ -1,7 +1,11 @@
 #include <int_computer.hh>
+#include <control_flow.hh>
+#include <telemetry.hh>
+#include <trace_recorder.hh>
 #include <boost/spirit/include/qi.hpp>
 #include <boost/spirit/include/support_istream_iterator.hpp>
 #include <istream>
+#include <iterator>
 
 
 bad_program_error::~bad_program_error() = default;
@@ -11,26 +15,56 @@ invalid_opcode_error::~invalid_opcode_error() = default;
 io_error::~io_error() = default;
 
 
+#ifndef INT_COMPUTER_TELEMETRY
+namespace {
+
+///\brief Instruction count, if telemetry isn't counting them already.
+thread_local std::uint64_t interpreted = 0;
+
+} /* namespace <unnamed> */
+#endif
+
+
 auto int_computer_state::eval_and_get() -> value_type {
   return eval().opcodes_[0];
 }
 
 auto int_computer_state::eval() -> int_computer_state& {
+  rehash_();
   while (!is_halt())
     eval1();
+  telemetry::add(telemetry::counter::halts);
   return *this;
 }
 
+auto int_computer_state::eval(eval_budget& budget) -> io_pending {
+  rehash_();
+  while (!is_halt()) {
+    if (!budget.step()) return io_pending::budget_exhausted;
+    eval1();
+  }
+  telemetry::add(telemetry::counter::halts);
+  return io_pending::halt;
+}
+
 auto int_computer_state::eval_until_io_or_halt() -> io_pending {
+  eval_budget unlimited;
+  return eval_until_io_or_halt(unlimited);
+}
+
+auto int_computer_state::eval_until_io_or_halt(eval_budget& budget) -> io_pending {
   if (empty()) throw bad_program_error("empty program");
+  rehash_();
 
   for (;;) {
     assert(pc_ < opcodes_.size());
     switch (as_opcode(opcodes_[pc_])) {
       default:
+        if (!budget.step()) return io_pending::budget_exhausted;
         eval1();
         break;
       case opcode::halt:
+        telemetry::add(telemetry::counter::halts);
         return io_pending::halt;
       case opcode::read:
         return io_pending::read;
@@ -40,6 +74,138 @@ auto int_computer_state::eval_until_io_or_halt() -> io_pending {
   }
 }
 
+auto int_computer_state::eval_until_io_or_halt(const control_flow_graph& cfg, std::vector<std::uint64_t>* block_counts) -> io_pending {
+  eval_budget unlimited;
+  return eval_until_io_or_halt(cfg, unlimited, block_counts);
+}
+
+auto int_computer_state::eval_until_io_or_halt(const control_flow_graph& cfg, eval_budget& budget, std::vector<std::uint64_t>* block_counts) -> io_pending {
+  if (empty()) throw bad_program_error("empty program");
+  if (tracer != nullptr || cfg.program_size() != size()) return eval_until_io_or_halt(budget);
+  rehash_();
+  if (block_counts != nullptr && block_counts->size() < cfg.blocks().size())
+    block_counts->resize(cfg.blocks().size());
+
+  const auto load = [this](const control_flow_graph::operand& arg) -> value_type {
+    return arg.mode == addressing_mode::immediate ? arg.value : opcodes_[arg.value];
+  };
+  // Returns true if the store modified code.
+  const auto store = [this, &cfg](const control_flow_graph::operand& arg, value_type new_value) -> bool {
+    auto& cell = opcodes_[arg.value];
+    if (mem_hash_valid_)
+      mem_hash_ += cell_hash_(arg.value, new_value) - cell_hash_(arg.value, cell);
+    cell = new_value;
+    return cfg.is_code(arg.value);
+  };
+
+  // Instructions of a block that are executed, if the block runs to its end.
+  const auto charge = [](const control_flow_graph::basic_block& b) -> std::uint64_t {
+    const bool stops = (b.kind == control_flow_graph::terminator::io || b.kind == control_flow_graph::terminator::halt);
+    return b.instrs.size() - (stops ? 1u : 0u);
+  };
+
+  for (;;) {
+    assert(pc_ < opcodes_.size());
+    const auto block_idx = cfg.block_index(pc_);
+    if (!block_idx
+        || (code_modified_ && !cfg.matches(cfg.blocks()[*block_idx], *this))
+        || !budget.step(charge(cfg.blocks()[*block_idx]))) {
+      // Not the start of a usable block, or not enough budget for all of it: single step.
+      switch (as_opcode(opcodes_[pc_])) {
+        default:
+          if (!budget.step()) return io_pending::budget_exhausted;
+          {
+            const auto d = control_flow_graph::decode(*this, pc_);
+            if (d && control_flow_graph::stores(d->op) && cfg.is_code(d->output().value))
+              code_modified_ = true;
+          }
+          eval1();
+          break;
+        case opcode::halt:
+          telemetry::add(telemetry::counter::halts);
+          return io_pending::halt;
+        case opcode::read:
+          {
+            // The caller completes the read, which may store into code.
+            const auto d = control_flow_graph::decode(*this, pc_);
+            if (d && cfg.is_code(d->output().value)) code_modified_ = true;
+          }
+          return io_pending::read;
+        case opcode::write:
+          return io_pending::write;
+      }
+      continue;
+    }
+
+    const auto& b = cfg.blocks()[*block_idx];
+    if (block_counts != nullptr) ++(*block_counts)[*block_idx];
+
+    pc_ = b.end;
+    std::uint64_t unused = charge(b);
+    for (const auto& d : b.instrs) {
+      bool modified = false;
+      switch (d.op) {
+        case opcode::add:
+          modified = store(d.args[2], load(d.args[0]) + load(d.args[1]));
+          break;
+        case opcode::mul:
+          modified = store(d.args[2], load(d.args[0]) * load(d.args[1]));
+          break;
+        case opcode::less_than:
+          modified = store(d.args[2], load(d.args[0]) < load(d.args[1]) ? 1 : 0);
+          break;
+        case opcode::equals:
+          modified = store(d.args[2], load(d.args[0]) == load(d.args[1]) ? 1 : 0);
+          break;
+        case opcode::jump_if_true:
+          pc_ = (load(d.args[0]) != 0 ? size_type(load(d.args[1])) : d.next());
+          break;
+        case opcode::jump_if_false:
+          pc_ = (load(d.args[0]) == 0 ? size_type(load(d.args[1])) : d.next());
+          break;
+        case opcode::halt:
+          pc_ = d.pc;
+          telemetry::add(telemetry::counter::halts);
+          return io_pending::halt;
+        case opcode::read:
+          pc_ = d.pc;
+          if (cfg.is_code(d.output().value)) code_modified_ = true;
+          return io_pending::read;
+        case opcode::write:
+          pc_ = d.pc;
+          return io_pending::write;
+      }
+
+      count_interpreted_(1);
+      --unused;
+
+      if (modified) {
+        // Remaining instructions of this block may have changed.
+        code_modified_ = true;
+        pc_ = d.next();
+        budget.refund(unused);
+        break;
+      }
+    }
+  }
+}
+
+auto int_computer_state::interpreted_instructions() noexcept -> std::uint64_t {
+#ifdef INT_COMPUTER_TELEMETRY
+  return telemetry::local(telemetry::counter::instructions);
+#else
+  return interpreted;
+#endif
+}
+
+void int_computer_state::count_interpreted_(std::uint64_t n) noexcept {
+#ifdef INT_COMPUTER_TELEMETRY
+  telemetry::add(telemetry::counter::instructions, n);
+#else
+  interpreted += n;
+#endif
+}
+
 auto int_computer_state::eval1() -> int_computer_state& {
   if (empty()) throw bad_program_error("empty program");
   assert(pc_ < opcodes_.size());
@@ -59,8 +225,9 @@ auto int_computer_state::eval1() -> int_computer_state& {
     throw std::range_error("insufficient arguments");
 
   // Load argument vector.
-  std::vector<instruction::argument_type> iargs;
-  iargs.reserve(instr.arguments);
+  // The vector is kept between calls, so evaluation doesn't allocate.
+  auto& iargs = args_;
+  iargs.clear();
   std::transform(arg_start, arg_end, std::back_inserter(iargs),
       [](const value_type& v) -> instruction::argument_type {
         return std::make_tuple(addressing_mode::position, v);
@@ -75,10 +242,41 @@ auto int_computer_state::eval1() -> int_computer_state& {
   if (modifiers != 0)
     throw invalid_opcode_error("too many opcode modifiers");
 
-  instr_iter->second.eval(*this, std::move(iargs));
+  const auto pc = pc_;
+  instr.eval(*this, iargs);
+  count_interpreted_(1);
+  if (tracer != nullptr) trace_(pc, opcode_with_modifiers, iargs);
+  iargs.clear(); // Copies of this state needn't copy the arguments.
   return *this;
 }
 
+void int_computer_state::trace_(size_type pc, value_type instr, const std::vector<instruction::argument_type>& args) const {
+  trace_record r{};
+  r.pc = static_cast<std::uint32_t>(pc);
+  r.instruction = instr;
+  for (std::size_t i = 0; i < args.size() && i < std::size(r.args); ++i)
+    r.args[i] = std::get<instruction::argument_value>(args[i]);
+
+  switch (as_opcode(instr)) {
+    default:
+      break;
+    case opcode::add: [[fallthrough]];
+    case opcode::mul: [[fallthrough]];
+    case opcode::read: [[fallthrough]];
+    case opcode::write: [[fallthrough]];
+    case opcode::less_than: [[fallthrough]];
+    case opcode::equals:
+      r.result = get_(args.back()); // Stored or written value.
+      break;
+    case opcode::jump_if_true: [[fallthrough]];
+    case opcode::jump_if_false:
+      r.result = static_cast<value_type>(pc_);
+      break;
+  }
+
+  tracer->record(r);
+}
+
 auto int_computer_state::instructions()
 -> const std::unordered_map<opcode, instruction>& {
   static const std::unordered_map<opcode, instruction> map = {
@@ -120,8 +318,40 @@ auto int_computer_state::single_output(int_computer_state s, std::vector<value_t
   return out;
 }
 
+auto int_computer_state::fingerprint() const noexcept -> std::size_t {
+  return mix_((mem_hash_valid_ ? mem_hash_ : memory_hash_()) ^ mix_(pc_));
+}
+
+auto int_computer_state::memory_hash_() const noexcept -> std::uint64_t {
+  std::uint64_t h = 0;
+  for (size_type i = 0; i < opcodes_.size(); ++i)
+    h += cell_hash_(i, opcodes_[i]);
+  return h;
+}
+
 auto int_computer_state::operator==(const int_computer_state& y) const noexcept -> bool {
-  return pc_ == y.pc_ && opcodes_ == y.opcodes_;
+  return pc_ == y.pc_
+      && opcodes_.size() == y.opcodes_.size()
+      && fingerprint() == y.fingerprint()
+      && opcodes_ == y.opcodes_;
+}
+
+///\brief Memory hash contribution of a single cell.
+///\details
+///The memory hash is the (wrapping) sum of all cell contributions,
+///so a store only has to swap out the contribution of the modified cell.
+auto int_computer_state::cell_hash_(size_type idx, value_type v) noexcept -> std::uint64_t {
+  return mix_(std::uint64_t(idx) << 32 | std::uint64_t(static_cast<std::uint32_t>(v)));
+}
+
+///\brief Bit mixer (splitmix64 finalizer).
+auto int_computer_state::mix_(std::uint64_t x) noexcept -> std::uint64_t {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
 }
 
 void int_computer_state::instr_add(const std::vector<instruction::argument_type>& args) {
@@ -153,6 +383,7 @@ void int_computer_state::instr_read(const std::vector<instruction::argument_type
   if (!read_cb) throw io_error("no input");
   set_(pos, read_cb());
   pc_ += 2u;
+  telemetry::add(telemetry::counter::reads);
 }
 
 void int_computer_state::instr_write(const std::vector<instruction::argument_type>& args) {
@@ -161,6 +392,7 @@ void int_computer_state::instr_write(const std::vector<instruction::argument_typ
   if (!write_cb) throw io_error("no output");
   write_cb(get_(pos));
   pc_ += 2u;
+  telemetry::add(telemetry::counter::writes);
 }
 
 void int_computer_state::instr_jump_if_true(const std::vector<instruction::argument_type>& args) {
@@ -219,7 +451,12 @@ void int_computer_state::set_(instruction::argument_type iarg, value_type new_va
 
   switch (std::get<addressing_mode>(iarg)) {
     case addressing_mode::position:
-      opcodes_.at(v) = new_value;
+      {
+        auto& cell = opcodes_.at(v);
+        if (mem_hash_valid_)
+          mem_hash_ += cell_hash_(v, new_value) - cell_hash_(v, cell);
+        cell = new_value;
+      }
       break;
     case addressing_mode::immediate:
       throw invalid_opcode_error("cannot assign to a immediate value");
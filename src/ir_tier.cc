@@ -0,0 +1,441 @@
+#include <ir_tier.hh>
+#include <telemetry.hh>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+
+///\brief A trace, lifted to the intermediate representation.
+///\details
+///Registers are numbered; constants occupy registers that are filled when
+///the region is built, and every other register is assigned by exactly one
+///instruction. Memory is only written when the region exits.
+struct ir_tier::region {
+  enum class op : std::uint8_t {
+    load, ///< dst = memory[a]
+    add,
+    mul,
+    less_than,
+    equals
+  };
+
+  enum class exit_kind : std::uint8_t {
+    jump, ///< Continue at register target.
+    jump_if_true, ///< Continue at register target if cond is non-zero, otherwise at fallthrough.
+    jump_if_false ///< Continue at register target if cond is zero, otherwise at fallthrough.
+  };
+
+  struct instr {
+    op o;
+    std::uint32_t dst, a, b;
+  };
+
+  struct store {
+    size_type addr;
+    std::uint32_t src;
+  };
+
+  size_type entry;
+  ///\brief Ranges of instruction words the trace was built from.
+  std::vector<std::pair<size_type, size_type>> words;
+  ///\brief Contents of \ref words, at the time the region was built.
+  std::vector<value_type> word_values;
+  std::vector<instr> code;
+  std::vector<value_type> regs;
+  std::vector<store> stores;
+  ///\brief Number of program instructions the region executes.
+  std::uint32_t instructions = 0;
+  exit_kind exit = exit_kind::jump;
+  std::uint32_t cond = 0, target = 0;
+  size_type fallthrough = 0;
+};
+
+
+namespace {
+
+using size_type = ir_tier::size_type;
+using value_type = ir_tier::value_type;
+using decoded_instruction = control_flow_graph::decoded_instruction;
+
+constexpr std::size_t no_conflict = std::numeric_limits<std::size_t>::max();
+
+} /* namespace <unnamed> */
+
+
+ir_tier::ir_tier(const int_computer_state& program, std::uint32_t hot_threshold)
+: cfg_(program),
+  hot_threshold_(hot_threshold),
+  heat_(cfg_.blocks().size(), 0u),
+  regions_(cfg_.blocks().size())
+{}
+
+ir_tier::~ir_tier() noexcept = default;
+
+auto ir_tier::eval_until_io_or_halt(int_computer_state& s) -> io_pending {
+  eval_budget unlimited;
+  return eval_until_io_or_halt(s, unlimited);
+}
+
+auto ir_tier::eval_until_io_or_halt(int_computer_state& s, eval_budget& budget) -> io_pending {
+  if (s.empty()) throw bad_program_error("empty program");
+  if (s.tracer != nullptr || s.size() != cfg_.program_size()) return s.eval_until_io_or_halt(budget);
+  s.rehash_();
+
+  for (;;) {
+    if (s.pc_ >= s.size()) throw std::out_of_range("jump target out of range");
+
+    if (const auto idx = cfg_.block_index(s.pc_)) {
+      auto& r = regions_[*idx];
+      if (r != nullptr && !guard_(*r, s)) {
+        // The program modified the region: deoptimise, and start counting anew.
+        r.reset();
+        heat_[*idx] = 0;
+        ++deopts_;
+      } else if (r == nullptr && ++heat_[*idx] >= hot_threshold_) {
+        r = build_(s, s.pc_);
+        ++built_;
+      }
+
+      if (r != nullptr && r->instructions != 0u && budget.step(r->instructions)) {
+        run_(*r, s, budget);
+        continue;
+      }
+    }
+
+    switch (opcode(s.opcodes_[s.pc_] % 100)) {
+      default:
+        if (!budget.step()) return io_pending::budget_exhausted;
+        s.eval1();
+        break;
+      case opcode::halt:
+        telemetry::add(telemetry::counter::halts);
+        return io_pending::halt;
+      case opcode::read:
+        return io_pending::read;
+      case opcode::write:
+        return io_pending::write;
+    }
+  }
+}
+
+auto ir_tier::eval(int_computer_state& s) -> int_computer_state& {
+  while (eval_until_io_or_halt(s) != io_pending::halt)
+    s.eval1(); // I/O through the callbacks.
+  return s;
+}
+
+auto ir_tier::dump(size_type pc) const -> std::string {
+  const auto idx = cfg_.block_index(pc);
+  if (!idx || regions_[*idx] == nullptr) return {};
+  const region& r = *regions_[*idx];
+
+  std::ostringstream out;
+  const auto reg = [&r, &out](std::uint32_t i) -> std::ostream& {
+    // Registers not assigned by an instruction are constants.
+    const bool assigned = std::any_of(r.code.begin(), r.code.end(),
+        [i](const region::instr& x) { return x.dst == i; });
+    if (assigned) return out << "r" << i;
+    return out << r.regs[i];
+  };
+
+  out << "region " << r.entry << ", " << r.instructions << " instructions\n";
+  for (const auto& i : r.code) {
+    out << "  r" << i.dst << " = ";
+    switch (i.o) {
+      case region::op::load:
+        out << "load [" << i.a << "]";
+        break;
+      case region::op::add:
+        reg(i.a) << " + ";
+        reg(i.b);
+        break;
+      case region::op::mul:
+        reg(i.a) << " * ";
+        reg(i.b);
+        break;
+      case region::op::less_than:
+        reg(i.a) << " < ";
+        reg(i.b);
+        break;
+      case region::op::equals:
+        reg(i.a) << " == ";
+        reg(i.b);
+        break;
+    }
+    out << "\n";
+  }
+  for (const auto& st : r.stores) {
+    out << "  [" << st.addr << "] = ";
+    reg(st.src) << "\n";
+  }
+  switch (r.exit) {
+    case region::exit_kind::jump:
+      out << "  jump ";
+      reg(r.target) << "\n";
+      break;
+    case region::exit_kind::jump_if_true:
+      out << "  jump_if_true ";
+      reg(r.cond) << " ";
+      reg(r.target) << " else " << r.fallthrough << "\n";
+      break;
+    case region::exit_kind::jump_if_false:
+      out << "  jump_if_false ";
+      reg(r.cond) << " ";
+      reg(r.target) << " else " << r.fallthrough << "\n";
+      break;
+  }
+  return out.str();
+}
+
+auto ir_tier::build_(const int_computer_state& s, size_type entry) const -> std::unique_ptr<region> {
+  // A trace must not store to its own instruction words, which may not be
+  // known to the control flow graph: shorten it until it doesn't.
+  std::size_t limit = max_trace;
+  for (;;) {
+    std::size_t conflict;
+    auto r = build_trace_(s, entry, limit, conflict);
+    if (conflict == no_conflict) return r;
+    limit = conflict;
+  }
+}
+
+///\brief Build a trace of at most \p limit instructions at \p entry.
+///\param[out] conflict Index of the first instruction in the trace that stores
+///to an instruction word of the trace, or no_conflict.
+auto ir_tier::build_trace_(const int_computer_state& s, size_type entry, std::size_t limit, std::size_t& conflict) const -> std::unique_ptr<region> {
+  auto r = std::make_unique<region>();
+  r->entry = entry;
+
+  std::vector<bool> is_const;
+  std::unordered_map<value_type, std::uint32_t> consts;
+  std::unordered_map<size_type, std::uint32_t> mem, loaded;
+  std::vector<size_type> dirty;
+  std::vector<std::pair<std::size_t, size_type>> store_sites;
+
+  const auto new_reg = [&r, &is_const](bool c, value_type v = 0) -> std::uint32_t {
+    r->regs.push_back(v);
+    is_const.push_back(c);
+    return std::uint32_t(r->regs.size() - 1u);
+  };
+  const auto constant = [&consts, &new_reg](value_type v) -> std::uint32_t {
+    const auto iter = consts.find(v);
+    if (iter != consts.end()) return iter->second;
+    return consts.emplace(v, new_reg(true, v)).first->second;
+  };
+  const auto operand = [&r, &mem, &loaded, &constant, &new_reg](const control_flow_graph::operand& arg) -> std::uint32_t {
+    if (arg.mode == addressing_mode::immediate) return constant(arg.value);
+    const auto addr = size_type(arg.value);
+    const auto iter = mem.find(addr);
+    if (iter != mem.end()) return iter->second;
+
+    const std::uint32_t dst = new_reg(false);
+    r->code.push_back({ region::op::load, dst, std::uint32_t(addr), 0u });
+    mem.emplace(addr, dst);
+    loaded.emplace(addr, dst);
+    return dst;
+  };
+  const auto compute = [&r, &is_const, &constant, &new_reg](region::op o, std::uint32_t a, std::uint32_t b) -> std::uint32_t {
+    if (is_const[a] && is_const[b]) {
+      const value_type x = r->regs[a], y = r->regs[b];
+      switch (o) {
+        default:
+          break;
+        case region::op::add:
+          return constant(x + y);
+        case region::op::mul:
+          return constant(x * y);
+        case region::op::less_than:
+          return constant(x < y ? 1 : 0);
+        case region::op::equals:
+          return constant(x == y ? 1 : 0);
+      }
+    }
+
+    // Identities.
+    if (o == region::op::add && is_const[b] && r->regs[b] == 0) return a;
+    if (o == region::op::add && is_const[a] && r->regs[a] == 0) return b;
+    if (o == region::op::mul && is_const[b] && r->regs[b] == 1) return a;
+    if (o == region::op::mul && is_const[a] && r->regs[a] == 1) return b;
+    if (o == region::op::mul && ((is_const[a] && r->regs[a] == 0) || (is_const[b] && r->regs[b] == 0))) return constant(0);
+    if (o == region::op::less_than && a == b) return constant(0);
+    if (o == region::op::equals && a == b) return constant(1);
+
+    const std::uint32_t dst = new_reg(false);
+    r->code.push_back({ o, dst, a, b });
+    return dst;
+  };
+  const auto stop = [&r, &constant](size_type pc) {
+    r->exit = region::exit_kind::jump;
+    r->target = constant(value_type(pc));
+  };
+
+  std::unordered_set<size_type> visited{ entry };
+  size_type pc = entry;
+  for (;;) {
+    const auto d = control_flow_graph::decode(s, pc);
+    if (!d || r->instructions == limit) {
+      stop(pc);
+      break;
+    }
+
+    bool stores_code = false;
+    if (control_flow_graph::stores(d->op)) {
+      const auto addr = size_type(d->output().value);
+      stores_code = cfg_.is_code(addr)
+          || std::any_of(r->words.begin(), r->words.end(),
+              [addr](const auto& w) { return addr >= w.first && addr < w.second; });
+    }
+    if (stores_code || d->op == opcode::read || d->op == opcode::write || d->op == opcode::halt) {
+      // Left to the interpreter.
+      stop(pc);
+      break;
+    }
+
+    // Record the instruction words, for the guard.
+    if (!r->words.empty() && r->words.back().second == pc)
+      r->words.back().second = d->next();
+    else
+      r->words.emplace_back(pc, d->next());
+    for (size_type i = pc; i < d->next(); ++i) r->word_values.push_back(s[i]);
+    ++r->instructions;
+
+    const auto assign = [&](std::uint32_t v) {
+      const auto addr = size_type(d->output().value);
+      if (std::find(dirty.begin(), dirty.end(), addr) == dirty.end()) dirty.push_back(addr);
+      mem[addr] = v;
+      store_sites.emplace_back(r->instructions - 1u, addr);
+    };
+
+    switch (d->op) {
+      default:
+        throw std::logic_error("ir_tier: unexpected opcode");
+      case opcode::add:
+        assign(compute(region::op::add, operand(d->args[0]), operand(d->args[1])));
+        pc = d->next();
+        continue;
+      case opcode::mul:
+        assign(compute(region::op::mul, operand(d->args[0]), operand(d->args[1])));
+        pc = d->next();
+        continue;
+      case opcode::less_than:
+        assign(compute(region::op::less_than, operand(d->args[0]), operand(d->args[1])));
+        pc = d->next();
+        continue;
+      case opcode::equals:
+        assign(compute(region::op::equals, operand(d->args[0]), operand(d->args[1])));
+        pc = d->next();
+        continue;
+      case opcode::jump_if_true: [[fallthrough]];
+      case opcode::jump_if_false:
+        break;
+    }
+
+    const std::uint32_t cond = operand(d->args[0]);
+    const std::uint32_t target = operand(d->args[1]);
+    if (!is_const[cond]) {
+      r->exit = (d->op == opcode::jump_if_true ? region::exit_kind::jump_if_true : region::exit_kind::jump_if_false);
+      r->cond = cond;
+      r->target = target;
+      r->fallthrough = d->next();
+      break;
+    }
+
+    // Jump threading: the direction of the jump is known.
+    const bool taken = (r->regs[cond] != 0) == (d->op == opcode::jump_if_true);
+    if (!taken) {
+      pc = d->next();
+      continue;
+    }
+    if (!is_const[target]) {
+      r->exit = region::exit_kind::jump;
+      r->target = target;
+      break;
+    }
+    const value_type t = r->regs[target];
+    if (t < 0 || size_type(t) >= s.size() || !visited.insert(size_type(t)).second) {
+      stop(size_type(t));
+      break;
+    }
+    pc = size_type(t);
+  }
+
+  // Dead store elimination: only the last value of each cell is stored,
+  // and only if it differs from the value loaded at entry.
+  for (const size_type addr : dirty) {
+    const std::uint32_t v = mem.at(addr);
+    const auto iter = loaded.find(addr);
+    if (iter != loaded.end() && iter->second == v) continue;
+    r->stores.push_back({ addr, v });
+  }
+
+  conflict = no_conflict;
+  for (const auto& site : store_sites) {
+    const auto addr = site.second;
+    if (std::any_of(r->words.begin(), r->words.end(),
+            [addr](const auto& w) { return addr >= w.first && addr < w.second; })) {
+      conflict = site.first;
+      break;
+    }
+  }
+  return r;
+}
+
+auto ir_tier::guard_(const region& r, const int_computer_state& s) noexcept -> bool {
+  auto v = r.word_values.begin();
+  for (const auto& w : r.words) {
+    if (!std::equal(s.opcodes_.begin() + w.first, s.opcodes_.begin() + w.second, v)) return false;
+    v += w.second - w.first;
+  }
+  return true;
+}
+
+void ir_tier::run_(region& r, int_computer_state& s, eval_budget& budget) {
+  value_type*const mem = s.opcodes_.data();
+  value_type*const regs = r.regs.data();
+
+  do {
+    for (const auto& i : r.code) {
+      switch (i.o) {
+        case region::op::load:
+          regs[i.dst] = mem[i.a];
+          break;
+        case region::op::add:
+          regs[i.dst] = regs[i.a] + regs[i.b];
+          break;
+        case region::op::mul:
+          regs[i.dst] = regs[i.a] * regs[i.b];
+          break;
+        case region::op::less_than:
+          regs[i.dst] = (regs[i.a] < regs[i.b] ? 1 : 0);
+          break;
+        case region::op::equals:
+          regs[i.dst] = (regs[i.a] == regs[i.b] ? 1 : 0);
+          break;
+      }
+    }
+
+    for (const auto& st : r.stores) {
+      value_type& cell = mem[st.addr];
+      const value_type v = regs[st.src];
+      if (s.mem_hash_valid_)
+        s.mem_hash_ += int_computer_state::cell_hash_(st.addr, v) - int_computer_state::cell_hash_(st.addr, cell);
+      cell = v;
+    }
+    int_computer_state::count_interpreted_(r.instructions);
+
+    switch (r.exit) {
+      case region::exit_kind::jump:
+        s.pc_ = size_type(regs[r.target]);
+        break;
+      case region::exit_kind::jump_if_true:
+        s.pc_ = (regs[r.cond] != 0 ? size_type(regs[r.target]) : r.fallthrough);
+        break;
+      case region::exit_kind::jump_if_false:
+        s.pc_ = (regs[r.cond] == 0 ? size_type(regs[r.target]) : r.fallthrough);
+        break;
+    }
+  } while (s.pc_ == r.entry && budget.step(r.instructions));
+}
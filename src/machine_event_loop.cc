@@ -0,0 +1,273 @@
+#include <machine_event_loop.hh>
+#include <int_scanner.hh>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+
+namespace {
+
+constexpr std::size_t read_size = 16 * 1024;
+
+} /* namespace <unnamed> */
+
+
+struct machine_event_loop::entry {
+  compact_machine m;
+  int in_fd, out_fd;
+  bool in_polled = false, out_polled = false; ///< False for regular files, which epoll doesn't support.
+  std::string in; ///< Input read from in_fd, from in_pos on not yet consumed.
+  std::size_t in_pos = 0;
+  bool in_eof = false;
+  std::string out; ///< Output not yet written, from out_pos on.
+  std::size_t out_pos = 0;
+  std::uint32_t waiting = 0; ///< Events the machine is parked on.
+  bool halting = false; ///< Halted, but output is not written yet.
+  machine_status status = machine_status::running;
+  std::string error;
+};
+
+
+machine_event_loop::machine_event_loop(std::uint64_t time_slice, std::size_t output_buffer)
+: time_slice_(std::max(time_slice, std::uint64_t(1))),
+  output_buffer_(output_buffer),
+  epoll_fd_(::epoll_create1(EPOLL_CLOEXEC))
+{
+  if (epoll_fd_ == -1) throw std::system_error(errno, std::system_category(), "epoll_create1");
+
+  struct sigaction sa{};
+  sa.sa_handler = SIG_IGN;
+  sigemptyset(&sa.sa_mask);
+  ::sigaction(SIGPIPE, &sa, &old_pipe_);
+}
+
+machine_event_loop::~machine_event_loop() {
+  for (const auto& e : machines_) {
+    if (e->status != machine_status::running) continue;
+    ::close(e->in_fd);
+    if (e->out_fd != e->in_fd) ::close(e->out_fd);
+  }
+  ::close(epoll_fd_);
+  ::sigaction(SIGPIPE, &old_pipe_, nullptr);
+}
+
+auto machine_event_loop::add(compact_machine m, int in_fd, int out_fd) -> machine_id {
+  auto e = std::make_unique<entry>();
+  e->m = std::move(m);
+  e->in_fd = in_fd;
+  e->out_fd = out_fd;
+
+  // Watch a descriptor, disarmed until the machine parks on it.
+  const auto watch = [this, &e](int fd) -> bool {
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags == -1 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+      throw std::system_error(errno, std::system_category(), "fcntl");
+
+    epoll_event ev{};
+    ev.events = EPOLLONESHOT;
+    ev.data.ptr = e.get();
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0) return true;
+    if (errno == EPERM) return false; // Regular file: always ready.
+    throw std::system_error(errno, std::system_category(), "epoll_ctl");
+  };
+  e->in_polled = watch(in_fd);
+  if (out_fd != in_fd) {
+    try {
+      e->out_polled = watch(out_fd);
+    } catch (...) {
+      if (e->in_polled) ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, in_fd, nullptr);
+      throw;
+    }
+  } else {
+    e->out_polled = e->in_polled;
+  }
+
+  ready_.push_back(e.get());
+  machines_.push_back(std::move(e));
+  ++active_;
+  return machines_.size() - 1u;
+}
+
+void machine_event_loop::run() {
+  while (active_ != 0u) run_once(-1);
+}
+
+auto machine_event_loop::run_once(int timeout_ms) -> std::size_t {
+  // Machines made ready during this turn run in the next one.
+  for (std::size_t n = ready_.size(); n != 0u; --n) {
+    entry*const e = ready_.front();
+    ready_.pop_front();
+    turn_(*e);
+  }
+  if (active_ == 0u) return 0;
+
+  epoll_event events[64];
+  const int n = ::epoll_wait(epoll_fd_, events, std::size(events), ready_.empty() ? timeout_ms : 0);
+  if (n == -1) {
+    if (errno == EINTR) return active_;
+    throw std::system_error(errno, std::system_category(), "epoll_wait");
+  }
+  for (int i = 0; i < n; ++i) {
+    auto*const e = static_cast<entry*>(events[i].data.ptr);
+    // Ignore events for machines that are already ready.
+    if (e->waiting == 0u || e->status != machine_status::running) continue;
+    e->waiting = 0;
+    ready_.push_back(e);
+  }
+  return active_;
+}
+
+auto machine_event_loop::status(machine_id id) const -> machine_status {
+  return machines_.at(id)->status;
+}
+
+auto machine_event_loop::error(machine_id id) const -> const std::string& {
+  return machines_.at(id)->error;
+}
+
+auto machine_event_loop::machine(machine_id id) const -> const compact_machine& {
+  return machines_.at(id)->m;
+}
+
+///\brief Run \p e until it parks, halts, fails, or uses up its time slice.
+void machine_event_loop::turn_(entry& e) {
+  try {
+    if (!e.halting) {
+      auto budget = eval_budget::steps(time_slice_);
+      for (bool running = true; running; ) {
+        switch (e.m.eval_until_io_or_halt(budget)) {
+          case compact_machine::io_pending::budget_exhausted:
+            flush_(e);
+            ready_.push_back(&e);
+            return;
+          case compact_machine::io_pending::halt:
+            e.halting = true;
+            running = false;
+            break;
+          case compact_machine::io_pending::read:
+            {
+              value_type v;
+              if (!next_input_(e, v)) {
+                if (e.in_eof) throw io_error("unexpected end of input");
+                // The peer may be waiting for our output, before sending more input.
+                const bool flushed = flush_(e);
+                park_(e, EPOLLIN | (flushed ? 0u : std::uint32_t(EPOLLOUT)));
+                return;
+              }
+              e.m.read(v);
+            }
+            break;
+          case compact_machine::io_pending::write:
+            {
+              char buf[24];
+              const auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf) - 1u, e.m.write());
+              *ptr = '\n';
+              e.out.append(buf, ptr + 1);
+            }
+            if (e.out.size() - e.out_pos >= output_buffer_ && !flush_(e)) {
+              park_(e, EPOLLOUT);
+              return;
+            }
+            break;
+        }
+      }
+    }
+
+    // Halted: finish once all output is written.
+    if (flush_(e))
+      finish_(e, machine_status::halted);
+    else
+      park_(e, EPOLLOUT);
+  } catch (const std::exception& ex) {
+    finish_(e, machine_status::failed, ex.what());
+  }
+}
+
+///\brief Parse the next input value, reading more input if needed.
+///\return False if no complete value is available yet, or at end of input.
+auto machine_event_loop::next_input_(entry& e, value_type& v) -> bool {
+  for (;;) {
+    switch (scan_int(e.in, e.in_pos, e.in_eof, v)) {
+      case scan_status::value:
+        return true;
+      case scan_status::end:
+        return false;
+      case scan_status::need_more:
+        break;
+    }
+
+    // Need more input.
+    e.in.erase(0, e.in_pos);
+    e.in_pos = 0;
+    char buf[read_size];
+    const ::ssize_t n = ::read(e.in_fd, buf, sizeof(buf));
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+      throw std::system_error(errno, std::system_category(), "read");
+    }
+    e.in.append(buf, n);
+    if (n == 0) e.in_eof = true;
+  }
+}
+
+///\brief Write pending output.
+///\return True if all output was written.
+auto machine_event_loop::flush_(entry& e) -> bool {
+  while (e.out_pos != e.out.size()) {
+    const ::ssize_t n = ::write(e.out_fd, e.out.data() + e.out_pos, e.out.size() - e.out_pos);
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+      throw std::system_error(errno, std::system_category(), "write");
+    }
+    e.out_pos += n;
+  }
+  e.out.clear();
+  e.out_pos = 0;
+  return true;
+}
+
+///\brief Wait for \p events (EPOLLIN on the input, EPOLLOUT on the output) before running \p e again.
+void machine_event_loop::park_(entry& e, std::uint32_t events) {
+  const bool in_ready = (events & EPOLLIN) != 0u && !e.in_polled;
+  const bool out_ready = (events & EPOLLOUT) != 0u && !e.out_polled;
+  if (in_ready || out_ready) {
+    // Regular files never block.
+    ready_.push_back(&e);
+    return;
+  }
+
+  const auto arm = [this, &e](int fd, std::uint32_t ev) {
+    epoll_event x{};
+    x.events = ev | EPOLLONESHOT;
+    x.data.ptr = &e;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &x) == -1)
+      throw std::system_error(errno, std::system_category(), "epoll_ctl");
+  };
+  if (e.in_fd == e.out_fd) {
+    arm(e.in_fd, events);
+  } else {
+    if ((events & EPOLLIN) != 0u) arm(e.in_fd, EPOLLIN);
+    if ((events & EPOLLOUT) != 0u) arm(e.out_fd, EPOLLOUT);
+  }
+  e.waiting = events;
+}
+
+void machine_event_loop::finish_(entry& e, machine_status s, std::string error) {
+  e.status = s;
+  e.error = std::move(error);
+  e.waiting = 0;
+  ::close(e.in_fd);
+  if (e.out_fd != e.in_fd) ::close(e.out_fd);
+  e.in = std::string();
+  e.out = std::string();
+  --active_;
+}
@@ -0,0 +1,37 @@
+#include <mapped_file.hh>
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+mapped_file::mapped_file(const std::string& filename) {
+  const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) throw std::system_error(errno, std::system_category(), "open " + filename);
+
+  struct ::stat st;
+  if (::fstat(fd, &st) == -1) {
+    const int e = errno;
+    ::close(fd);
+    throw std::system_error(e, std::system_category(), "stat " + filename);
+  }
+
+  size_ = st.st_size;
+  if (size_ != 0) {
+    void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      const int e = errno;
+      ::close(fd);
+      throw std::system_error(e, std::system_category(), "mmap " + filename);
+    }
+    ::madvise(addr, size_, MADV_WILLNEED);
+    data_ = static_cast<const char*>(addr);
+  }
+  ::close(fd);
+}
+
+mapped_file::~mapped_file() {
+  if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+}
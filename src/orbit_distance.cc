@@ -0,0 +1,145 @@
+#include <orbit_distance.hh>
+#include <parallel_for.hh>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+
+orbit_distance_index::orbit_distance_index(const orbit_table& t) {
+  const std::size_t n = t.size();
+  const auto& parent = t.parents();
+
+  // Children of each body, in compressed form.
+  std::vector<id_type> child_begin(n + 1u, 0u);
+  for (const id_type p : parent)
+    if (p != npos) ++child_begin[p + 1u];
+  std::partial_sum(child_begin.begin(), child_begin.end(), child_begin.begin());
+  std::vector<id_type> children(child_begin.back());
+  {
+    std::vector<id_type> fill(child_begin.begin(), child_begin.end() - 1);
+    for (id_type id = 0; id < n; ++id)
+      if (parent[id] != npos) children[fill[parent[id]]++] = id;
+  }
+
+  // Breadth first order, so every parent precedes its children.
+  std::vector<id_type> order;
+  order.reserve(n);
+  for (id_type id = 0; id < n; ++id)
+    if (parent[id] == npos) order.push_back(id);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const id_type v = order[i];
+    order.insert(order.end(), children.begin() + child_begin[v], children.begin() + child_begin[v + 1u]);
+  }
+  if (order.size() != n) throw std::runtime_error("orbit map contains a cycle");
+
+  std::vector<id_type> subtree_size(n, 1u);
+  std::for_each(order.rbegin(), order.rend(),
+      [&](id_type v) {
+        if (parent[v] != npos) subtree_size[parent[v]] += subtree_size[v];
+      });
+
+  // Assign positions depth first, visiting the heavy child right after its parent.
+  nodes_.resize(n);
+  pos_.assign(n, npos);
+  id_.resize(n);
+  id_type next_pos = 0;
+  std::vector<id_type> stack;
+  for (id_type root = 0; root < n; ++root) {
+    if (parent[root] != npos) continue;
+
+    stack.push_back(root);
+    while (!stack.empty()) {
+      const id_type v = stack.back();
+      stack.pop_back();
+
+      const id_type p = next_pos++;
+      pos_[v] = p;
+      id_[p] = v;
+      if (parent[v] == npos) {
+        nodes_[p] = node{ p, npos, 0u };
+      } else {
+        const node& pn = nodes_[pos_[parent[v]]];
+        // The heavy child is pushed last, so it directly follows its parent.
+        const bool heavy = (p == pos_[parent[v]] + 1u);
+        nodes_[p] = node{ heavy ? pn.head : p, pos_[parent[v]], pn.depth + 1u };
+      }
+
+      const auto cb = children.begin() + child_begin[v];
+      const auto ce = children.begin() + child_begin[v + 1u];
+      if (cb == ce) continue;
+      const auto heavy_child = std::max_element(cb, ce,
+          [&subtree_size](id_type x, id_type y) { return subtree_size[x] < subtree_size[y]; });
+      for (auto i = cb; i != ce; ++i)
+        if (i != heavy_child) stack.push_back(*i);
+      stack.push_back(*heavy_child);
+    }
+  }
+}
+
+auto orbit_distance_index::distance(id_type a, id_type b) const -> id_type {
+  return distance_(pos_of_(a), pos_of_(b));
+}
+
+auto orbit_distance_index::common_ancestor(id_type a, id_type b) const -> id_type {
+  const id_type p = lca_(pos_of_(a), pos_of_(b));
+  return p == npos ? npos : id_[p];
+}
+
+void orbit_distance_index::distances(const query* b, const query* e, id_type* out, unsigned int threads) const {
+  struct item {
+    id_type a, b; // Positions.
+    std::size_t index;
+  };
+
+  // Bucket the queries on the high bits of the position of their first body,
+  // so consecutive queries start on nearby chains.
+  unsigned int shift = 0;
+  while ((pos_.size() >> shift) > 4096u) ++shift;
+  std::vector<std::size_t> bucket_begin((pos_.size() >> shift) + 2u, 0u);
+  for (const query* q = b; q != e; ++q)
+    ++bucket_begin[(pos_of_(q->first) >> shift) + 1u];
+  std::partial_sum(bucket_begin.begin(), bucket_begin.end(), bucket_begin.begin());
+
+  const std::size_t n = e - b;
+  std::vector<item> items(n);
+  for (const query* q = b; q != e; ++q) {
+    const id_type pa = pos_[q->first];
+    items[bucket_begin[pa >> shift]++] = item{ pa, pos_of_(q->second), std::size_t(q - b) };
+  }
+
+  threads = std::max(1u, std::min<unsigned int>(threads, (n + 1023u) / 1024u));
+  parallel_for(threads,
+      [&](unsigned int i) {
+        const auto ib = items.begin() + n * i / threads;
+        const auto ie = items.begin() + n * (i + 1u) / threads;
+        for (auto it = ib; it != ie; ++it) out[it->index] = distance_(it->a, it->b);
+      });
+}
+
+auto orbit_distance_index::distances(const std::vector<query>& queries, unsigned int threads) const
+-> std::vector<id_type> {
+  std::vector<id_type> result(queries.size());
+  distances(queries.data(), queries.data() + queries.size(), result.data(), threads);
+  return result;
+}
+
+auto orbit_distance_index::lca_(id_type a, id_type b) const noexcept -> id_type {
+  while (nodes_[a].head != nodes_[b].head) {
+    if (nodes_[nodes_[a].head].depth < nodes_[nodes_[b].head].depth) std::swap(a, b);
+    const id_type up = nodes_[nodes_[a].head].parent;
+    if (up == npos) return npos; // Both heads are roots, of different trees.
+    a = up;
+  }
+  return nodes_[a].depth < nodes_[b].depth ? a : b;
+}
+
+auto orbit_distance_index::distance_(id_type a, id_type b) const noexcept -> id_type {
+  const id_type c = lca_(a, b);
+  if (c == npos) return no_path;
+  return nodes_[a].depth + nodes_[b].depth - 2u * nodes_[c].depth;
+}
+
+auto orbit_distance_index::pos_of_(id_type id) const -> id_type {
+  if (id >= pos_.size()) throw std::out_of_range("orbit_distance_index: no such body");
+  return pos_[id];
+}
@@ -0,0 +1,168 @@
+#include <orbit_image.hh>
+#include <atomic_file.hh>
+#include <mapped_file.hh>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr char magic[8] = { 'O', 'R', 'B', 'I', 'T', 'I', 'M', '1' };
+constexpr std::uint32_t flag_depths = 0x1u;
+
+struct header {
+  char magic[8];
+  std::uint32_t count;
+  std::uint32_t flags;
+  std::uint64_t names_size;
+};
+static_assert(sizeof(header) == 24u);
+
+///\brief Byte offsets of each section in an image.
+struct layout {
+  layout(std::uint64_t count, std::uint32_t flags, std::uint64_t names_size) noexcept
+  : name_offsets(sizeof(header)),
+    parent(name_offsets + 8u * (count + 1u)),
+    depth(parent + 4u * count),
+    sorted(depth + ((flags & flag_depths) ? 4u * count : 0u)),
+    names(sorted + 4u * count),
+    total(names + names_size)
+  {}
+
+  std::uint64_t name_offsets, parent, depth, sorted, names, total;
+};
+
+template<typename T>
+void append_array(std::string& out, const std::vector<T>& v) {
+  out.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+} /* namespace <unnamed> */
+
+
+void orbit_image::write(const std::string& filename, const orbit_table& t, bool with_depths) {
+  const std::uint32_t count = t.size();
+
+  std::vector<std::uint64_t> name_offsets;
+  name_offsets.reserve(count + 1u);
+  std::uint64_t names_size = 0;
+  for (id_type id = 0; id < count; ++id) {
+    name_offsets.push_back(names_size);
+    names_size += t.name(id).size();
+  }
+  name_offsets.push_back(names_size);
+
+  std::vector<id_type> sorted(count);
+  std::iota(sorted.begin(), sorted.end(), id_type(0));
+  std::sort(sorted.begin(), sorted.end(),
+      [&t](id_type x, id_type y) { return t.name(x) < t.name(y); });
+
+  header h;
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.count = count;
+  h.flags = (with_depths ? flag_depths : 0u);
+  h.names_size = names_size;
+
+  std::string data;
+  data.reserve(layout(count, h.flags, names_size).total);
+  data.append(reinterpret_cast<const char*>(&h), sizeof(h));
+  append_array(data, name_offsets);
+  append_array(data, t.parents());
+  if (with_depths) append_array(data, t.depths());
+  append_array(data, sorted);
+  for (id_type id = 0; id < count; ++id) data += t.name(id);
+
+  atomic_replace_file(filename, data);
+}
+
+void orbit_image::write(const std::string& filename, const orbit_map& m, bool with_depths) {
+  write(filename, orbit_table(m), with_depths);
+}
+
+orbit_image::orbit_image(const std::string& filename)
+: file_(std::make_shared<const mapped_file>(filename))
+{
+  header h;
+  if (file_->size() < sizeof(h)) throw std::runtime_error(filename + ": not an orbit image");
+  std::memcpy(&h, file_->data(), sizeof(h));
+  if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+    throw std::runtime_error(filename + ": not an orbit image");
+  if (h.count == npos)
+    throw std::runtime_error(filename + ": corrupt orbit image");
+
+  const layout l(h.count, h.flags, h.names_size);
+  if (h.names_size > file_->size() || l.total != file_->size())
+    throw std::runtime_error(filename + ": corrupt orbit image");
+
+  const char* const base = file_->data();
+  count_ = h.count;
+  name_offsets_ = reinterpret_cast<const std::uint64_t*>(base + l.name_offsets);
+  parent_ = reinterpret_cast<const id_type*>(base + l.parent);
+  if (h.flags & flag_depths) depth_ = reinterpret_cast<const std::uint32_t*>(base + l.depth);
+  sorted_ = reinterpret_cast<const id_type*>(base + l.sorted);
+  names_ = base + l.names;
+
+  if (name_offsets_[0] != 0u || name_offsets_[count_] != h.names_size)
+    throw std::runtime_error(filename + ": corrupt orbit image");
+}
+
+auto orbit_image::name(id_type id) const -> std::string_view {
+  if (id >= count_) throw std::out_of_range("orbit_image: no such body");
+  const std::uint64_t b = name_offsets_[id], e = name_offsets_[id + 1u];
+  if (b > e || e > name_offsets_[count_]) throw std::runtime_error("corrupt orbit image");
+  return std::string_view(names_ + b, e - b);
+}
+
+auto orbit_image::parent(id_type id) const -> id_type {
+  if (id >= count_) throw std::out_of_range("orbit_image: no such body");
+  return parent_[id];
+}
+
+auto orbit_image::depth(id_type id) const -> size_type {
+  if (id >= count_) throw std::out_of_range("orbit_image: no such body");
+  if (depth_ != nullptr) return depth_[id];
+
+  size_type result = 0;
+  for (id = parent_[id]; id != npos; id = parent(id)) {
+    if (++result > count_) throw std::runtime_error("corrupt orbit image");
+  }
+  return result;
+}
+
+auto orbit_image::find(std::string_view name) const -> id_type {
+  const auto name_of = [this](id_type id) {
+    if (id >= count_) throw std::runtime_error("corrupt orbit image");
+    const std::uint64_t b = name_offsets_[id], e = name_offsets_[id + 1u];
+    if (b > e || e > name_offsets_[count_]) throw std::runtime_error("corrupt orbit image");
+    return std::string_view(names_ + b, e - b);
+  };
+
+  const auto iter = std::lower_bound(sorted_, sorted_ + count_, name,
+      [&name_of](id_type id, std::string_view n) { return name_of(id) < n; });
+  if (iter == sorted_ + count_ || name_of(*iter) != name) return npos;
+  return *iter;
+}
+
+auto orbit_image::body_of(std::string_view s) const -> std::optional<std::string_view> {
+  const id_type id = find(s);
+  if (id == npos || parent_[id] == npos) return {};
+  return name(parent_[id]);
+}
+
+auto orbit_image::path(std::string_view s, bool include_s) const -> std::vector<std::string_view> {
+  std::vector<std::string_view> result;
+  if (include_s) result.push_back(s);
+
+  const id_type id = find(s);
+  if (id != npos) {
+    for (id_type p = parent_[id]; p != npos; p = parent(p)) {
+      if (result.size() > count_) throw std::runtime_error("corrupt orbit image");
+      result.push_back(name(p));
+    }
+  }
+
+  std::reverse(result.begin(), result.end());
+  return result;
+}
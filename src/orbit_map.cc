@@ -65,6 +65,7 @@ auto orbit_map::parse(std::istream& in) -> orbit_map {
   if (!qi::phrase_parse(begin, end, g, ascii::space, result))
     throw std::runtime_error("parse failed");
 
+  result.rebuild_();
   return result;
 }
 
@@ -96,3 +97,108 @@ auto orbit_map::path(const satelite& s, bool include_s) const -> std::vector<bod
   std::reverse(result.begin(), result.end());
   return result;
 }
+
+void orbit_map::insert(const body& b, const satelite& s) {
+  if (map_.right.find(s) != map_.right.end())
+    throw std::invalid_argument("duplicate satelite");
+
+  const auto bv = vertex_(b);
+  const auto sv = vertex_(s);
+  try {
+    forest_.link(sv, bv);
+  } catch (...) {
+    drop_if_isolated_(b);
+    drop_if_isolated_(s);
+    throw;
+  }
+  map_.insert(value_type(b, s));
+}
+
+auto orbit_map::erase(const satelite& s) -> bool {
+  const auto iter = map_.right.find(s);
+  if (iter == map_.right.end()) return false;
+
+  const body b = iter->second;
+  map_.right.erase(iter);
+  forest_.cut(vertices_.at(s));
+  drop_if_isolated_(b);
+  drop_if_isolated_(s);
+  return true;
+}
+
+void orbit_map::reparent(const satelite& s, const body& b) {
+  const auto iter = map_.right.find(s);
+  if (iter == map_.right.end()) throw std::out_of_range("satelite doesn't orbit anything");
+  if (iter->second == b) return;
+
+  const body old_b = iter->second;
+  const auto sv = vertices_.at(s);
+  const auto bv = vertex_(b);
+  forest_.cut(sv);
+  try {
+    forest_.link(sv, bv);
+  } catch (...) {
+    forest_.link(sv, vertices_.at(old_b));
+    drop_if_isolated_(b);
+    throw;
+  }
+  map_.right.replace_data(iter, b);
+  drop_if_isolated_(old_b);
+}
+
+auto orbit_map::depth(const body& b) const -> size_type {
+  return forest_.depth(find_vertex_(b));
+}
+
+auto orbit_map::subtree_size(const body& b) const -> size_type {
+  return forest_.subtree_size(find_vertex_(b));
+}
+
+///\brief Rebuild the forest from the map.
+void orbit_map::rebuild_() {
+  std::vector<euler_tour_forest::vertex> parents;
+  vertices_.clear();
+  const auto id = [this, &parents](const body& b) -> euler_tour_forest::vertex {
+    const auto [iter, inserted] = vertices_.emplace(b, parents.size());
+    if (inserted) parents.push_back(euler_tour_forest::npos);
+    return iter->second;
+  };
+
+  for (const auto& e : map_.left) {
+    const auto bv = id(e.first);
+    parents[id(e.second)] = bv;
+  }
+  forest_.assign(parents);
+}
+
+auto orbit_map::vertex_(const body& b) -> euler_tour_forest::vertex {
+  const auto iter = vertices_.find(b);
+  if (iter != vertices_.end()) return iter->second;
+
+  const auto v = forest_.add_vertex();
+  try {
+    vertices_.emplace(b, v);
+  } catch (...) {
+    forest_.remove_vertex(v);
+    throw;
+  }
+  return v;
+}
+
+auto orbit_map::find_vertex_(const body& b) const -> euler_tour_forest::vertex {
+  const auto iter = vertices_.find(b);
+  if (iter == vertices_.end()) throw std::out_of_range("no such body");
+  return iter->second;
+}
+
+///\brief Forget \p b, if it no longer takes part in any orbit.
+void orbit_map::drop_if_isolated_(const body& b) {
+  const auto iter = vertices_.find(b);
+  if (iter == vertices_.end()) return;
+  if (forest_.parent(iter->second) != euler_tour_forest::npos
+      || forest_.subtree_size(iter->second) != 1u)
+    return;
+
+  forest_.remove_vertex(iter->second);
+  vertices_.erase(iter);
+}
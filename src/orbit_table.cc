@@ -0,0 +1,316 @@
+#include <orbit_table.hh>
+#include <mapped_file.hh>
+#include <parallel_for.hh>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+
+namespace {
+
+auto is_name_char(char c) noexcept -> bool {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+auto is_space(char c) noexcept -> bool {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+} /* namespace <unnamed> */
+
+
+orbit_table::orbit_table(const orbit_map& m) {
+  const auto bodies = m.all_bodies();
+  if (bodies.size() >= npos) throw std::length_error("too many bodies");
+
+  auto blob = std::make_shared<std::string>();
+  blob->reserve(std::accumulate(bodies.begin(), bodies.end(), std::size_t(0),
+          [](std::size_t n, const std::string& s) { return n + s.size(); }));
+  std::vector<std::size_t> offsets;
+  for (const auto& b : bodies) {
+    offsets.push_back(blob->size());
+    blob->append(b);
+  }
+
+  parts_.resize(1);
+  part_offsets_.assign(1, 0u);
+  std::size_t i = 0;
+  for (const auto& b : bodies) {
+    names_.emplace_back(blob->data() + offsets[i++], b.size());
+    parts_[0].emplace(names_.back(), id_type(names_.size() - 1u));
+  }
+
+  parent_.assign(names_.size(), npos);
+  for (const auto& e : m.satelite_map())
+    parent_[find(e.first)] = find(e.second);
+  storage_ = std::move(blob);
+}
+
+auto orbit_table::load(const std::string& filename, unsigned int threads) -> orbit_table {
+  auto file = std::make_shared<const mapped_file>(filename);
+  orbit_table result = parse(file->view(), threads);
+  result.storage_ = std::move(file);
+  return result;
+}
+
+auto orbit_table::parse(std::string_view text, unsigned int threads) -> orbit_table {
+  threads = std::max(threads, 1u);
+  const auto chunk_text = split_(text, threads);
+
+  std::vector<pair_list> chunks(chunk_text.size());
+  parallel_for(chunk_text.size(),
+      [&chunk_text, &chunks](unsigned int i) {
+        chunks[i] = parse_chunk_(chunk_text[i]);
+      });
+
+  orbit_table result;
+  result.build_(chunks, threads);
+  return result;
+}
+
+auto orbit_table::find(std::string_view name) const -> id_type {
+  return find_(name, std::hash<std::string_view>()(name));
+}
+
+auto orbit_table::find_(std::string_view name, std::size_t hash) const -> id_type {
+  if (parts_.empty()) return npos;
+
+  const std::size_t part = (hash >> 32) % parts_.size();
+  const auto iter = parts_[part].find(name);
+  if (iter == parts_[part].end()) return npos;
+  return part_offsets_[part] + iter->second;
+}
+
+auto orbit_table::to_orbit_map() const -> orbit_map {
+  std::vector<orbit_map::value_type> pairs;
+  pairs.reserve(names_.size());
+  for (id_type id = 0; id < names_.size(); ++id) {
+    if (parent_[id] != npos)
+      pairs.emplace_back(std::string(names_[parent_[id]]), std::string(names_[id]));
+  }
+  return orbit_map(pairs.begin(), pairs.end());
+}
+
+auto orbit_table::depths(unsigned int threads) const -> std::vector<id_type> {
+  threads = std::max(threads, 1u);
+  if (threads == 1u || names_.size() < 2u * threads) return sequential_depths_();
+  return parallel_depths_(threads);
+}
+
+auto orbit_table::total_orbits(unsigned int threads) const -> std::uint64_t {
+  threads = std::max(threads, 1u);
+  const auto d = depths(threads);
+
+  std::vector<std::uint64_t> partial(threads, 0u);
+  parallel_for(threads,
+      [&d, &partial, threads](unsigned int i) {
+        const auto b = d.begin() + d.size() * i / threads;
+        const auto e = d.begin() + d.size() * (i + 1u) / threads;
+        partial[i] = std::accumulate(b, e, std::uint64_t(0));
+      });
+  return std::accumulate(partial.begin(), partial.end(), std::uint64_t(0));
+}
+
+///\brief Linear time depth computation, memoizing every walk towards the root.
+auto orbit_table::sequential_depths_() const -> std::vector<id_type> {
+  std::vector<id_type> result(names_.size(), npos);
+  std::vector<id_type> path;
+
+  for (id_type id = 0; id < names_.size(); ++id) {
+    id_type v = id;
+    while (v != npos && result[v] == npos) {
+      if (path.size() == names_.size())
+        throw std::runtime_error("orbit map contains a cycle");
+      path.push_back(v);
+      v = parent_[v];
+    }
+
+    id_type d = (v == npos ? 0u : result[v] + 1u);
+    for (; !path.empty(); path.pop_back()) result[path.back()] = d++;
+  }
+  return result;
+}
+
+///\brief Depth computation by pointer jumping.
+///\details
+///Every body holds an (ancestor, distance to ancestor) pair, packed in a single
+///atomic word so other threads always observe a consistent pair.
+///Each round replaces the ancestor by the ancestor's ancestor, until it reaches a root.
+///
+///Updates are done in place, so a round can only make more progress than a
+///synchronous round would: after round k, every ancestor is at least
+///2^k levels up. Bodies that reached their root are dropped from the work list.
+auto orbit_table::parallel_depths_(unsigned int threads) const -> std::vector<id_type> {
+  const std::size_t n = names_.size();
+  const auto pack = [](id_type ancestor, id_type distance) -> std::uint64_t {
+    return std::uint64_t(ancestor) << 32 | distance;
+  };
+  const auto ancestor = [](std::uint64_t x) -> id_type { return x >> 32; };
+  const auto distance = [](std::uint64_t x) -> id_type { return x & 0xffffffffu; };
+
+  const auto state = std::make_unique<std::atomic<std::uint64_t>[]>(n);
+  std::vector<std::vector<id_type>> active(threads);
+  parallel_for(threads,
+      [&](unsigned int i) {
+        for (std::size_t id = n * i / threads; id < n * (i + 1u) / threads; ++id) {
+          const id_type p = parent_[id];
+          state[id].store(pack(p, p == npos ? 0u : 1u), std::memory_order_relaxed);
+          if (p != npos) active[i].push_back(id);
+        }
+      });
+
+  std::vector<id_type> work;
+  for (unsigned int round = 0; ; ++round) {
+    work.clear();
+    for (const auto& a : active) work.insert(work.end(), a.begin(), a.end());
+    if (work.empty()) break;
+    if (round > 32u) throw std::runtime_error("orbit map contains a cycle");
+
+    parallel_for(threads,
+        [&](unsigned int i) {
+          auto& out = active[i];
+          out.clear();
+          const std::size_t b = work.size() * i / threads;
+          const std::size_t e = work.size() * (i + 1u) / threads;
+          for (std::size_t j = b; j < e; ++j) {
+            const id_type id = work[j];
+            const std::uint64_t self = state[id].load(std::memory_order_relaxed);
+            const std::uint64_t up = state[ancestor(self)].load(std::memory_order_relaxed);
+            state[id].store(pack(ancestor(up), distance(self) + distance(up)), std::memory_order_relaxed);
+            if (ancestor(up) != npos) out.push_back(id);
+          }
+        });
+  }
+
+  std::vector<id_type> result(n);
+  parallel_for(threads,
+      [&](unsigned int i) {
+        for (std::size_t id = n * i / threads; id < n * (i + 1u) / threads; ++id)
+          result[id] = distance(state[id].load(std::memory_order_relaxed));
+      });
+  return result;
+}
+
+///\brief Parse `A)B` pairs, separated by white space.
+auto orbit_table::parse_chunk_(std::string_view text) -> pair_list {
+  pair_list result;
+  const char* p = text.data();
+  const char* const end = text.data() + text.size();
+
+  const auto skip_space = [&p, end]() {
+    while (p != end && is_space(*p)) ++p;
+  };
+  const auto read_name = [&p, end]() -> name_ref {
+    const char* const b = p;
+    while (p != end && is_name_char(*p)) ++p;
+    if (b == p) throw std::runtime_error("parse failed");
+    const auto name = std::string_view(b, p - b);
+    return { name, std::hash<std::string_view>()(name) };
+  };
+
+  for (skip_space(); p != end; skip_space()) {
+    const name_ref body = read_name();
+    skip_space();
+    if (p == end || *p != ')') throw std::runtime_error("parse failed");
+    ++p;
+    skip_space();
+    const name_ref satelite = read_name();
+    result.emplace_back(body, satelite);
+  }
+  return result;
+}
+
+///\brief Split \p text in up to \p chunks pieces.
+///\details
+///Text is only split at a line break between the end of one pair and the start
+///of the next pair, as white space is also allowed inside a pair.
+auto orbit_table::split_(std::string_view text, unsigned int chunks) -> std::vector<std::string_view> {
+  std::vector<std::string_view> result;
+  std::size_t begin = 0;
+
+  for (unsigned int i = 1; i < chunks; ++i) {
+    std::size_t pos = std::max(begin, text.size() / chunks * i);
+    for (;;) {
+      pos = text.find('\n', pos);
+      if (pos == std::string_view::npos) break;
+
+      std::size_t prev = pos;
+      while (prev > begin && is_space(text[prev - 1u])) --prev;
+      std::size_t next = pos + 1u;
+      while (next < text.size() && is_space(text[next])) ++next;
+      if (prev > begin && is_name_char(text[prev - 1u])
+          && next < text.size() && is_name_char(text[next]))
+        break;
+      ++pos;
+    }
+    if (pos == std::string_view::npos) break;
+
+    result.push_back(text.substr(begin, pos - begin));
+    begin = pos + 1u;
+  }
+  result.push_back(text.substr(begin));
+  return result;
+}
+
+///\brief Assign ids to all names, and fill in the parent array.
+///\details
+///Names are partitioned by hash, and each partition is numbered on its own thread.
+void orbit_table::build_(const std::vector<pair_list>& chunks, unsigned int threads) {
+  const unsigned int nparts = std::max(threads, 1u);
+  const auto part_of = [nparts](std::size_t hash) -> unsigned int {
+    return (hash >> 32) % nparts;
+  };
+
+  parts_.assign(nparts, {});
+  std::vector<std::vector<std::string_view>> part_names(nparts);
+  parallel_for(nparts,
+      [this, &chunks, &part_names, &part_of](unsigned int part) {
+        auto& map = parts_[part];
+        auto& names = part_names[part];
+        std::vector<bool> is_satelite;
+
+        const auto add = [&map, &names, &is_satelite](const name_ref& n) -> id_type {
+          const auto [iter, inserted] = map.emplace(n.name, id_type(names.size()));
+          if (inserted) {
+            names.push_back(n.name);
+            is_satelite.push_back(false);
+          }
+          return iter->second;
+        };
+
+        for (const auto& chunk : chunks) {
+          for (const auto& [body, satelite] : chunk) {
+            if (part_of(body.hash) == part) add(body);
+            if (part_of(satelite.hash) == part) {
+              const id_type id = add(satelite);
+              if (is_satelite[id])
+                throw std::runtime_error("parse error: duplicate satelite");
+              is_satelite[id] = true;
+            }
+          }
+        }
+      });
+
+  part_offsets_.clear();
+  std::size_t total = 0;
+  for (const auto& names : part_names) {
+    part_offsets_.push_back(total);
+    total += names.size();
+  }
+  if (total >= npos) throw std::length_error("too many bodies");
+
+  names_.clear();
+  names_.reserve(total);
+  for (const auto& names : part_names)
+    names_.insert(names_.end(), names.begin(), names.end());
+
+  parent_.assign(total, npos);
+  parallel_for(chunks.size(),
+      [this, &chunks](unsigned int i) {
+        for (const auto& [body, satelite] : chunks[i])
+          parent_[find_(satelite.name, satelite.hash)] = find_(body.name, body.hash);
+      });
+}
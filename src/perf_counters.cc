@@ -0,0 +1,184 @@
+#include <perf_counters.hh>
+#include <int_computer.hh>
+#include <swallow_exceptions.hh>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <utility>
+#include <unistd.h>
+#if defined(__linux__)
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+#endif
+
+
+namespace {
+
+#if defined(__linux__)
+void event_attr(perf_counters::event e, ::perf_event_attr& attr) noexcept {
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  constexpr auto cache_event = [](std::uint64_t cache, std::uint64_t op, std::uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+  };
+
+  switch (e) {
+    case perf_counters::event::cycles:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case perf_counters::event::instructions:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case perf_counters::event::branch_misses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case perf_counters::event::l1d_read_misses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+      break;
+    case perf_counters::event::llc_misses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+  }
+}
+#endif
+
+} /* namespace <unnamed> */
+
+
+auto perf_counters::event_name(event e) noexcept -> const char* {
+  switch (e) {
+    case event::cycles:          return "cycles";
+    case event::instructions:    return "instructions";
+    case event::branch_misses:   return "branch-misses";
+    case event::l1d_read_misses: return "L1d-read-misses";
+    case event::llc_misses:      return "LLC-misses";
+  }
+  return "???";
+}
+
+perf_counters::perf_counters() {
+  fds_.fill(-1);
+
+#if defined(__linux__)
+  int first_error = 0;
+  for (std::size_t i = 0; i < event_count; ++i) {
+    ::perf_event_attr attr;
+    event_attr(event(i), attr);
+    const long fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd == -1) {
+      if (first_error == 0) first_error = errno;
+      continue;
+    }
+    fds_[i] = fd;
+  }
+
+  bool any = false;
+  for (const int fd : fds_) any |= (fd != -1);
+  if (!any) unavailable_reason_ = std::string("perf_event_open: ") + std::strerror(first_error);
+#else
+  unavailable_reason_ = "perf events are only supported on linux";
+#endif
+}
+
+perf_counters::~perf_counters() {
+  for (const int fd : fds_)
+    if (fd != -1) ::close(fd);
+}
+
+void perf_counters::start() {
+#if defined(__linux__)
+  for (const int fd : fds_) {
+    if (fd == -1) continue;
+    ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+  interpreted_start_ = int_computer_state::interpreted_instructions();
+  start_time_ = std::chrono::steady_clock::now();
+}
+
+auto perf_counters::stop() -> reading {
+  reading r;
+  r.elapsed = std::chrono::steady_clock::now() - start_time_;
+  r.interpreted = int_computer_state::interpreted_instructions() - interpreted_start_;
+
+#if defined(__linux__)
+  for (std::size_t i = 0; i < event_count; ++i) {
+    if (fds_[i] == -1) continue;
+    ::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    std::uint64_t values[3]; // value, time enabled, time running
+    if (::read(fds_[i], values, sizeof(values)) != sizeof(values) || values[2] == 0u) continue;
+    // Scale up, if the counter was multiplexed with other events.
+    if (values[2] < values[1])
+      values[0] = static_cast<std::uint64_t>(double(values[0]) * values[1] / values[2]);
+    r.counts[i] = values[0];
+  }
+#endif
+  return r;
+}
+
+
+void write_report(std::ostream& out, const std::string& label, const perf_counters::reading& r) {
+  using event = perf_counters::event;
+
+  std::ostringstream s;
+  s << std::fixed << std::setprecision(3)
+      << label << ": " << std::chrono::duration<double, std::milli>(r.elapsed).count() << " ms, "
+      << r.interpreted << " instructions interpreted\n";
+
+  for (std::size_t i = 0; i < perf_counters::event_count; ++i) {
+    const auto e = event(i);
+    s << "  " << std::left << std::setw(16) << perf_counters::event_name(e) << std::right;
+    if (!r[e].has_value()) {
+      s << std::setw(16) << "unavailable" << "\n";
+      continue;
+    }
+
+    s << std::setw(16) << *r[e];
+    if (r.interpreted != 0u)
+      s << std::setw(12) << std::setprecision(3) << double(*r[e]) / r.interpreted << " per interpreted instruction";
+    if (e == event::instructions && r[event::cycles].has_value() && *r[event::cycles] != 0u)
+      s << ", IPC " << std::setprecision(2) << double(*r[e]) / *r[event::cycles];
+    s << "\n";
+  }
+  out << s.str() << std::flush;
+}
+
+
+perf_scope::perf_scope(std::string label)
+: perf_scope(std::move(label), std::cerr)
+{}
+
+perf_scope::perf_scope(std::string label, std::ostream& out)
+: label_(std::move(label)),
+  out_(out)
+{
+  if (!counters_.unavailable_reason().empty())
+    out_ << label_ << ": hardware counters unavailable (" << counters_.unavailable_reason() << ")\n";
+  counters_.start();
+}
+
+perf_scope::~perf_scope() {
+  swallow_exceptions([this]() { write_report(out_, label_, counters_.stop()); });
+}
+
+auto perf_scope::from_env(std::string label, const char* env) -> std::unique_ptr<perf_scope> {
+  if (std::getenv(env) == nullptr) return nullptr;
+  return std::make_unique<perf_scope>(std::move(label));
+}
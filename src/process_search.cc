@@ -0,0 +1,228 @@
+#include <process_search.hh>
+#include <telemetry.hh>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace {
+
+using value_type = process_search::value_type;
+
+///\brief Anonymous shared mapping, inherited by forked workers.
+class shared_mapping {
+  public:
+  explicit shared_mapping(std::size_t len)
+  : len_(std::max(len, std::size_t(1)))
+  {
+    addr_ = ::mmap(nullptr, len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr_ == MAP_FAILED) throw std::system_error(errno, std::system_category(), "mmap");
+  }
+
+  shared_mapping(const shared_mapping&) = delete;
+  shared_mapping& operator=(const shared_mapping&) = delete;
+
+  ~shared_mapping() {
+    ::munmap(addr_, len_);
+  }
+
+  void make_read_only() {
+    if (::mprotect(addr_, len_, PROT_READ) != 0)
+      throw std::system_error(errno, std::system_category(), "mprotect");
+  }
+
+  auto data() const noexcept -> void* { return addr_; }
+
+  private:
+  void* addr_;
+  std::size_t len_;
+};
+
+enum class range_state : std::uint32_t {
+  pending,
+  done
+};
+
+///\brief Outcome of a range, written by the worker that completed it.
+struct range_slot {
+  std::atomic<range_state> state{ range_state::pending };
+  bool has_best = false;
+  value_type best = 0;
+  std::uint64_t candidate = 0;
+  std::uint64_t evaluated = 0;
+};
+
+///\brief Work queue: workers claim entries of the pending list by incrementing next.
+struct queue_header {
+  std::atomic<std::uint64_t> next{ 0 };
+  std::uint64_t pending_count = 0;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+    "shared memory queue requires lock free atomics");
+static_assert(std::atomic<range_state>::is_always_lock_free,
+    "shared memory queue requires lock free atomics");
+
+struct shared_queue {
+  queue_header* header;
+  std::uint64_t* pending;
+  range_slot* slots;
+};
+
+///\brief Worker process body: claim and evaluate ranges until the queue is empty.
+[[noreturn]]
+void worker_main(const value_type* image, std::size_t image_size,
+    const shared_queue& q, std::uint64_t count, std::uint64_t range_size,
+    const process_search::evaluate_fn& fn) noexcept {
+  try {
+    const int_computer_state program(image, image + image_size);
+
+    for (;;) {
+      const std::uint64_t i = q.header->next.fetch_add(1u, std::memory_order_relaxed);
+      if (i >= q.header->pending_count) break;
+
+      const std::uint64_t r = q.pending[i];
+      const std::uint64_t begin = r * range_size;
+      const std::uint64_t end = std::min(begin + range_size, count);
+
+      std::optional<value_type> best;
+      std::uint64_t best_candidate = 0;
+      for (std::uint64_t c = begin; c < end; ++c) {
+        const auto score = fn(program, c);
+        if (score.has_value() && (!best.has_value() || *score > *best)) {
+          best = score;
+          best_candidate = c;
+        }
+      }
+
+      range_slot& slot = q.slots[r];
+      slot.has_best = best.has_value();
+      slot.best = best.value_or(0);
+      slot.candidate = best_candidate;
+      slot.evaluated = end - begin;
+      slot.state.store(range_state::done, std::memory_order_release);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "worker " << ::getpid() << ": " << e.what() << std::endl;
+    ::_exit(2);
+  } catch (...) {
+    ::_exit(2);
+  }
+
+  // Skip destructors and atexit handlers, which belong to the parent.
+  ::_exit(0);
+}
+
+} /* namespace <unnamed> */
+
+
+process_search::process_search(unsigned int workers, std::uint64_t range_size, unsigned int max_retries)
+: workers_(workers),
+  range_size_(range_size),
+  max_retries_(max_retries)
+{
+  if (workers_ == 0u) throw std::invalid_argument("process_search requires at least one worker");
+  if (range_size_ == 0u) throw std::invalid_argument("process_search range size must be positive");
+}
+
+auto process_search::run(const int_computer_state& program, std::uint64_t count, const evaluate_fn& fn) const -> result {
+  result r;
+  const std::uint64_t ranges = count / range_size_ + (count % range_size_ != 0u ? 1u : 0u);
+  if (ranges == 0u) return r;
+
+  shared_mapping image_map(program.size() * sizeof(value_type));
+  auto*const image = static_cast<value_type*>(image_map.data());
+  std::copy(program.begin(), program.end(), image);
+  image_map.make_read_only();
+
+  shared_mapping queue_map(sizeof(queue_header) + ranges * (sizeof(std::uint64_t) + sizeof(range_slot)));
+  auto*const base = static_cast<char*>(queue_map.data());
+  const shared_queue q{
+    new (base) queue_header(),
+    reinterpret_cast<std::uint64_t*>(base + sizeof(queue_header)),
+    reinterpret_cast<range_slot*>(base + sizeof(queue_header) + ranges * sizeof(std::uint64_t))
+  };
+  for (std::uint64_t i = 0; i < ranges; ++i) {
+    new (&q.slots[i]) range_slot();
+    q.pending[i] = i;
+  }
+  q.header->pending_count = ranges;
+
+  std::vector<unsigned int> attempts(ranges, 0u);
+  std::vector<pid_t> pids;
+  for (;;) {
+    // Only the forking thread exists in a worker: make sure buffered output
+    // isn't duplicated, and that the parent's locks aren't held.
+    std::cout.flush();
+    std::cerr.flush();
+
+    pids.clear();
+    const auto n = std::min<std::uint64_t>(workers_, q.header->pending_count);
+    int fork_errno = 0;
+    for (std::uint64_t i = 0; i < n; ++i) {
+      const pid_t pid = ::fork();
+      if (pid == 0) worker_main(image, program.size(), q, count, range_size_, fn);
+      if (pid == -1) {
+        fork_errno = errno;
+        break;
+      }
+      pids.push_back(pid);
+    }
+    // The forked workers drain the queue, even if not all could be forked.
+    if (pids.empty()) throw std::system_error(fork_errno, std::system_category(), "fork");
+
+    for (const pid_t pid : pids) {
+      int status;
+      while (::waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) throw std::system_error(errno, std::system_category(), "waitpid");
+      }
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++r.crashes;
+    }
+
+    // Requeue ranges claimed by crashed workers, and ranges left over
+    // because all workers crashed. Only claimed ranges use up an attempt.
+    const std::uint64_t claimed = std::min(q.header->next.load(std::memory_order_relaxed), q.header->pending_count);
+    std::uint64_t requeued = 0;
+    for (std::uint64_t i = 0; i < q.header->pending_count; ++i) {
+      const std::uint64_t range = q.pending[i];
+      if (q.slots[range].state.load(std::memory_order_acquire) == range_state::done) continue;
+      if (i >= claimed) {
+        q.pending[requeued++] = range;
+      } else if (attempts[range]++ == max_retries_) {
+        ++r.failed_ranges;
+      } else {
+        q.pending[requeued++] = range;
+        ++r.retried_ranges;
+      }
+    }
+    if (requeued == 0u) break;
+    q.header->pending_count = requeued;
+    q.header->next.store(0, std::memory_order_relaxed);
+  }
+
+  for (std::uint64_t i = 0; i < ranges; ++i) {
+    const range_slot& slot = q.slots[i];
+    if (slot.state.load(std::memory_order_acquire) != range_state::done) continue;
+
+    r.evaluated += slot.evaluated;
+    // Ranges are visited in order, so ties keep the lowest candidate.
+    if (slot.has_best && (!r.best.has_value() || slot.best > *r.best)) {
+      r.best = slot.best;
+      r.candidate = slot.candidate;
+    }
+  }
+  // Counters of the workers disappear with their process.
+  telemetry::add(telemetry::counter::searches, r.evaluated);
+  return r;
+}
@@ -0,0 +1,356 @@
+#include <program_generator.hh>
+#include <swallow_exceptions.hh>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+
+class program_generator::sink {
+  public:
+  virtual ~sink() = default;
+  virtual void put(value_type v) = 0;
+};
+
+///\brief Formats values into a buffer, which is written to a stream in large blocks.
+class program_generator::text_sink
+: public program_generator::sink
+{
+  public:
+  text_sink(std::ostream& out, char separator)
+  : out_(out),
+    separator_(separator)
+  {}
+
+  ~text_sink() override {
+    swallow_exceptions([this]() { finish(); });
+  }
+
+  void put(value_type v) override {
+    if (buf_.size() >= flush_size) flush_();
+    if (separator_ == ',' && !std::exchange(first_, false)) buf_ += ',';
+
+    char tmp[16];
+    const auto [ptr, ec] = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    buf_.append(tmp, ptr);
+    if (separator_ != ',') buf_ += separator_;
+  }
+
+  void finish() {
+    if (separator_ == ',' && !first_) buf_ += '\n';
+    first_ = true;
+    flush_();
+    out_.flush();
+  }
+
+  private:
+  static constexpr std::size_t flush_size = 64 * 1024;
+
+  void flush_() {
+    out_.write(buf_.data(), buf_.size());
+    if (!out_) throw std::runtime_error("error writing generated program");
+    buf_.clear();
+  }
+
+  std::ostream& out_;
+  char separator_;
+  bool first_ = true;
+  std::string buf_;
+};
+
+class program_generator::vector_sink
+: public program_generator::sink
+{
+  public:
+  explicit vector_sink(std::vector<value_type>& out)
+  : out_(out)
+  {}
+
+  void put(value_type v) override { out_.push_back(v); }
+
+  private:
+  std::vector<value_type>& out_;
+};
+
+
+namespace {
+
+using value_type = program_generator::value_type;
+
+struct operand {
+  bool immediate;
+  value_type value; ///< Immediate value, or address.
+};
+
+///\brief Abstract body instruction, which is both emitted and modelled.
+struct body_instr {
+  enum class kind {
+    arith,
+    read,
+    write,
+    patch ///< Stores value into the first operand of instruction target.
+  };
+
+  kind k;
+  opcode op = opcode::add;
+  operand a{}, b{};
+  value_type dst = 0;
+  std::size_t target = 0;
+  value_type value = 0;
+};
+
+auto encode(opcode op, bool a_imm, bool b_imm) -> value_type {
+  return value_type(op) + (a_imm ? 100 : 0) + (b_imm ? 1000 : 0);
+}
+
+} /* namespace <unnamed> */
+
+
+program_generator::program_generator(const generator_config& cfg)
+: cfg_(cfg)
+{
+  if (cfg_.footprint < cfg_.loop_depth + 3u)
+    throw std::invalid_argument("footprint must hold the loop counters, accumulator, an input and a scratch cell");
+  if (cfg_.words > std::uint64_t(std::numeric_limits<value_type>::max()) / 2u)
+    throw std::invalid_argument("program too large to address");
+  if (cfg_.body_size == 0u) throw std::invalid_argument("body size must be positive");
+  if (cfg_.mix.add + cfg_.mix.mul + cfg_.mix.less_than + cfg_.mix.equals == 0u)
+    throw std::invalid_argument("opcode mix is empty");
+  if (cfg_.io_rate < 0.0 || cfg_.self_modify_rate < 0.0 || cfg_.io_rate + cfg_.self_modify_rate > 1.0)
+    throw std::invalid_argument("bad I/O or self modification rate");
+}
+
+auto program_generator::generate(std::ostream& program, std::ostream& input, std::ostream& expected) const -> stats {
+  text_sink p(program, ','), i(input, '\n'), e(expected, '\n');
+  const stats s = generate_(p, i, e);
+  p.finish();
+  i.finish();
+  e.finish();
+  return s;
+}
+
+auto program_generator::generate() const -> program {
+  std::vector<value_type> image;
+  program result;
+  vector_sink p(image), i(result.input), e(result.expected);
+  result.s = generate_(p, i, e);
+  result.image = int_computer_state(image.begin(), image.end());
+  return result;
+}
+
+auto program_generator::generate_(sink& program, sink& input, sink& expected) const -> stats {
+  std::mt19937_64 rng(cfg_.seed);
+  const auto uniform = [&rng](std::uint64_t n) -> std::uint64_t {
+    return std::uniform_int_distribution<std::uint64_t>(0, n - 1u)(rng);
+  };
+
+  // Data layout: loop counters, accumulator, input cells, scratch cells.
+  const value_type data_start = 3;
+  const value_type counters = data_start;
+  const value_type acc = counters + value_type(cfg_.loop_depth);
+  const value_type inputs = acc + 1;
+  const value_type input_count = std::max(value_type(1), value_type((cfg_.footprint - cfg_.loop_depth - 1u) / 2u));
+  const value_type scratch = inputs + input_count;
+  const value_type scratch_count = value_type(data_start + cfg_.footprint) - scratch;
+  const value_type code_start = data_start + value_type(cfg_.footprint);
+
+  // Model of the data cells.
+  std::vector<value_type> data(cfg_.footprint, 0);
+  for (value_type i = 0; i < input_count; ++i) data[inputs - data_start + i] = value_type(uniform(10));
+  const auto cell = [&data, data_start](value_type addr) -> value_type& { return data[addr - data_start]; };
+
+  stats s;
+  const auto emit = [&program, &s](std::initializer_list<value_type> words) {
+    for (const value_type w : words) program.put(w);
+    s.words += words.size();
+  };
+
+  emit({ encode(opcode::jump_if_true, true, true), 1, code_start });
+  for (const value_type v : data) emit({ v });
+  s.instructions = 1;
+
+  const auto small_operand = [&]() -> operand {
+    if (uniform(2) == 0u) return { true, value_type(uniform(10)) };
+    return { false, inputs + value_type(uniform(input_count)) };
+  };
+  const auto any_operand = [&]() -> operand {
+    if (uniform(2) == 0u) return small_operand();
+    return { false, scratch + value_type(uniform(scratch_count)) };
+  };
+  const auto pick_op = [&]() -> opcode {
+    const auto& m = cfg_.mix;
+    auto r = uniform(m.add + m.mul + m.less_than + m.equals);
+    if (r < m.add) return opcode::add;
+    r -= m.add;
+    if (r < m.mul) return opcode::mul;
+    r -= m.mul;
+    return r < m.less_than ? opcode::less_than : opcode::equals;
+  };
+
+  // Scratch values are at most 9 * 9, so the accumulator stays in range if a
+  // segment executes at most this many bodies.
+  const std::uint64_t max_bodies = std::uint64_t(std::numeric_limits<value_type>::max()) / (81u * cfg_.body_size);
+
+  while (s.segments == 0u || s.words < cfg_.words) {
+    ++s.segments;
+
+    std::vector<std::uint64_t> n(cfg_.loop_depth);
+    for (auto& x : n) x = 1u + uniform(std::max(cfg_.loop_iterations, std::uint32_t(1)));
+    auto product = [&n]() {
+      std::uint64_t p = 1;
+      for (const auto x : n) p *= x;
+      return p;
+    };
+    while (product() > max_bodies) {
+      auto& largest = *std::max_element(n.begin(), n.end());
+      largest = std::max(std::uint64_t(1), largest / 2u);
+    }
+
+    // Loop heads: each level initialises its counter, inside the enclosing loop,
+    // and loops back to just after its initialisation.
+    std::vector<value_type> heads;
+    for (unsigned int i = 0; i < cfg_.loop_depth; ++i) {
+      emit({ encode(opcode::add, true, true), value_type(n[i]), 0, counters + value_type(i) });
+      heads.push_back(value_type(s.words));
+    }
+
+    // Body.
+    std::vector<body_instr> body;
+    for (std::uint32_t k = 0; k < cfg_.body_size; ++k) {
+      body_instr x{};
+      const double r = std::uniform_real_distribution<double>()(rng);
+      if (r < cfg_.io_rate) {
+        if (uniform(2) == 0u) {
+          x.k = body_instr::kind::read;
+          x.dst = inputs + value_type(uniform(input_count));
+        } else {
+          x.k = body_instr::kind::write;
+          x.a = any_operand();
+        }
+      } else if (r < cfg_.io_rate + cfg_.self_modify_rate) {
+        x.k = body_instr::kind::patch;
+        x.value = value_type(uniform(10));
+      } else {
+        x.k = body_instr::kind::arith;
+        x.op = pick_op();
+        if (x.op == opcode::add && uniform(4) == 0u) {
+          // Accumulate.
+          x.a = { false, acc };
+          x.b = (uniform(2) == 0u ? operand{ false, scratch + value_type(uniform(scratch_count)) } : small_operand());
+          x.dst = acc;
+        } else {
+          const bool compare = (x.op == opcode::less_than || x.op == opcode::equals);
+          x.a = compare ? any_operand() : small_operand();
+          x.b = compare ? any_operand() : small_operand();
+          x.dst = scratch + value_type(uniform(scratch_count));
+        }
+      }
+      body.push_back(x);
+    }
+
+    // Patches rewrite an immediate first operand; without one, they're plain adds.
+    std::vector<std::size_t> patchable;
+    for (std::size_t j = 0; j < body.size(); ++j)
+      if (body[j].k == body_instr::kind::arith && body[j].a.immediate) patchable.push_back(j);
+    for (auto& x : body) {
+      if (x.k != body_instr::kind::patch) continue;
+      if (patchable.empty()) {
+        x = body_instr{ body_instr::kind::arith, opcode::add, { true, x.value }, { true, 0 }, scratch };
+      } else {
+        x.target = patchable[uniform(patchable.size())];
+      }
+    }
+
+    std::vector<value_type> addr;
+    value_type pc = value_type(s.words);
+    for (const auto& x : body) {
+      addr.push_back(pc);
+      pc += (x.k == body_instr::kind::read || x.k == body_instr::kind::write ? 2 : 4);
+    }
+    for (const auto& x : body) {
+      switch (x.k) {
+        case body_instr::kind::arith:
+          emit({ encode(x.op, x.a.immediate, x.b.immediate), x.a.value, x.b.value, x.dst });
+          break;
+        case body_instr::kind::read:
+          emit({ encode(opcode::read, false, false), x.dst });
+          break;
+        case body_instr::kind::write:
+          emit({ encode(opcode::write, x.a.immediate, false), x.a.value });
+          break;
+        case body_instr::kind::patch:
+          emit({ encode(opcode::add, true, true), x.value, 0, addr[x.target] + 1 });
+          break;
+      }
+    }
+
+    // Loop tails, innermost first.
+    for (unsigned int i = cfg_.loop_depth; i-- > 0; ) {
+      const value_type c = counters + value_type(i);
+      emit({ encode(opcode::add, false, true), c, -1, c });
+      emit({ encode(opcode::jump_if_true, false, true), c, heads[i] });
+    }
+    emit({ encode(opcode::write, false, false), acc });
+    emit({ encode(opcode::add, true, true), 0, 0, acc });
+
+    // Model the segment.
+    std::uint64_t executions = 1;
+    for (unsigned int i = 0; i < cfg_.loop_depth; ++i) {
+      s.instructions += executions; // Counter initialisation.
+      executions *= n[i];
+      s.instructions += 2u * executions; // Decrement and jump.
+    }
+    s.instructions += executions * body.size() + 2u;
+
+    const auto load = [&cell](const operand& o) -> value_type {
+      return o.immediate ? o.value : cell(o.value);
+    };
+    for (std::uint64_t it = 0; it < executions; ++it) {
+      for (const auto& x : body) {
+        switch (x.k) {
+          case body_instr::kind::arith:
+            {
+              const value_type a = load(x.a), b = load(x.b);
+              switch (x.op) {
+                default:
+                  cell(x.dst) = a + b;
+                  break;
+                case opcode::mul:
+                  cell(x.dst) = a * b;
+                  break;
+                case opcode::less_than:
+                  cell(x.dst) = (a < b ? 1 : 0);
+                  break;
+                case opcode::equals:
+                  cell(x.dst) = (a == b ? 1 : 0);
+                  break;
+              }
+            }
+            break;
+          case body_instr::kind::read:
+            cell(x.dst) = value_type(uniform(10));
+            input.put(cell(x.dst));
+            ++s.inputs;
+            break;
+          case body_instr::kind::write:
+            expected.put(load(x.a));
+            ++s.outputs;
+            break;
+          case body_instr::kind::patch:
+            body[x.target].a.value = x.value;
+            break;
+        }
+      }
+    }
+    expected.put(cell(acc));
+    ++s.outputs;
+    cell(acc) = 0;
+  }
+
+  emit({ value_type(opcode::halt) });
+  return s;
+}
@@ -0,0 +1,287 @@
+#include <result_cache.hh>
+#include <atomic_file.hh>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+
+constexpr char magic[8] = { 'I', 'C', 'R', 'C', '0', '0', '0', '2' };
+
+///\brief Temporary files older than this are left over from crashed writers.
+constexpr std::time_t stale_tmp_seconds = 3600;
+
+///\brief SHA-256 of \p bytes (FIPS 180-4).
+auto sha256(const std::string& bytes) -> std::string {
+  static constexpr std::uint32_t k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+  const auto rotr = [](std::uint32_t x, unsigned int n) { return (x >> n) | (x << (32u - n)); };
+
+  std::uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  std::string msg = bytes;
+  msg += '\x80';
+  while (msg.size() % 64u != 56u) msg += '\0';
+  const std::uint64_t bits = std::uint64_t(bytes.size()) * 8u;
+  for (int i = 7; i >= 0; --i) msg += static_cast<char>(bits >> (8 * i));
+
+  for (std::size_t chunk = 0; chunk < msg.size(); chunk += 64u) {
+    std::uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+      const auto* p = reinterpret_cast<const unsigned char*>(msg.data() + chunk + 4 * i);
+      w[i] = std::uint32_t(p[0]) << 24 | std::uint32_t(p[1]) << 16 | std::uint32_t(p[2]) << 8 | p[3];
+    }
+    for (int i = 16; i < 64; ++i) {
+      const std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (int i = 0; i < 64; ++i) {
+      const std::uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+      const std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      hh = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+  }
+
+  std::string digest(32, '\0');
+  for (int i = 0; i < 32; ++i) digest[i] = static_cast<char>(h[i / 4] >> (24 - 8 * (i % 4)));
+  return digest;
+}
+
+void append_u64(std::string& out, std::uint64_t v) {
+  out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+void append_values(std::string& out, const std::vector<result_cache::value_type>& v) {
+  append_u64(out, v.size());
+  for (const auto& x : v) append_u64(out, static_cast<std::uint64_t>(std::int64_t(x)));
+}
+
+auto read_u64(const std::string& in, std::size_t& pos, std::uint64_t& v) noexcept -> bool {
+  if (in.size() - pos < sizeof(v)) return false;
+  std::memcpy(&v, in.data() + pos, sizeof(v));
+  pos += sizeof(v);
+  return true;
+}
+
+void make_directory(const std::string& path) {
+  if (::mkdir(path.c_str(), 0755) == -1 && errno != EEXIST)
+    throw std::system_error(errno, std::system_category(), "mkdir " + path);
+}
+
+void make_directories(const std::string& path) {
+  for (std::size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1u))
+    make_directory(path.substr(0, pos));
+  make_directory(path);
+}
+
+///\brief Read all of \p fd.
+auto read_file(int fd, std::string& out) -> bool {
+  struct ::stat st;
+  if (::fstat(fd, &st) == -1) return false;
+  out.resize(st.st_size);
+
+  std::size_t done = 0;
+  while (done < out.size()) {
+    const ::ssize_t n = ::read(fd, out.data() + done, out.size() - done);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += n;
+  }
+  return true;
+}
+
+struct entry {
+  struct ::timespec mtime;
+  std::uint64_t size;
+  std::string path;
+  bool tmp;
+};
+
+///\brief List all entries and temporary files in the cache.
+auto list_entries(const std::string& directory) -> std::vector<entry> {
+  std::vector<entry> result;
+  const auto list_dir = [](const std::string& dir, auto fn) {
+    ::DIR* d = ::opendir(dir.c_str());
+    if (d == nullptr) return;
+    while (const ::dirent* de = ::readdir(d)) {
+      if (de->d_name[0] == '.' && (de->d_name[1] == '\0' || (de->d_name[1] == '.' && de->d_name[2] == '\0')))
+        continue;
+      fn(dir + "/" + de->d_name, de->d_name);
+    }
+    ::closedir(d);
+  };
+
+  list_dir(directory,
+      [&result, &list_dir](const std::string& sub, const char* name) {
+        if (std::strlen(name) != 2u) return; // Not a fan-out directory.
+        list_dir(sub,
+            [&result](const std::string& path, const char* name) {
+              struct ::stat st;
+              if (::stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) return;
+              result.push_back(entry{ st.st_mtim, std::uint64_t(st.st_size), path, name[0] == '.' });
+            });
+      });
+  return result;
+}
+
+} /* namespace <unnamed> */
+
+
+result_cache::key::key(const std::string& bytes)
+: digest_(sha256(bytes))
+{
+  std::memcpy(&hash_, digest_.data(), sizeof(hash_));
+}
+
+auto result_cache::machine_key(const int_computer_state& program, const std::vector<value_type>& inputs) -> key {
+  std::string bytes = "machine";
+  append_u64(bytes, program.pc());
+  append_values(bytes, std::vector<value_type>(program.begin(), program.end()));
+  append_values(bytes, inputs);
+  return key(bytes);
+}
+
+auto result_cache::chain_key(const int_computer_state& program, const std::vector<value_type>& phases,
+    value_type input, bool feedback) -> key {
+  std::string bytes = (feedback ? "feedback_chain" : "chain");
+  append_u64(bytes, program.pc());
+  append_values(bytes, std::vector<value_type>(program.begin(), program.end()));
+  append_values(bytes, phases);
+  append_u64(bytes, static_cast<std::uint64_t>(std::int64_t(input)));
+  return key(bytes);
+}
+
+result_cache::result_cache(std::string directory, std::uint64_t max_bytes)
+: directory_(std::move(directory)),
+  max_bytes_(max_bytes)
+{
+  while (directory_.size() > 1u && directory_.back() == '/') directory_.pop_back();
+  make_directories(directory_);
+  size_estimate_ = scan_size_();
+}
+
+auto result_cache::lookup(const key& k) -> std::optional<std::vector<value_type>> {
+  const std::string path = path_(k);
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    ++misses_;
+    return {};
+  }
+
+  std::string data;
+  const bool read_ok = read_file(fd, data);
+  if (read_ok) ::futimens(fd, nullptr); // Mark as recently used.
+  ::close(fd);
+
+  // Validate the entry: a mismatched digest is a collision of the file name.
+  std::size_t pos = sizeof(magic) + k.digest_.size();
+  std::uint64_t count = 0;
+  bool valid = read_ok
+      && data.size() >= pos
+      && std::memcmp(data.data(), magic, sizeof(magic)) == 0
+      && data.compare(sizeof(magic), k.digest_.size(), k.digest_) == 0;
+  if (valid) {
+    valid = read_u64(data, pos, count)
+        && data.size() - pos == count * sizeof(std::uint64_t);
+  }
+  if (!valid) {
+    ++misses_;
+    return {};
+  }
+
+  std::vector<value_type> result(count);
+  for (auto& v : result) {
+    std::uint64_t x = 0;
+    read_u64(data, pos, x);
+    v = static_cast<value_type>(static_cast<std::int64_t>(x));
+  }
+  ++hits_;
+  return result;
+}
+
+void result_cache::store(const key& k, const std::vector<value_type>& outputs) {
+  std::string data(magic, sizeof(magic));
+  data += k.digest_;
+  append_values(data, outputs);
+
+  const std::string path = path_(k);
+  make_directory(path.substr(0, path.rfind('/')));
+  atomic_replace_file(path, data);
+
+  if ((size_estimate_ += data.size()) > max_bytes_) evict();
+}
+
+void result_cache::evict() {
+  const std::string lock_path = directory_ + "/lock";
+  const int lock_fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (lock_fd == -1) throw std::system_error(errno, std::system_category(), "open " + lock_path);
+  if (::flock(lock_fd, LOCK_EX | LOCK_NB) == -1) {
+    ::close(lock_fd);
+    return; // Another process is evicting.
+  }
+
+  auto entries = list_entries(directory_);
+  const std::time_t now = std::time(nullptr);
+  std::uint64_t total = 0;
+  for (auto& e : entries) {
+    if (e.tmp) {
+      if (now - e.mtime.tv_sec > stale_tmp_seconds) ::unlink(e.path.c_str());
+      e.size = 0; // In use by a writer, or removed just now.
+    }
+    total += e.size;
+  }
+
+  // Remove the least recently used entries, down to 3/4 of the limit,
+  // so eviction doesn't run on every store.
+  const std::uint64_t target = max_bytes_ - max_bytes_ / 4u;
+  if (total > max_bytes_) {
+    std::sort(entries.begin(), entries.end(),
+        [](const entry& x, const entry& y) {
+          return std::tie(x.mtime.tv_sec, x.mtime.tv_nsec) < std::tie(y.mtime.tv_sec, y.mtime.tv_nsec);
+        });
+    for (const auto& e : entries) {
+      if (total <= target) break;
+      if (e.tmp) continue;
+      if (::unlink(e.path.c_str()) == 0 || errno == ENOENT) total -= e.size;
+    }
+  }
+  size_estimate_ = total;
+
+  ::close(lock_fd); // Releases the lock.
+}
+
+auto result_cache::path_(const key& k) const -> std::string {
+  static constexpr char hex[] = "0123456789abcdef";
+  std::string name(16, '0');
+  for (int i = 0; i < 16; ++i) name[i] = hex[(k.hash_ >> (60 - 4 * i)) & 0xfu];
+  return directory_ + "/" + name.substr(0, 2) + "/" + name;
+}
+
+auto result_cache::scan_size_() const -> std::uint64_t {
+  std::uint64_t total = 0;
+  for (const auto& e : list_entries(directory_))
+    if (!e.tmp) total += e.size;
+  return total;
+}
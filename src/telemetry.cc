@@ -0,0 +1,195 @@
+#include <telemetry.hh>
+#include <atomic_file.hh>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+thread_local telemetry::block* telemetry::local_ = nullptr;
+std::atomic<telemetry::block*> telemetry::head_{ nullptr };
+
+namespace {
+
+///\brief Returns the block of an exiting thread to the free blocks.
+struct block_release {
+  ~block_release() {
+    if (release != nullptr) release->store(false, std::memory_order_release);
+  }
+
+  std::atomic<bool>* release = nullptr;
+};
+
+thread_local block_release local_release;
+
+} /* namespace <unnamed> */
+
+
+auto telemetry::name(counter c) noexcept -> const char* {
+  switch (c) {
+    case counter::instructions:    return "intcode_instructions_total";
+    case counter::reads:           return "intcode_reads_total";
+    case counter::writes:          return "intcode_writes_total";
+    case counter::halts:           return "intcode_halts_total";
+    case counter::feedback_rounds: return "intcode_feedback_rounds_total";
+    case counter::searches:        return "intcode_searches_total";
+  }
+  return "intcode_unknown_total";
+}
+
+auto telemetry::help(counter c) noexcept -> const char* {
+  switch (c) {
+    case counter::instructions:    return "Instructions executed.";
+    case counter::reads:           return "Read instructions executed.";
+    case counter::writes:          return "Write instructions executed.";
+    case counter::halts:           return "Evaluations that ended at a halt instruction.";
+    case counter::feedback_rounds: return "Rounds through an amplifier feedback loop.";
+    case counter::searches:        return "Candidates completed by search drivers.";
+  }
+  return "";
+}
+
+auto telemetry::read() noexcept -> snapshot {
+  snapshot result{};
+  for (const block* b = head_.load(std::memory_order_acquire); b != nullptr; b = b->next) {
+    for (std::size_t i = 0; i < counter_count; ++i)
+      result[i] += b->values[i].load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void telemetry::write_prometheus(std::ostream& out) {
+  const snapshot s = read();
+
+  std::ostringstream text;
+  for (std::size_t i = 0; i < counter_count; ++i) {
+    const auto c = counter(i);
+    text << "# HELP " << name(c) << " " << help(c) << "\n"
+        << "# TYPE " << name(c) << " counter\n"
+        << name(c) << " " << s[i] << "\n";
+  }
+  out << text.str();
+}
+
+///\brief Assign a block to the calling thread.
+///\details Reuses the block of an exited thread, or adds a new block to the list.
+void telemetry::acquire_() {
+  block* b = head_.load(std::memory_order_acquire);
+  for (; b != nullptr; b = b->next) {
+    bool expected = false;
+    if (!b->in_use.load(std::memory_order_relaxed)
+        && b->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+      break;
+  }
+
+  if (b == nullptr) {
+    b = new block(); // Never freed: readers may be walking the list.
+    b->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  local_release.release = &b->in_use;
+  local_ = b;
+}
+
+
+telemetry_dumper::telemetry_dumper(std::string target, std::chrono::milliseconds interval)
+: target_(std::move(target)),
+  interval_(interval)
+{
+  static const std::string unix_prefix = "unix:";
+  if (target_.compare(0, unix_prefix.size(), unix_prefix) == 0) {
+    socket_path_ = target_.substr(unix_prefix.size());
+    const std::string& path = socket_path_;
+    ::sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+      throw std::invalid_argument("bad unix socket path");
+    std::memcpy(addr.sun_path, path.data(), path.size());
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ == -1) throw std::system_error(errno, std::system_category(), "socket");
+    ::unlink(path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<const ::sockaddr*>(&addr), sizeof(addr)) == -1
+        || ::listen(listen_fd_, 8) == -1) {
+      const int e = errno;
+      ::close(listen_fd_);
+      throw std::system_error(e, std::system_category(), path);
+    }
+    thread_ = std::thread(&telemetry_dumper::run_socket_, this);
+  } else {
+    thread_ = std::thread(&telemetry_dumper::run_file_, this);
+  }
+}
+
+telemetry_dumper::~telemetry_dumper() {
+  {
+    std::lock_guard<std::mutex> lck{ mtx_ };
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+
+  if (listen_fd_ != -1) {
+    ::close(listen_fd_);
+    ::unlink(socket_path_.c_str());
+  }
+}
+
+auto telemetry_dumper::from_env(const char* env) -> std::unique_ptr<telemetry_dumper> {
+  const char* target = std::getenv(env);
+  if (target == nullptr || *target == '\0') return nullptr;
+  return std::make_unique<telemetry_dumper>(target);
+}
+
+void telemetry_dumper::run_file_() {
+  std::unique_lock<std::mutex> lck{ mtx_ };
+  while (!cv_.wait_for(lck, interval_, [this]() { return stop_; }))
+    write_file_();
+  write_file_();
+}
+
+void telemetry_dumper::run_socket_() {
+  constexpr int poll_ms = 100; // How quickly the destructor is noticed.
+
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lck{ mtx_ };
+      if (stop_) break;
+    }
+
+    ::pollfd pfd{ listen_fd_, POLLIN, 0 };
+    if (::poll(&pfd, 1, poll_ms) <= 0) continue;
+    const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd == -1) continue;
+
+    std::ostringstream text;
+    telemetry::write_prometheus(text);
+    const std::string s = text.str();
+    for (std::size_t off = 0; off < s.size(); ) {
+      const auto n = ::send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      off += n;
+    }
+    ::close(fd);
+  }
+}
+
+///\brief Replace the target file with a fresh dump.
+void telemetry_dumper::write_file_() const {
+  std::ostringstream out;
+  telemetry::write_prometheus(out);
+  try {
+    atomic_replace_file(target_, out.str());
+  } catch (const std::system_error&) {
+    // Best effort: the next dump tries again.
+  }
+}
@@ -0,0 +1,67 @@
+#include <thread_pool.hh>
+#include <algorithm>
+#include <utility>
+
+
+thread_pool::thread_pool(unsigned int threads) {
+  threads = std::max(threads, 1u);
+  workers_.reserve(threads);
+  try {
+    while (threads-- > 0u) workers_.emplace_back(&thread_pool::worker_, this);
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lck{ mtx_ };
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& w : workers_) w.join();
+    throw;
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lck{ mtx_ };
+    stop_ = true;
+  }
+  task_cv_.notify_all();
+  for (auto& w : workers_) w.join();
+}
+
+void thread_pool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lck{ mtx_ };
+    tasks_.push_back(std::move(task));
+  }
+  task_cv_.notify_one();
+}
+
+void thread_pool::wait() {
+  std::unique_lock<std::mutex> lck{ mtx_ };
+  idle_cv_.wait(lck, [this]() { return tasks_.empty() && running_ == 0u; });
+  if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+void thread_pool::worker_() {
+  std::unique_lock<std::mutex> lck{ mtx_ };
+  for (;;) {
+    task_cv_.wait(lck, [this]() { return stop_ || !tasks_.empty(); });
+    if (tasks_.empty()) return; // Stopped, and nothing left to do.
+
+    std::function<void()> task = std::move(tasks_.front());
+    tasks_.pop_front();
+    ++running_;
+    lck.unlock();
+
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lck.lock();
+    if (error && !error_) error_ = std::move(error);
+    if (--running_ == 0u && tasks_.empty()) idle_cv_.notify_all();
+  }
+}
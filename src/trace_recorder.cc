@@ -0,0 +1,101 @@
+#include <trace_recorder.hh>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr char trace_magic[8] = { 'I', 'C', 'T', 'R', 'A', 'C', 'E', '1' };
+
+auto round_up_pow2(std::size_t n) -> std::size_t {
+  std::size_t result = 1;
+  while (result < n) result <<= 1;
+  return result;
+}
+
+} /* namespace <unnamed> */
+
+
+trace_recorder::trace_recorder(const std::string& filename, std::size_t capacity)
+: out_(filename, std::ios::binary | std::ios::trunc),
+  buf_(round_up_pow2(capacity)),
+  mask_(buf_.size() - 1u)
+{
+  if (!out_) throw std::runtime_error("unable to open trace file " + filename);
+
+  const std::uint32_t record_size = sizeof(trace_record);
+  out_.write(trace_magic, sizeof(trace_magic));
+  out_.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+
+  writer_ = std::thread(&trace_recorder::run_, this);
+}
+
+trace_recorder::~trace_recorder() {
+  stop_.store(true, std::memory_order_release);
+  writer_.join();
+
+  if (dropped() != 0u) {
+    trace_record marker{};
+    marker.pc = trace_record::dropped_marker;
+    marker.result = static_cast<trace_record::value_type>(dropped());
+    out_.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+  }
+}
+
+auto trace_recorder::from_env(const char* env) -> std::unique_ptr<trace_recorder> {
+  const char* filename = std::getenv(env);
+  if (filename == nullptr || *filename == '\0') return nullptr;
+  return std::make_unique<trace_recorder>(filename);
+}
+
+void trace_recorder::run_() {
+  for (;;) {
+    const bool stopping = stop_.load(std::memory_order_acquire);
+    if (!drain_()) {
+      if (stopping) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  out_.flush();
+}
+
+///\brief Write all records currently in the buffer.
+///\return False if the buffer was empty.
+auto trace_recorder::drain_() -> bool {
+  const auto tail = tail_.load(std::memory_order_relaxed);
+  const auto head = head_.load(std::memory_order_acquire);
+  if (head == tail) return false;
+
+  // Write the (up to two) contiguous segments.
+  const std::size_t begin = tail & mask_;
+  const std::size_t count = head - tail;
+  const std::size_t first = std::min(count, buf_.size() - begin);
+  out_.write(reinterpret_cast<const char*>(&buf_[begin]), first * sizeof(trace_record));
+  out_.write(reinterpret_cast<const char*>(&buf_[0]), (count - first) * sizeof(trace_record));
+
+  tail_.store(head, std::memory_order_release);
+  return true;
+}
+
+
+trace_reader::trace_reader(std::istream& in)
+: in_(in)
+{
+  char magic[sizeof(trace_magic)];
+  std::uint32_t record_size;
+
+  in_.read(magic, sizeof(magic));
+  in_.read(reinterpret_cast<char*>(&record_size), sizeof(record_size));
+  if (!in_ || std::memcmp(magic, trace_magic, sizeof(magic)) != 0)
+    throw std::runtime_error("not a trace file");
+  if (record_size != sizeof(trace_record))
+    throw std::runtime_error("trace record size mismatch");
+}
+
+auto trace_reader::next(trace_record& r) -> bool {
+  return bool(in_.read(reinterpret_cast<char*>(&r), sizeof(r)));
+}
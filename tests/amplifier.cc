@@ -1,5 +1,7 @@
 #include <amplifier.hh>
 #include <UnitTest++/UnitTest++.h>
+#include <array>
+#include <stdexcept>
 
 
 TEST(day7_part1_example1) {
@@ -40,6 +42,41 @@ TEST(day7_part2_example2) {
       amp.feedback_eval(0));
 }
 
+TEST(feedback_eval_detects_loop) {
+  // Each amplifier echoes its input forever.
+  auto amp = amplifier_chain({0,0,0}, {3,9,3,10,4,10,1105,1,2,0,0});
+  try {
+    amp.feedback_eval(7);
+    CHECK(false);
+  } catch (const feedback_loop_error& e) {
+    CHECK_EQUAL(1u, e.period());
+  }
+}
+
+TEST(fixed_chain_day7_part1_example) {
+  const std::array<int, 5> phases{ 4,3,2,1,0 };
+  auto amp = fixed_amplifier_chain<5>(phases.begin(), phases.end(), {3,15,3,16,1002,16,10,16,1,16,15,15,4,15,99,0,0});
+  CHECK_EQUAL(43210, amp(0));
+  CHECK(amp.is_halt());
+}
+
+TEST(fixed_chain_from_amplifier_chain) {
+  const auto chain = amplifier_chain({9,7,8,5,6}, {3,52,1001,52,-5,52,3,53,1,52,56,54,1007,54,5,55,1005,55,26,1001,54,-5,54,1105,1,12,1,53,54,53,1008,54,0,55,1001,55,1,55,2,53,55,53,4,53,1001,56,-1,56,1005,56,6,99,0,0,0,0,10});
+  auto amp = fixed_amplifier_chain<5>(chain);
+  CHECK_EQUAL(chain.fingerprint(), amp.fingerprint());
+  CHECK_EQUAL(18216, amp.feedback_eval(0));
+
+  CHECK_THROW(fixed_amplifier_chain<4>{ chain }, std::invalid_argument);
+  const std::array<int, 2> phases{ 0,1 };
+  CHECK_THROW((fixed_amplifier_chain<3>(phases.begin(), phases.end(), {3,9,3,10,4,10,1105,1,2,0,0})), std::invalid_argument);
+}
+
+TEST(fixed_chain_detects_loop) {
+  const std::array<int, 3> phases{ 0,0,0 };
+  auto amp = fixed_amplifier_chain<3>(phases.begin(), phases.end(), {3,9,3,10,4,10,1105,1,2,0,0});
+  CHECK_THROW(amp.feedback_eval(7), feedback_loop_error);
+}
+
 int main() {
   return UnitTest::RunAllTests();
 }
@@ -0,0 +1,44 @@
+#include <atomic_file.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+
+auto read_file(const std::string& path) -> std::string {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+
+TEST(replace) {
+  const std::string filename = "atomic_file_test.bin";
+  atomic_replace_file(filename, "first");
+  CHECK_EQUAL("first", read_file(filename));
+  atomic_replace_file(filename, std::string("se\0cond", 7));
+  CHECK_EQUAL(std::string("se\0cond", 7), read_file(filename));
+  std::remove(filename.c_str());
+
+  // No temporaries are left behind.
+  CHECK_EQUAL(0, std::system("test -z \"$(ls -A | grep 'atomic_file_test')\""));
+}
+
+TEST(missing_directory) {
+  CHECK_THROW(atomic_replace_file("atomic_file_test.dir/file", "x"), std::system_error);
+}
+
+TEST(replace_directory_fails) {
+  const std::string dirname = "atomic_file_test.dir";
+  CHECK_EQUAL(0, std::system(("mkdir -p " + dirname + "/target/sub").c_str()));
+  CHECK_THROW(atomic_replace_file(dirname + "/target", "x"), std::system_error);
+  // The temporary is removed when the rename fails.
+  CHECK_EQUAL(0, std::system(("test -z \"$(ls -A " + dirname + " | grep tmp)\"").c_str()));
+  std::system(("rm -rf " + dirname).c_str());
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
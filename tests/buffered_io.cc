@@ -0,0 +1,99 @@
+#include <buffered_io.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+
+///\brief Pipe with \p text written to it, and the write end closed.
+auto input_fd(const std::string& text) -> int {
+  int fds[2];
+  if (::pipe(fds) != 0) throw std::runtime_error("pipe");
+  ::write(fds[1], text.data(), text.size());
+  ::close(fds[1]);
+  return fds[0];
+}
+
+auto read_all(std::FILE* f) -> std::string {
+  std::string result;
+  std::rewind(f);
+  for (int c; (c = std::fgetc(f)) != EOF; ) result += char(c);
+  return result;
+}
+
+
+TEST(read_separators) {
+  const int fd = input_fd("1,2\n  -3\t4,\n");
+  buffered_io io(fd, -1);
+  CHECK_EQUAL(1, io.read());
+  CHECK_EQUAL(2, io.read());
+  CHECK_EQUAL(-3, io.read());
+  CHECK_EQUAL(4, io.read());
+  CHECK_THROW(io.read(), io_error);
+  ::close(fd);
+}
+
+TEST(read_invalid) {
+  const int fd = input_fd("12x 3");
+  buffered_io io(fd, -1);
+  CHECK_THROW(io.read(), io_error);
+  ::close(fd);
+}
+
+TEST(read_across_buffer_boundary) {
+  std::string text;
+  for (int i = 0; i < 1000; ++i) text += std::to_string(i * 7919) + " ";
+  const int fd = input_fd(text);
+  buffered_io io(fd, -1, 50);
+  for (int i = 0; i < 1000; ++i) CHECK_EQUAL(i * 7919, io.read());
+  CHECK_THROW(io.read(), io_error);
+  ::close(fd);
+}
+
+TEST(write) {
+  std::FILE* const out = std::tmpfile();
+  {
+    buffered_io io(-1, ::fileno(out), 64);
+    std::string expected;
+    for (int i = -500; i < 500; ++i) {
+      io.write(i * 31);
+      expected += std::to_string(i * 31) + "\n";
+    }
+    io.flush();
+    CHECK_EQUAL(expected, read_all(out));
+  }
+  std::fclose(out);
+}
+
+TEST(flush_before_blocking_read) {
+  std::FILE* const out = std::tmpfile();
+  const int fd = input_fd("5\n");
+  {
+    buffered_io io(fd, ::fileno(out));
+    io.write(1);
+    CHECK_EQUAL(std::string(), read_all(out));
+    CHECK_EQUAL(5, io.read());
+    CHECK_EQUAL(std::string("1\n"), read_all(out));
+  }
+  ::close(fd);
+  std::fclose(out);
+}
+
+TEST(attach) {
+  std::FILE* const out = std::tmpfile();
+  const int fd = input_fd("8");
+  {
+    buffered_io io(fd, ::fileno(out));
+    int_computer_state ic({ 3, 9, 8, 9, 10, 9, 4, 9, 99, -1, 8 });
+    io.attach(ic);
+    ic.eval();
+    io.flush();
+  }
+  CHECK_EQUAL(std::string("1\n"), read_all(out));
+  ::close(fd);
+  std::fclose(out);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
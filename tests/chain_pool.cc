@@ -0,0 +1,96 @@
+#include <chain_pool.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+
+namespace {
+
+std::atomic<std::size_t> allocations{ 0 };
+
+const int_computer_state day7_example = {3,52,1001,52,-5,52,3,53,1,52,56,54,1007,54,5,55,1005,55,26,1001,54,-5,54,1105,1,12,1,53,54,53,1008,54,0,55,1001,55,1,55,2,53,55,53,4,53,1001,56,-1,56,1005,56,6,99,0,0,0,0,10};
+
+///\brief Best feedback output over all permutations of 5..9, using chains from \p pool.
+template<typename Chain>
+auto search(chain_pool<Chain>& pool) -> amplifier_chain::value_type {
+  std::array<int, 5> phases{ 5,6,7,8,9 };
+  amplifier_chain::value_type best = 0;
+  do {
+    const auto chain = pool.acquire(phases.begin(), phases.end());
+    best = std::max(best, chain->feedback_eval(0));
+  } while (std::next_permutation(phases.begin(), phases.end()));
+  return best;
+}
+
+} /* namespace <unnamed> */
+
+void* operator new(std::size_t n) {
+  ++allocations;
+  if (void* p = std::malloc(n == 0u ? 1u : n)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+
+TEST(reset_matches_fresh_chain) {
+  phase_cache cache(day7_example);
+  amplifier_chain chain;
+  for (const auto& phases : { std::array<int, 5>{ 9,7,8,5,6 }, std::array<int, 5>{ 5,6,7,8,9 }, std::array<int, 5>{ 9,7,8,5,6 } }) {
+    chain.reset(phases.begin(), phases.end(), cache);
+    auto fresh = amplifier_chain(phases.begin(), phases.end(), day7_example);
+    CHECK(fresh == chain);
+    CHECK_EQUAL(fresh.feedback_eval(0), chain.feedback_eval(0));
+  }
+
+  const std::array<int, 3> short_phases{ 9,7,8 };
+  chain.reset(short_phases.begin(), short_phases.end(), cache);
+  CHECK_EQUAL(3u, chain.size());
+}
+
+TEST(fixed_chain_reset) {
+  phase_cache cache(day7_example);
+  fixed_amplifier_chain<5> chain;
+  const std::array<int, 5> phases{ 9,7,8,5,6 };
+  chain.reset(phases.begin(), phases.end(), cache);
+  CHECK_EQUAL(18216, chain.feedback_eval(0));
+  CHECK_THROW(chain.reset(phases.begin(), phases.begin() + 4, cache), std::invalid_argument);
+}
+
+TEST(pool_reuses_chains) {
+  chain_pool<> pool(day7_example);
+  CHECK_EQUAL(18216, search(pool));
+  CHECK_EQUAL(1u, pool.idle());
+
+  {
+    const std::array<int, 5> phases{ 9,7,8,5,6 };
+    const auto a = pool.acquire(phases.begin(), phases.end());
+    const auto b = pool.acquire(phases.begin(), phases.end());
+    CHECK(a.get() != b.get());
+    CHECK_EQUAL(0u, pool.idle());
+  }
+  CHECK_EQUAL(2u, pool.idle());
+}
+
+TEST(search_does_not_allocate_after_warm_up) {
+  chain_pool<fixed_amplifier_chain<5>> pool(day7_example);
+  CHECK_EQUAL(18216, search(pool)); // Warm up.
+
+  const std::size_t before = allocations.load();
+  CHECK_EQUAL(18216, search(pool));
+  CHECK_EQUAL(0u, allocations.load() - before);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
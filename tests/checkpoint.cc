@@ -0,0 +1,166 @@
+#include <checkpoint.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const int_computer_state day7_example = {3,26,1001,26,-4,26,3,27,1002,27,2,27,1,27,26,27,4,27,1001,28,-1,28,1005,28,6,99,0,0,5};
+
+} /* namespace <unnamed> */
+
+
+TEST(round_trip) {
+  int_computer_state s = {3,9,8,9,10,9,4,9,99,-1,8};
+  s.jump(4);
+  const std::vector<int_computer_state::value_type> values{ 0, -1, 1 << 30, -(1 << 30), 19690720 };
+
+  checkpoint_writer w;
+  w.write(std::uint64_t(123456789012345ull));
+  w.write_value(-42);
+  w.write(values);
+  w.write(s);
+  w.commit("checkpoint_test.ckpt");
+
+  checkpoint_reader r("checkpoint_test.ckpt");
+  CHECK_EQUAL(123456789012345ull, r.read_u64());
+  CHECK_EQUAL(-42, r.read_value());
+  CHECK(values == r.read_values());
+  const auto restored = r.read_state();
+  CHECK(s == restored);
+  CHECK_EQUAL(4u, restored.pc());
+  CHECK(r.at_end());
+  std::remove("checkpoint_test.ckpt");
+}
+
+TEST(resume_feedback_loop) {
+  auto chain = amplifier_chain({9,8,7,6,5}, day7_example);
+  amplifier_chain::value_type v = 0;
+  for (int i = 0; i < 2; ++i) v = chain(v);
+
+  checkpoint_writer w;
+  w.write(chain);
+  w.write_value(v);
+  w.commit("checkpoint_test.ckpt");
+
+  checkpoint_reader r("checkpoint_test.ckpt");
+  auto restored = r.read_chain(day7_example);
+  CHECK(chain == restored);
+  CHECK_EQUAL(139629729, restored.feedback_eval(r.read_value()));
+  std::remove("checkpoint_test.ckpt");
+}
+
+TEST(resume_interrupted_feedback_eval) {
+  auto chain = amplifier_chain({9,8,7,6,5}, day7_example);
+  amplifier_chain::value_type v = 0;
+  unsigned int checkpoints = 0;
+  while (!chain.feedback_rounds(v, 1)) {
+    checkpoint_writer w;
+    w.write(chain);
+    w.write_value(v);
+    w.commit("checkpoint_test.ckpt");
+
+    checkpoint_reader r("checkpoint_test.ckpt");
+    chain = r.read_chain(day7_example);
+    v = r.read_value();
+    ++checkpoints;
+  }
+  CHECK_EQUAL(139629729, v);
+  CHECK_EQUAL(4u, checkpoints);
+  std::remove("checkpoint_test.ckpt");
+}
+
+TEST(resume_self_modifying_chain) {
+  // 0: read phase [100]; 2: read [6]; 4: add 0 <input> [101]; 8: write [101]; 10: jump 2
+  std::vector<int_computer_state::value_type> image = { 3,100, 3,6, 1101,0,0,101, 4,101, 1105,1,2, 99 };
+  image.resize(102);
+  const int_computer_state program(image.begin(), image.end());
+  auto chain = amplifier_chain({ 0 }, program);
+  CHECK_EQUAL(5, chain(5));
+
+  checkpoint_writer w;
+  w.write(chain);
+  w.commit("checkpoint_test.ckpt");
+  checkpoint_reader r("checkpoint_test.ckpt");
+  auto restored = r.read_chain(program);
+
+  for (const int v : { 9, 3, 0, 7 }) {
+    CHECK_EQUAL(v, chain(v));
+    CHECK_EQUAL(v, restored(v));
+  }
+  CHECK(chain == restored);
+  std::remove("checkpoint_test.ckpt");
+}
+
+TEST(fixed_chain) {
+  const std::array<int, 5> phases{ 9,8,7,6,5 };
+  auto chain = fixed_amplifier_chain<5>(phases.begin(), phases.end(), day7_example);
+  const auto v = chain(0);
+
+  checkpoint_writer w;
+  w.write(chain);
+  w.commit("checkpoint_test.ckpt");
+
+  checkpoint_reader r("checkpoint_test.ckpt");
+  auto restored = fixed_amplifier_chain<5>(r.read_chain(day7_example));
+  CHECK(chain == restored);
+  CHECK_EQUAL(139629729, restored.feedback_eval(v));
+  std::remove("checkpoint_test.ckpt");
+}
+
+TEST(detects_damage) {
+  checkpoint_writer w;
+  w.write(day7_example);
+  w.commit("checkpoint_test.ckpt");
+
+  {
+    std::fstream f("checkpoint_test.ckpt", std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(12);
+    f.put('\x7f');
+  }
+  CHECK_THROW(checkpoint_reader("checkpoint_test.ckpt"), checkpoint_error);
+  std::remove("checkpoint_test.ckpt");
+  CHECK_THROW(checkpoint_reader("checkpoint_test.ckpt"), checkpoint_error);
+}
+
+TEST(detects_type_mismatch) {
+  checkpoint_writer w;
+  w.write(std::uint64_t(7));
+  w.commit("checkpoint_test.ckpt");
+
+  checkpoint_reader r("checkpoint_test.ckpt");
+  CHECK_THROW(r.read_state(), checkpoint_error);
+  CHECK_EQUAL(7u, r.read_u64());
+  CHECK_THROW(r.read_u64(), checkpoint_error);
+  std::remove("checkpoint_test.ckpt");
+}
+
+TEST(trigger) {
+  checkpoint_trigger trigger(std::chrono::hours(1));
+  CHECK(!trigger.due());
+  CHECK_THROW(checkpoint_trigger(std::chrono::hours(1)), std::logic_error);
+
+  std::raise(SIGUSR1);
+  CHECK(trigger.due());
+  CHECK(!trigger.due());
+  CHECK(!trigger.stop_requested());
+
+  std::raise(SIGTERM);
+  CHECK(trigger.due());
+  CHECK(trigger.stop_requested());
+}
+
+TEST(trigger_interval) {
+  checkpoint_trigger trigger(std::chrono::milliseconds(0));
+  CHECK(trigger.due());
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,129 @@
+#include <compact_machine.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <deque>
+#include <vector>
+
+
+namespace {
+
+const int_computer_state day5_example = {3,21,1008,21,8,20,1005,20,22,107,8,21,20,1006,20,31,1106,0,36,98,0,0,1002,21,125,20,4,20,1105,1,46,104,999,1105,1,46,1101,1000,1,20,4,20,1105,1,46,98,99};
+
+auto run(compact_machine m, compact_machine::value_type in) -> std::vector<compact_machine::value_type> {
+  std::deque<compact_machine::value_type> input{ in };
+  std::vector<compact_machine::value_type> output;
+  CHECK(m.run(input, output) == compact_machine::io_pending::halt);
+  return output;
+}
+
+} /* namespace <unnamed> */
+
+
+TEST(matches_int_computer_state) {
+  const compact_machine m(day5_example);
+  for (int x = 0; x < 16; ++x) {
+    const std::vector<compact_machine::value_type> expect{
+      int_computer_state::single_input_single_output(day5_example, x)
+    };
+    CHECK(expect == run(m, x));
+  }
+}
+
+TEST(explicit_io) {
+  compact_machine m(int_computer_state{ 3,9,8,9,10,9,4,9,99,-1,8 });
+  CHECK(m.eval_until_io_or_halt() == compact_machine::io_pending::read);
+  CHECK_THROW(m.write(), io_error);
+  m.read(8);
+  CHECK(m.eval_until_io_or_halt() == compact_machine::io_pending::write);
+  CHECK_EQUAL(1, m.write());
+  CHECK(m.eval_until_io_or_halt() == compact_machine::io_pending::halt);
+  CHECK(m.is_halt());
+}
+
+TEST(run_stops_when_input_runs_out) {
+  compact_machine m(int_computer_state{ 3,0,3,0,99 });
+  std::deque<compact_machine::value_type> input{ 1 };
+  std::vector<compact_machine::value_type> output;
+  CHECK(m.run(input, output) == compact_machine::io_pending::read);
+  CHECK_EQUAL(2u, m.pc());
+}
+
+TEST(rejects_excess_modes) {
+  // Modes beyond the arguments of: add, jump_if_true, write, read.
+  for (const int_computer_state& program : {
+          int_computer_state{ 11101,0,0,0,99 },
+          int_computer_state{ 11105,0,0,99 },
+          int_computer_state{ 1104,0,99 },
+          int_computer_state{ 10003,0,99 } }) {
+    CHECK_THROW(int_computer_state::single_output(program, { 1 }), invalid_opcode_error);
+    CHECK_THROW(run(compact_machine(program), 1), invalid_opcode_error);
+  }
+}
+
+TEST(copy_on_write) {
+  const compact_machine original(day5_example);
+  compact_machine copy = original;
+  CHECK(copy == original);
+  CHECK_EQUAL(0u, copy.memory_usage().owned_pages);
+
+  run(copy, 3); // run() works on its own copy
+  CHECK(copy == original);
+
+  copy.store(1, 20);
+  CHECK(copy != original);
+  CHECK_EQUAL(21, original[1]);
+  CHECK_EQUAL(20, copy[1]);
+  CHECK_EQUAL(1u, copy.memory_usage().owned_pages);
+  CHECK_EQUAL(0u, original.memory_usage().owned_pages);
+  CHECK(copy.image() == original.image());
+
+  copy.store(1, 21);
+  CHECK(copy == original);
+}
+
+TEST(to_state) {
+  compact_machine m(day5_example);
+  m.eval_until_io_or_halt();
+  m.read(8);
+  m.eval_until_io_or_halt();
+
+  int_computer_state expect = day5_example;
+  expect.read_cb = []() { return 8; };
+  expect.eval_until_io_or_halt();
+  expect.eval1();
+  expect.eval_until_io_or_halt();
+
+  CHECK(expect == m.to_state());
+  CHECK(compact_machine(m.to_state()) == m);
+}
+
+TEST(memory_usage) {
+  std::vector<int_computer_state::value_type> program(day5_example.begin(), day5_example.end());
+  program.resize(1000, 0);
+  const int_computer_state s(program.begin(), program.end());
+
+  compact_machine m(s);
+  m.eval_until_io_or_halt();
+  m.read(7);
+  m.eval_until_io_or_halt();
+  const auto usage = m.memory_usage();
+
+  CHECK_EQUAL(1u, usage.owned_pages);
+  CHECK_EQUAL(usage.object + usage.page_table + usage.pages, usage.total());
+  CHECK(usage.shared_image >= 1000u * sizeof(int_computer_state::value_type));
+  CHECK(usage.total() * 4u < s.memory_usage());
+}
+
+TEST(budget) {
+  compact_machine m(day5_example);
+  eval_budget budget = eval_budget::steps(0);
+  CHECK(m.eval_until_io_or_halt(budget) == compact_machine::io_pending::read); // read takes no step
+  m.read(9);
+  CHECK(m.eval_until_io_or_halt(budget) == compact_machine::io_pending::budget_exhausted);
+  budget = eval_budget::steps(100);
+  CHECK(m.eval_until_io_or_halt(budget) == compact_machine::io_pending::write);
+  CHECK_EQUAL(1001, m.write());
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
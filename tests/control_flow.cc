@@ -0,0 +1,161 @@
+#include <control_flow.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <stdexcept>
+#include <vector>
+
+
+auto block_eval(int_computer_state s, std::vector<int_computer_state::value_type> in)
+-> std::vector<int_computer_state::value_type> {
+  const control_flow_graph cfg(s);
+  std::vector<int_computer_state::value_type> out;
+  auto in_iter = in.begin();
+
+  for (;;) {
+    switch (s.eval_until_io_or_halt(cfg)) {
+      case int_computer_state::io_pending::halt:
+        return out;
+      case int_computer_state::io_pending::read:
+        s.read_cb = [&in_iter]() { return *in_iter++; };
+        break;
+      case int_computer_state::io_pending::write:
+        s.write_cb = [&out](int_computer_state::value_type v) { out.push_back(v); };
+        break;
+      case int_computer_state::io_pending::budget_exhausted:
+        throw std::logic_error("unexpected budget exhaustion");
+    }
+    s.eval1();
+  }
+}
+
+
+TEST(blocks_end_at_jumps_io_and_halt) {
+  // 0: read [9]; 2: add [9] [9] [9]; 6: write [9]; 8: halt; 9: data
+  const control_flow_graph cfg({ 3,9, 1,9,9,9, 4,9, 99, 0 });
+  const auto& blocks = cfg.blocks();
+
+  CHECK_EQUAL(3u, blocks.size());
+  CHECK(cfg.find(0) && cfg.find(0)->kind == control_flow_graph::terminator::io);
+  CHECK(cfg.find(2) && cfg.find(2)->end == 8u);
+  CHECK(cfg.find(8) && cfg.find(8)->kind == control_flow_graph::terminator::halt);
+  CHECK(cfg.is_code(5));
+  CHECK(!cfg.is_code(9));
+}
+
+TEST(loops) {
+  // Count down from 3, writing each value.
+  // 0: write [11]; 2: add [11] -1 [11]; 6: jump_if_true [11] 0; 9: halt
+  const control_flow_graph cfg({ 4,11, 1001,11,-1,11, 1005,11,0, 99, 0, 3 });
+  const auto loops = cfg.loops();
+
+  CHECK_EQUAL(1u, loops.size());
+  if (loops.size() == 1u) {
+    CHECK_EQUAL(0u, loops[0].header);
+    CHECK_EQUAL(2u, loops[0].blocks.size());
+  }
+  CHECK((block_eval({ 4,11, 1001,11,-1,11, 1005,11,0, 99, 0, 3 }, {})
+      == std::vector<int_computer_state::value_type>{ 3, 2, 1 }));
+}
+
+TEST(block_eval_matches_interpreter) {
+  const int_computer_state program = {3,21,1008,21,8,20,1005,20,22,107,8,21,20,1006,20,31,1106,0,36,98,0,0,1002,21,125,20,4,20,1105,1,46,104,999,1105,1,46,1101,1000,1,20,4,20,1105,1,46,98,99};
+  for (int x = 0; x < 16; ++x) {
+    CHECK_EQUAL(
+        int_computer_state::single_input_single_output(program, x),
+        block_eval(program, { x }).at(0));
+  }
+}
+
+TEST(self_modifying_code) {
+  // The add at 0 patches the opcode at 4 from 1 (add) to 2 (mul).
+  const int_computer_state program = { 1001,4,1,4, 1,9,9,9, 99, 5 };
+  auto interpreted = program;
+  auto blocks = program;
+
+  interpreted.eval();
+  blocks.eval_until_io_or_halt(control_flow_graph(program));
+  CHECK_EQUAL(interpreted, blocks);
+  CHECK_EQUAL(25, blocks[9]);
+}
+
+TEST(self_modifying_code_across_io) {
+  // The read at 0 patches the immediate operand at 4, in a later call.
+  // 0: read [4]; 2: add 0 0 [14]; 6: write [14]; 8: read [4]; 10: jump_if_true [4] 2; 13: halt
+  const int_computer_state program = { 3,4, 1101,0,0,14, 4,14, 3,4, 1005,4,2, 99, 0 };
+  CHECK(std::vector<int_computer_state::value_type>({ 7, 3 }) == block_eval(program, { 7, 3, 0 }));
+}
+
+TEST(jump_into_patched_data) {
+  // 0: add 104 0 [7], patching the data word at 7 into a write; 4: jump 7; 7: data; 9: halt
+  const int_computer_state program = { 1101,104,0,7, 1105,1,7, 0,42, 99 };
+  const control_flow_graph cfg(program);
+  CHECK(cfg.find(7) == nullptr);
+  for (const auto& b : cfg.blocks()) CHECK(!b.instrs.empty());
+
+  std::vector<int_computer_state::value_type> expect;
+  auto interpreted = program;
+  interpreted.write_cb = [&expect](int_computer_state::value_type v) { expect.push_back(v); };
+  interpreted.eval();
+  CHECK(std::vector<int_computer_state::value_type>({ 42 }) == expect);
+  CHECK(expect == block_eval(program, {}));
+}
+
+TEST(block_eval_with_budget) {
+  // Counts [13] up to 100, then writes it.
+  const int_computer_state program({ 1001, 13, 1, 13, 1007, 13, 100, 14, 1005, 14, 0, 4, 13, 0, 0, 99 });
+  const control_flow_graph cfg(program);
+
+  auto s = program;
+  int slices = 0;
+  for (;;) {
+    auto budget = eval_budget::steps(7);
+    const auto io = s.eval_until_io_or_halt(cfg, budget);
+    if (io != int_computer_state::io_pending::budget_exhausted) {
+      CHECK(io == int_computer_state::io_pending::write);
+      break;
+    }
+    ++slices;
+  }
+  // 300 instructions before the write, 7 per slice.
+  CHECK_EQUAL(300 / 7, slices);
+  CHECK_EQUAL(100, s[13]);
+  CHECK_EQUAL(11u, s.pc());
+}
+
+TEST(block_eval_budget_skips_io) {
+  // Writes 1, 2, 3, ...: 0: add [20] 1 [20]; 4: write [20]; 6: jump 0
+  std::vector<int_computer_state::value_type> image = { 1001,20,1,20, 4,20, 1105,1,0 };
+  image.resize(21);
+  const int_computer_state program(image.begin(), image.end());
+  const control_flow_graph cfg(program);
+
+  // The budget covers the add and the jump of each round; the caller performs the write.
+  auto s = program;
+  auto budget = eval_budget::steps(100);
+  int writes = 0;
+  s.write_cb = [&writes](int_computer_state::value_type) { ++writes; };
+  while (s.eval_until_io_or_halt(cfg, budget) == int_computer_state::io_pending::write) s.eval1();
+  CHECK_EQUAL(50, writes);
+  CHECK_EQUAL(50, s[20]);
+}
+
+TEST(block_eval_budget_after_code_store) {
+  // 0: add 5 0 [6], patching the add at 4; 4: add 0 0 [20]; 8: jump 0
+  std::vector<int_computer_state::value_type> image = { 1101,5,0,6, 1101,0,0,20, 1105,1,0 };
+  image.resize(21);
+  const int_computer_state program(image.begin(), image.end());
+  const control_flow_graph cfg(program);
+
+  auto interpreted = program;
+  auto blocks = program;
+  auto interpreted_budget = eval_budget::steps(30);
+  auto blocks_budget = eval_budget::steps(30);
+  CHECK(interpreted.eval(interpreted_budget) == int_computer_state::io_pending::budget_exhausted);
+  const auto before = int_computer_state::interpreted_instructions();
+  CHECK(blocks.eval_until_io_or_halt(cfg, blocks_budget) == int_computer_state::io_pending::budget_exhausted);
+  CHECK_EQUAL(30u, int_computer_state::interpreted_instructions() - before);
+  CHECK_EQUAL(interpreted, blocks);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -1,6 +1,7 @@
 #include <int_computer.hh>
 #include "UnitTest++/UnitTest++.h"
 #include <future>
+#include <unordered_set>
 
 
 TEST(parse) {
@@ -171,6 +172,98 @@ TEST(day5_part2_example_imm_mode_lt_8) {
   }
 }
 
+TEST(fingerprint) {
+  const int_computer_state x = { 1, 0, 0, 0, 99 };
+  int_computer_state y = x;
+  CHECK_EQUAL(x.fingerprint(), y.fingerprint());
+
+  y.eval1();
+  CHECK(x.fingerprint() != y.fingerprint());
+  CHECK_EQUAL(int_computer_state({ 2, 0, 0, 0, 99 }, 4).fingerprint(), y.fingerprint());
+}
+
+TEST(fingerprint_after_external_modification) {
+  int_computer_state x = { 1, 0, 0, 0, 99 };
+  const auto before = x.fingerprint();
+  x[3] = 4;
+  CHECK(before != x.fingerprint());
+  CHECK_EQUAL(int_computer_state({ 1, 0, 0, 4, 99 }).fingerprint(), x.fingerprint());
+
+  // Evaluation refreshes the memory hash, which is maintained incrementally after.
+  x[3] = 3;
+  x.eval();
+  CHECK_EQUAL(int_computer_state({ 1, 0, 0, 2, 99 }, 4).fingerprint(), x.fingerprint());
+}
+
+TEST(fingerprint_of_shared_const_state) {
+  int_computer_state modified = { 1, 0, 0, 0, 99 };
+  modified[3] = 4; // Memory hash is stale until the next evaluation.
+  const int_computer_state& shared = modified;
+  const int_computer_state copy = { 1, 0, 0, 4, 99 };
+
+  const auto hash_and_compare = [&shared, &copy]() {
+    bool ok = true;
+    for (int i = 0; i < 1000; ++i) ok = ok && shared.fingerprint() == copy.fingerprint() && shared == copy;
+    return ok;
+  };
+  auto other = std::async(std::launch::async, hash_and_compare);
+  CHECK(hash_and_compare());
+  CHECK(other.get());
+}
+
+TEST(hash_lookup) {
+  std::unordered_set<int_computer_state> states;
+  states.insert({ 1, 0, 0, 0, 99 });
+  states.insert(int_computer_state({ 1, 0, 0, 0, 99 }).eval1());
+
+  CHECK_EQUAL(2u, states.size());
+  CHECK(states.count(int_computer_state({ 2, 0, 0, 0, 99 }, 4)) == 1);
+  CHECK(states.count(int_computer_state({ 2, 0, 0, 0, 99 })) == 0);
+}
+
+TEST(budget_steps) {
+  // Counts [13] up to 100: 3 instructions per iteration, 300 in total.
+  const int_computer_state program({ 1001, 13, 1, 13, 1007, 13, 100, 14, 1005, 14, 0, 99, 0, 0, 0 });
+
+  auto exact = program;
+  auto budget = eval_budget::steps(300);
+  CHECK(exact.eval(budget) == int_computer_state::io_pending::halt);
+  CHECK_EQUAL(0u, budget.steps_left());
+  CHECK_EQUAL(100, exact[13]);
+
+  auto resumed = program;
+  budget = eval_budget::steps(299);
+  CHECK(resumed.eval(budget) == int_computer_state::io_pending::budget_exhausted);
+  CHECK(budget.exhausted());
+  CHECK(resumed.eval(budget) == int_computer_state::io_pending::budget_exhausted);
+  budget = eval_budget::steps(1);
+  CHECK(resumed.eval(budget) == int_computer_state::io_pending::halt);
+  CHECK_EQUAL(exact, resumed);
+}
+
+TEST(budget_time_slices) {
+  // Infinite loop.
+  int_computer_state s({ 1105, 1, 0 });
+  for (int slice = 0; slice < 3; ++slice) {
+    auto budget = eval_budget::steps(10000);
+    CHECK(s.eval_until_io_or_halt(budget) == int_computer_state::io_pending::budget_exhausted);
+  }
+
+  const auto t0 = eval_budget::clock::now();
+  auto budget = eval_budget::time(std::chrono::milliseconds(20));
+  CHECK(s.eval(budget) == int_computer_state::io_pending::budget_exhausted);
+  CHECK(eval_budget::clock::now() - t0 >= std::chrono::milliseconds(20));
+  CHECK(eval_budget::clock::now() - t0 < std::chrono::seconds(5));
+}
+
+TEST(budget_stops_before_io) {
+  int_computer_state s({ 3, 5, 4, 5, 99, 0 });
+  auto budget = eval_budget::steps(0);
+  CHECK(s.eval_until_io_or_halt(budget) == int_computer_state::io_pending::read);
+  CHECK(s.eval(budget) == int_computer_state::io_pending::budget_exhausted);
+  CHECK_EQUAL(0u, s.pc());
+}
+
 int main() {
   return UnitTest::RunAllTests();
 }
@@ -0,0 +1,51 @@
+#include <int_computer_pipe.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <vector>
+#include <objpipe/callback.h>
+
+
+using value_type = int_computer_state::value_type;
+
+auto values(std::vector<value_type> v) {
+  return objpipe::new_callback<value_type>(
+      [v](auto&& cb) {
+        for (const auto& x : v) cb(x);
+      });
+}
+
+
+TEST(unbounded_output) {
+  // Counts up from 1, forever.
+  auto p = output_pipe(int_computer_state({ 1001, 9, 1, 9, 4, 9, 1105, 1, 0, 0 }));
+  for (value_type i = 1; i <= 1000; ++i) CHECK_EQUAL(i, p.pull());
+}
+
+TEST(finite_output) {
+  const auto out = output_pipe(int_computer_state({ 104, 7, 104, 8, 99 })).to_vector();
+  CHECK_EQUAL(2u, out.size());
+  CHECK_EQUAL(7, out.at(0));
+  CHECK_EQUAL(8, out.at(1));
+}
+
+TEST(input_pipe) {
+  // Doubles each input.
+  auto p = output_pipe(
+      int_computer_state({ 3, 11, 1002, 11, 2, 11, 4, 11, 1105, 1, 0, 0 }),
+      values({ 1, 2, 3 }));
+  CHECK_EQUAL(2, p.pull());
+  CHECK_EQUAL(4, p.pull());
+  CHECK_EQUAL(6, p.pull());
+  CHECK_THROW(p.pull(), io_error);
+}
+
+TEST(machine_to_machine) {
+  const int_computer_state doubler({ 3, 11, 1002, 11, 2, 11, 4, 11, 1105, 1, 0, 0 });
+  const int_computer_state counter({ 1001, 9, 1, 9, 4, 9, 1105, 1, 0, 0 });
+
+  auto p = output_pipe(doubler, output_pipe(counter));
+  for (value_type i = 1; i <= 100; ++i) CHECK_EQUAL(2 * i, p.pull());
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,280 @@
+#include <ir_tier.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+using value_type = int_computer_state::value_type;
+
+struct outcome {
+  int_computer_state state;
+  std::vector<value_type> out;
+};
+
+///\brief Run \p s to halt, with the interpreter.
+auto interpret(int_computer_state s, std::vector<value_type> in = {}) -> outcome {
+  outcome result;
+  auto in_iter = in.begin();
+  s.read_cb = [&in, &in_iter]() {
+    if (in_iter == in.end()) throw io_error("out of input");
+    return *in_iter++;
+  };
+  s.write_cb = [&result](value_type v) { result.out.push_back(v); };
+  s.eval();
+  result.state = std::move(s);
+  return result;
+}
+
+///\brief Run \p s to halt, with the optimising tier.
+auto optimised(ir_tier& tier, int_computer_state s, std::vector<value_type> in = {}) -> outcome {
+  outcome result;
+  auto in_iter = in.begin();
+  s.read_cb = [&in, &in_iter]() {
+    if (in_iter == in.end()) throw io_error("out of input");
+    return *in_iter++;
+  };
+  s.write_cb = [&result](value_type v) { result.out.push_back(v); };
+  tier.eval(s);
+  result.state = std::move(s);
+  return result;
+}
+
+auto optimised(const int_computer_state& s, std::vector<value_type> in = {}, std::uint32_t hot_threshold = 0) -> outcome {
+  ir_tier tier(s, hot_threshold);
+  return optimised(tier, s, std::move(in));
+}
+
+auto same(const outcome& x, const outcome& y) -> bool {
+  return x.state == y.state && x.out == y.out;
+}
+
+// Count [20] to 1000: 0: add [20] 1 [20]; 4: less_than [20] 1000 [21]; 8: jump_if_true [21] 0; 11: halt
+const int_computer_state count_to_1000 = { 1001,20,1,20, 1007,20,1000,21, 1005,21,0, 99, 0,0,0,0,0,0,0,0, 0,0 };
+
+} /* namespace <unnamed> */
+
+
+TEST(matches_int_computer_tests) {
+  // Programs of tests/int_computer.cc that run to completion.
+  const std::vector<int_computer_state> programs = {
+    { 99 },
+    { 1, 9, 10, 3, 2, 3, 11, 0, 99, 30, 40, 50 },
+    { 1, 0, 2, 0, 99 },
+    { 1, 6, 5, 0, 99, 44, 33 },
+    { 2, 0, 2, 0, 99 },
+    { 2, 6, 5, 0, 99, 44, 33 },
+    { 3, 0, 99 },
+    { 4, 3, 99, 17 }
+  };
+
+  for (const auto& p : programs) {
+    CHECK(same(interpret(p, { 17 }), optimised(p, { 17 })));
+  }
+  CHECK_EQUAL(3500, optimised({ 1, 9, 10, 3, 2, 3, 11, 0, 99, 30, 40, 50 }).state[0]);
+}
+
+TEST(day5_part2_examples) {
+  const std::vector<int_computer_state> programs = {
+    { 3,9,8,9,10,9,4,9,99,-1,8 },
+    { 3,9,7,9,10,9,4,9,99,-1,8 },
+    { 3,3,1108,-1,8,3,4,3,99 },
+    { 3,3,1107,-1,8,3,4,3,99 },
+    { 3,21,1008,21,8,20,1005,20,22,107,8,21,20,1006,20,31,1106,0,36,98,0,0,1002,21,125,20,4,20,1105,1,46,104,999,1105,1,46,1101,1000,1,20,4,20,1105,1,46,98,99 }
+  };
+
+  for (const auto& p : programs) {
+    // A single tier sees all inputs, so blocks become hot after a few runs.
+    ir_tier tier(p, 2);
+    for (value_type x = 0; x < 16; ++x)
+      CHECK(same(interpret(p, { x }), optimised(tier, p, { x })));
+  }
+}
+
+TEST(loop) {
+  const auto before = int_computer_state::interpreted_instructions();
+  const auto expect = interpret(count_to_1000);
+  const auto interpreted = int_computer_state::interpreted_instructions() - before;
+  ir_tier tier(count_to_1000, 16);
+  const auto actual = optimised(tier, count_to_1000);
+  // Instructions executed by regions are counted as well.
+  CHECK_EQUAL(interpreted, int_computer_state::interpreted_instructions() - before - interpreted);
+
+  CHECK(same(expect, actual));
+  CHECK_EQUAL(1000, actual.state[20]);
+  CHECK_EQUAL(1u, tier.regions_built());
+  CHECK_EQUAL(0u, tier.deopts());
+  // The loop body is a single region with one load, one store and a conditional exit.
+  const std::string listing = tier.dump(0);
+  CHECK(listing.find("load [20]") != std::string::npos);
+  CHECK(listing.find("[20] =") != std::string::npos);
+  CHECK(listing.find("jump_if_true") != std::string::npos);
+}
+
+TEST(writes_back_only_last_store) {
+  // 0: add [20] 1 [20]; 4: add [20] 1 [20]; 8: mul [20] 1 [21]; 12: less_than [20] 100 [22]; 16: jump_if_true [22] 0; 19: halt
+  const int_computer_state p = { 1001,20,1,20, 1001,20,1,20, 1002,20,1,21, 1007,20,100,22, 1005,22,0, 99, 0,0,0 };
+  ir_tier tier(p, 0);
+  CHECK(same(interpret(p), optimised(tier, p)));
+
+  const std::string listing = tier.dump(0);
+  CHECK_EQUAL(std::string::npos, listing.find("[20] =", listing.find("[20] =") + 1u));
+  // Multiplication by one is folded: [21] is a copy of [20].
+  CHECK_EQUAL(std::string::npos, listing.find("*"));
+}
+
+TEST(constant_jumps_are_threaded) {
+  // 0: equals 5 5 [30]; 4: jump_if_true [30] 11; 7: add [31] 1000 [31]; 11: add [31] 1 [31];
+  // 15: less_than [31] 50 [32]; 19: jump_if_true [32] 0; 22: halt
+  const int_computer_state p = { 1108,5,5,30, 1005,30,11, 1001,31,1000,31, 1001,31,1,31, 1007,31,50,32, 1005,32,0, 99,
+      0,0,0,0,0,0,0,0, 0,0,0 };
+  ir_tier tier(p, 0);
+  const auto actual = optimised(tier, p);
+
+  CHECK(same(interpret(p), actual));
+  CHECK_EQUAL(50, actual.state[31]);
+  const std::string listing = tier.dump(0);
+  CHECK_EQUAL(std::string::npos, listing.find("=="));
+  CHECK_EQUAL(std::string::npos, listing.find("1000"));
+}
+
+TEST(deopt_on_self_modification) {
+  // Counts [30] to 5 in steps of 1, then rewrites the step to 2 and counts again.
+  // 0: add [30] 1 [30]; 4: less_than [30] 5 [31]; 8: jump_if_true [31] 0;
+  // 11: jump_if_true [32] 29; 14: add 0 1 [32]; 18: add 0 2 [2]; 22: add 0 0 [30]; 26: jump 0; 29: halt
+  const int_computer_state p = { 1001,30,1,30, 1007,30,5,31, 1005,31,0, 1005,32,29, 1101,0,1,32, 1101,0,2,2, 1101,0,0,30, 1105,1,0, 99, 0,0,0 };
+  ir_tier tier(p, 0);
+  const auto actual = optimised(tier, p);
+
+  CHECK(same(interpret(p), actual));
+  CHECK_EQUAL(6, actual.state[30]);
+  CHECK_EQUAL(2, actual.state[2]);
+  CHECK_EQUAL(1u, tier.deopts());
+}
+
+TEST(respects_budget) {
+  ir_tier tier(count_to_1000, 0);
+  int_computer_state s = count_to_1000;
+  unsigned int slices = 0;
+  for (;;) {
+    auto budget = eval_budget::steps(100);
+    if (tier.eval_until_io_or_halt(s, budget) == int_computer_state::io_pending::halt) break;
+    CHECK(budget.exhausted());
+    ++slices;
+  }
+
+  CHECK(same(interpret(count_to_1000), outcome{ s, {} }));
+  CHECK_EQUAL(29u, slices); // 3000 instructions, the last slice ending at the halt
+}
+
+TEST(random_programs_match_interpreter) {
+  std::mt19937 rng(7);
+  constexpr unsigned int instrs = 24, data = 8;
+
+  for (int round = 0; round < 300; ++round) {
+    // Lay out instructions, so jump targets can be chosen from their addresses.
+    std::vector<opcode> ops;
+    std::vector<std::size_t> starts;
+    std::size_t size = 0;
+    for (unsigned int i = 0; i < instrs; ++i) {
+      static constexpr opcode choice[] = {
+        opcode::add, opcode::mul, opcode::less_than, opcode::equals,
+        opcode::jump_if_true, opcode::jump_if_false, opcode::read, opcode::write
+      };
+      ops.push_back(i + 1u == instrs ? opcode::halt : choice[rng() % std::size(choice)]);
+      starts.push_back(size);
+      switch (ops.back()) {
+        default:
+          size += 4;
+          break;
+        case opcode::jump_if_true: [[fallthrough]];
+        case opcode::jump_if_false:
+          size += 3;
+          break;
+        case opcode::read: [[fallthrough]];
+        case opcode::write:
+          size += 2;
+          break;
+        case opcode::halt:
+          size += 1;
+          break;
+      }
+    }
+    const std::size_t data_start = size;
+    std::vector<value_type> m(size + data, 0);
+    for (std::size_t i = data_start; i < m.size(); ++i) m[i] = value_type(rng() % 5);
+
+    std::vector<std::size_t> patchable; // Immediate operands of arithmetic, safe to overwrite.
+    for (unsigned int i = 0; i < instrs; ++i) {
+      const std::size_t pc = starts[i];
+      const auto data_addr = [&]() { return value_type(data_start + rng() % data); };
+      value_type modes = 0;
+      switch (ops[i]) {
+        default:
+          for (int a = 0; a < 2; ++a) {
+            const bool imm = rng() % 2u == 0u;
+            m[pc + 1 + a] = imm ? value_type(rng() % 7) - 3 : data_addr();
+            if (imm) {
+              modes += (a == 0 ? 1 : 10);
+              patchable.push_back(pc + 1 + a);
+            }
+          }
+          m[pc + 3] = data_addr();
+          break;
+        case opcode::jump_if_true: [[fallthrough]];
+        case opcode::jump_if_false:
+          if (rng() % 2u == 0u) {
+            modes += 1;
+            m[pc + 1] = value_type(rng() % 2);
+          } else {
+            m[pc + 1] = data_addr();
+          }
+          modes += 10;
+          m[pc + 2] = value_type(starts[rng() % instrs]);
+          break;
+        case opcode::read: [[fallthrough]];
+        case opcode::write:
+          m[pc + 1] = data_addr();
+          break;
+        case opcode::halt:
+          break;
+      }
+      m[pc] = modes * 100 + value_type(ops[i]);
+    }
+    // Some arithmetic stores into patchable code instead of data.
+    for (unsigned int i = 0; i < instrs && !patchable.empty(); ++i) {
+      if (m[starts[i]] % 100 <= 2 && rng() % 6u == 0u)
+        m[starts[i] + 3] = value_type(patchable[rng() % patchable.size()]);
+    }
+    const int_computer_state p(m.begin(), m.end());
+
+    // Only compare programs that halt within a reasonable time.
+    int_computer_state s = p;
+    value_type next_input = 0;
+    std::vector<value_type> out;
+    s.read_cb = [&next_input]() { return next_input++ % 7; };
+    s.write_cb = [&out](value_type v) { out.push_back(v); };
+    auto budget = eval_budget::steps(20000);
+    if (s.eval(budget) != int_computer_state::io_pending::halt) continue;
+
+    for (std::uint32_t threshold : { 0u, 3u }) {
+      ir_tier tier(p, threshold);
+      int_computer_state t = p;
+      value_type tier_next_input = 0;
+      std::vector<value_type> tier_out;
+      t.read_cb = [&tier_next_input]() { return tier_next_input++ % 7; };
+      t.write_cb = [&tier_out](value_type v) { tier_out.push_back(v); };
+      tier.eval(t);
+
+      CHECK(s == t);
+      CHECK(out == tier_out);
+    }
+  }
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,162 @@
+#include <machine_event_loop.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+namespace {
+
+struct fd_pair {
+  fd_pair() {
+    int fds[2];
+    if (::pipe(fds) != 0) throw std::runtime_error("pipe");
+    r = fds[0];
+    w = fds[1];
+  }
+
+  int r, w;
+};
+
+void write_all(int fd, const std::string& text) {
+  CHECK_EQUAL(ssize_t(text.size()), ::write(fd, text.data(), text.size()));
+}
+
+///\brief Read whatever is available (non-blocking) or, if \p block, until end of file.
+auto read_some(int fd, bool block = false) -> std::string {
+  std::string result;
+  char buf[4096];
+  for (;;) {
+    const ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n <= 0) break;
+    result.append(buf, n);
+    if (!block) break;
+  }
+  return result;
+}
+
+// Doubles its input: 0: read [11]; 2: mul 2 [11] [12]; 6: write [12]; 8: jump 0
+const int_computer_state doubler = { 3,11, 102,2,11,12, 4,12, 1105,1,0, 0,0 };
+
+} /* namespace <unnamed> */
+
+
+TEST(runs_machine_on_pipes) {
+  fd_pair in, out;
+  write_all(in.w, "8\n");
+  ::close(in.w);
+
+  machine_event_loop loop;
+  const auto id = loop.add(compact_machine(int_computer_state{ 3,9,8,9,10,9,4,9,99,-1,8 }), in.r, out.w);
+  loop.run();
+
+  CHECK(loop.status(id) == machine_event_loop::machine_status::halted);
+  CHECK_EQUAL("1\n", read_some(out.r, true));
+  ::close(out.r);
+}
+
+TEST(parks_until_input_arrives) {
+  fd_pair in, out;
+  machine_event_loop loop;
+  const auto id = loop.add(compact_machine(doubler), in.r, out.w);
+
+  CHECK_EQUAL(1u, loop.run_once(0));
+  CHECK_EQUAL(1u, loop.run_once(0));
+  CHECK(loop.status(id) == machine_event_loop::machine_status::running);
+
+  // A value split over two writes.
+  write_all(in.w, "2");
+  loop.run_once(100);
+  loop.run_once(0);
+  write_all(in.w, "1,");
+  ::fcntl(out.r, F_SETFL, O_NONBLOCK);
+  std::string output;
+  for (int i = 0; i < 100 && output.empty(); ++i) {
+    loop.run_once(10);
+    output += read_some(out.r);
+  }
+  CHECK_EQUAL("42\n", output);
+
+  // End of input while reading fails the machine.
+  ::close(in.w);
+  for (int i = 0; i < 100 && loop.active() != 0u; ++i) loop.run_once(10);
+  CHECK(loop.status(id) == machine_event_loop::machine_status::failed);
+  CHECK_EQUAL("unexpected end of input", loop.error(id));
+  ::close(out.r);
+}
+
+TEST(many_machines_on_one_thread) {
+  // 0: read [9]; 2: add [9] 1 [9]; 6: write [9]; 8: halt
+  const auto image = compact_machine::make_image({ 3,9, 1001,9,1,9, 4,9, 99, 0 });
+  constexpr int n = 500;
+
+  machine_event_loop loop;
+  std::vector<int> peers;
+  for (int i = 0; i < n; ++i) {
+    int fds[2];
+    CHECK_EQUAL(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    loop.add(compact_machine(image), fds[0], fds[0]);
+    peers.push_back(fds[1]);
+  }
+  // All machines park on their input.
+  CHECK_EQUAL(std::size_t(n), loop.run_once(0));
+
+  for (int i = 0; i < n; ++i) write_all(peers[i], std::to_string(i) + "\n");
+  loop.run();
+
+  for (int i = 0; i < n; ++i) {
+    CHECK_EQUAL(std::to_string(i + 1) + "\n", read_some(peers[i], true));
+    CHECK(loop.status(i) == machine_event_loop::machine_status::halted);
+    ::close(peers[i]);
+  }
+}
+
+TEST(time_slices_share_the_thread) {
+  fd_pair spin_in, spin_out, in, out;
+  write_all(in.w, "5\n");
+
+  machine_event_loop loop(1000);
+  const auto spin = loop.add(compact_machine(int_computer_state{ 1105,1,0 }), spin_in.r, spin_out.w);
+  const auto echo = loop.add(compact_machine(int_computer_state{ 3,9,8,9,10,9,4,9,99,-1,8 }), in.r, out.w);
+  for (int i = 0; i < 100 && loop.status(echo) == machine_event_loop::machine_status::running; ++i)
+    loop.run_once(0);
+
+  CHECK(loop.status(echo) == machine_event_loop::machine_status::halted);
+  CHECK(loop.status(spin) == machine_event_loop::machine_status::running);
+  CHECK_EQUAL("0\n", read_some(out.r, true));
+  ::close(in.w);
+  ::close(out.r);
+  ::close(spin_in.w);
+  ::close(spin_out.r);
+}
+
+TEST(output_is_written_as_the_reader_drains_it) {
+  // Writes 0..99999: 0: write [20]; 2: add [20] 1 [20]; 6: less_than [20] 100000 [21]; 10: jump_if_true [21] 0; 13: halt
+  const int_computer_state program = { 4,20, 1001,20,1,20, 1007,20,100000,21, 1005,21,0, 99, 0,0,0,0,0,0, 0,0 };
+  fd_pair in, out;
+  ::close(in.w);
+  ::fcntl(out.r, F_SETFL, O_NONBLOCK);
+
+  machine_event_loop loop;
+  const auto id = loop.add(compact_machine(program), in.r, out.w);
+  std::string output;
+  for (;;) {
+    const bool active = loop.run_once(0) != 0u;
+    const std::string chunk = read_some(out.r);
+    output += chunk;
+    if (!active && chunk.empty()) break;
+  }
+
+  CHECK(loop.status(id) == machine_event_loop::machine_status::halted);
+  CHECK_EQUAL(std::size_t(100000), std::size_t(std::count(output.begin(), output.end(), '\n')));
+  CHECK_EQUAL("99999\n", output.substr(output.size() - 6u));
+  ::close(out.r);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,81 @@
+#include <orbit_distance.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+const std::string day6_example = "COM)B\nB)C\nC)D\nD)E\nE)F\nB)G\nG)H\nD)I\nE)J\nJ)K\nK)L\nK)YOU\nI)SAN\n";
+
+///\brief Distance by walking both paths to the root.
+auto naive_distance(const orbit_table& t, orbit_table::id_type a, orbit_table::id_type b) -> orbit_table::id_type {
+  std::vector<orbit_table::id_type> pa, pb;
+  for (auto i = a; i != orbit_table::npos; i = t.parent(i)) pa.insert(pa.begin(), i);
+  for (auto i = b; i != orbit_table::npos; i = t.parent(i)) pb.insert(pb.begin(), i);
+  if (pa.front() != pb.front()) return orbit_distance_index::no_path;
+
+  std::size_t common = 0;
+  while (common < pa.size() && common < pb.size() && pa[common] == pb[common]) ++common;
+  return pa.size() + pb.size() - 2u * common;
+}
+
+
+TEST(day6_example) {
+  const auto t = orbit_table::parse(day6_example, 1);
+  const orbit_distance_index idx(t);
+  const auto you = t.find("YOU"), san = t.find("SAN");
+  CHECK_EQUAL(4u, idx.distance(t.parent(you), t.parent(san)));
+  CHECK_EQUAL(t.find("D"), idx.common_ancestor(you, san));
+  CHECK_EQUAL(0u, idx.distance(you, you));
+  CHECK_EQUAL(7u, idx.distance(t.find("COM"), t.find("L")));
+  CHECK_THROW(idx.distance(you, orbit_table::id_type(t.size())), std::out_of_range);
+}
+
+TEST(separate_trees) {
+  const auto t = orbit_table::parse("A)B\nB)C\nX)Y\nY)Z\nB)D\n", 1);
+  const orbit_distance_index idx(t);
+  CHECK_EQUAL(orbit_distance_index::no_path, idx.distance(t.find("C"), t.find("Z")));
+  CHECK_EQUAL(orbit_distance_index::npos, idx.common_ancestor(t.find("A"), t.find("X")));
+  CHECK_EQUAL(2u, idx.distance(t.find("C"), t.find("D")));
+}
+
+TEST(batch_matches_naive) {
+  std::uint64_t rng = 7;
+  const auto next = [&rng](std::uint64_t n) -> std::uint64_t {
+    rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+    return (rng >> 33) % n;
+  };
+
+  // Two trees, with a mix of long chains and bushy parts.
+  std::string text;
+  for (int i = 1; i < 3000; ++i) {
+    if (i == 1500) continue;
+    const int base = (i < 1500 ? 0 : 1500);
+    const int window = (next(2) == 0 ? std::min(3, i - base) : i - base);
+    const int parent = i - 1 - int(next(window));
+    text += "B" + std::to_string(parent) + ")B" + std::to_string(i) + "\n";
+  }
+  const auto t = orbit_table::parse(text, 2);
+  const orbit_distance_index idx(t);
+
+  std::vector<orbit_distance_index::query> queries;
+  for (int i = 0; i < 5000; ++i)
+    queries.emplace_back(next(t.size()), next(t.size()));
+
+  for (unsigned int threads = 1; threads <= 3; ++threads) {
+    const auto result = idx.distances(queries, threads);
+    CHECK_EQUAL(queries.size(), result.size());
+    for (std::size_t i = 0; i < queries.size(); ++i)
+      CHECK_EQUAL(naive_distance(t, queries[i].first, queries[i].second), result[i]);
+  }
+}
+
+TEST(cycle) {
+  const auto t = orbit_table::parse("COM)B\nC)D\nD)C\n", 1);
+  CHECK_THROW(orbit_distance_index{ t }, std::runtime_error);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,109 @@
+#include <orbit_image.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+
+const std::string day6_example = "COM)B\nB)C\nC)D\nD)E\nE)F\nB)G\nG)H\nD)I\nE)J\nJ)K\nK)L\nK)YOU\nI)SAN\n";
+
+auto path_string(const std::vector<std::string_view>& path) -> std::string {
+  std::string result;
+  for (const auto& p : path) {
+    if (!result.empty()) result += ",";
+    result += p;
+  }
+  return result;
+}
+
+
+TEST(roundtrip) {
+  const std::string filename = "orbit_image_test.bin";
+  orbit_image::write(filename, orbit_table::parse(day6_example, 2));
+
+  const orbit_image img(filename);
+  CHECK_EQUAL(14u, img.size());
+  CHECK(img.has_depths());
+  CHECK_EQUAL(orbit_image::npos, img.find("X"));
+  CHECK_EQUAL(std::string("L"), std::string(img.name(img.find("L"))));
+  CHECK_EQUAL(7u, img.depth(img.find("L")));
+  CHECK_EQUAL(0u, img.depth(img.find("COM")));
+  CHECK_EQUAL(std::string("K"), std::string(*img.body_of("YOU")));
+  CHECK(!img.body_of("COM").has_value());
+  CHECK(!img.body_of("X").has_value());
+  CHECK_EQUAL(std::string("COM,B,C,D,E,J,K"), path_string(img.path("YOU", false)));
+  CHECK_EQUAL(std::string("COM,B,C,D,I,SAN"), path_string(img.path("SAN", true)));
+  std::remove(filename.c_str());
+}
+
+TEST(without_depths) {
+  const std::string filename = "orbit_image_test.bin";
+  auto in = std::istringstream(day6_example);
+  const auto m = orbit_map::parse(in);
+  orbit_image::write(filename, m, false);
+
+  const orbit_image img(filename);
+  CHECK(!img.has_depths());
+  CHECK_EQUAL(m.all_bodies().size(), img.size());
+  for (const auto& b : m.all_bodies()) {
+    CHECK_EQUAL(m.depth(b), img.depth(img.find(b)));
+    CHECK_EQUAL(m.path(b, true).size(), img.path(b, true).size());
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(empty) {
+  const std::string filename = "orbit_image_test.bin";
+  orbit_image::write(filename, orbit_table());
+  const orbit_image img(filename);
+  CHECK(img.empty());
+  CHECK_EQUAL(orbit_image::npos, img.find("COM"));
+  std::remove(filename.c_str());
+}
+
+TEST(invalid_file) {
+  const std::string filename = "orbit_image_test.bin";
+  std::ofstream(filename) << day6_example;
+  CHECK_THROW(orbit_image{ filename }, std::runtime_error);
+
+  orbit_image::write(filename, orbit_table::parse(day6_example, 1));
+  std::string data;
+  {
+    std::ifstream in(filename, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  data.pop_back();
+  std::ofstream(filename, std::ios::binary | std::ios::trunc) << data;
+  CHECK_THROW(orbit_image{ filename }, std::runtime_error);
+  std::remove(filename.c_str());
+}
+
+TEST(corrupt_index) {
+  const std::string filename = "orbit_image_test.bin";
+  orbit_image::write(filename, orbit_table::parse(day6_example, 1));
+  std::string data;
+  {
+    std::ifstream in(filename, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  // Header, name offsets, parents and depths precede the sorted index.
+  const std::size_t sorted = 24u + 8u * 15u + 4u * 14u + 4u * 14u;
+  std::string bad_index = data;
+  bad_index.replace(sorted, 4u * 14u, 4u * 14u, '\xff');
+  std::ofstream(filename, std::ios::binary | std::ios::trunc) << bad_index;
+  CHECK_THROW(orbit_image{ filename }.find("L"), std::runtime_error);
+
+  // Inner name offsets beyond the names section.
+  std::string bad_offset = data;
+  bad_offset.replace(24u + 8u, 8u * 13u, 8u * 13u, '\x7f');
+  std::ofstream(filename, std::ios::binary | std::ios::trunc) << bad_offset;
+  CHECK_THROW(orbit_image{ filename }.find("L"), std::runtime_error);
+  std::remove(filename.c_str());
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
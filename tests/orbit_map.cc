@@ -0,0 +1,107 @@
+#include <orbit_map.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+const std::string day6_example = "COM)B\nB)C\nC)D\nD)E\nE)F\nB)G\nG)H\nD)I\nE)J\nJ)K\nK)L\n";
+
+auto parse(const std::string& text) -> orbit_map {
+  auto in = std::istringstream(text);
+  return orbit_map::parse(in);
+}
+
+///\brief Count orbits the slow way.
+auto brute_force_total(const orbit_map& m) -> orbit_map::size_type {
+  orbit_map::size_type result = 0;
+  for (const auto& b : m.all_bodies()) result += m.path(b, false).size();
+  return result;
+}
+
+
+TEST(total_orbits) {
+  const auto m = parse(day6_example);
+  CHECK_EQUAL(42u, m.total_orbits());
+  CHECK_EQUAL(7u, m.depth("L"));
+  CHECK_EQUAL(0u, m.depth("COM"));
+  CHECK_EQUAL(12u, m.subtree_size("COM"));
+  CHECK_EQUAL(7u, m.subtree_size("D"));
+  CHECK_THROW(m.depth("YOU"), std::out_of_range);
+}
+
+TEST(insert_and_erase) {
+  auto m = parse(day6_example);
+  m.insert("K", "YOU");
+  m.insert("I", "SAN");
+  CHECK_EQUAL(42u + 7u + 5u, m.total_orbits());
+  CHECK_EQUAL(9u, m.subtree_size("D"));
+
+  CHECK(m.erase("YOU"));
+  CHECK(!m.erase("YOU"));
+  CHECK_EQUAL(42u + 5u, m.total_orbits());
+  CHECK_THROW(m.depth("YOU"), std::out_of_range);
+
+  // Erasing an inner orbit leaves its satelites in place.
+  CHECK(m.erase("D"));
+  CHECK_EQUAL(brute_force_total(m), m.total_orbits());
+  CHECK_EQUAL(0u, m.depth("D"));
+  CHECK_EQUAL(4u, m.depth("L"));
+}
+
+TEST(insert_rejects_invalid) {
+  auto m = parse(day6_example);
+  CHECK_THROW(m.insert("COM", "L"), std::invalid_argument);
+  CHECK_THROW(m.insert("L", "COM"), std::invalid_argument);
+  CHECK_THROW(m.insert("X", "X"), std::invalid_argument);
+  CHECK_THROW(m.depth("X"), std::out_of_range);
+  CHECK_EQUAL(42u, m.total_orbits());
+}
+
+TEST(reparent) {
+  auto m = parse(day6_example);
+  m.reparent("G", "L");
+  CHECK_EQUAL(brute_force_total(m), m.total_orbits());
+  CHECK_EQUAL(9u, m.depth("H"));
+
+  CHECK_THROW(m.reparent("D", "H"), std::invalid_argument);
+  CHECK_EQUAL(9u, m.depth("H"));
+  CHECK_EQUAL(brute_force_total(m), m.total_orbits());
+  CHECK_THROW(m.reparent("COM", "H"), std::out_of_range);
+}
+
+TEST(random_updates) {
+  auto m = parse(day6_example);
+  std::uint64_t rng = 1;
+  const auto next = [&rng](unsigned int n) -> unsigned int {
+    rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+    return (rng >> 33) % n;
+  };
+  const auto name = [](unsigned int i) { return "N" + std::to_string(i); };
+
+  for (int i = 0; i < 500; ++i) {
+    const auto s = name(next(40));
+    const auto b = name(next(40));
+    try {
+      switch (next(3)) {
+        case 0:
+          m.insert(b, s);
+          break;
+        case 1:
+          m.erase(s);
+          break;
+        case 2:
+          m.reparent(s, b);
+          break;
+      }
+    } catch (const std::logic_error&) {
+      // Rejected updates must leave the map intact.
+    }
+    CHECK_EQUAL(brute_force_total(m), m.total_orbits());
+  }
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,98 @@
+#include <orbit_table.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+const std::string day6_example = "COM)B\nB)C\nC)D\nD)E\nE)F\nB)G\nG)H\nD)I\nE)J\nJ)K\nK)L\n";
+
+auto depth(const orbit_table& t, std::string_view name) -> int {
+  int result = 0;
+  for (auto id = t.parent(t.find(name)); id != orbit_table::npos; id = t.parent(id)) ++result;
+  return result;
+}
+
+
+TEST(parse) {
+  const auto t = orbit_table::parse(day6_example, 1);
+  CHECK_EQUAL(12u, t.size());
+  CHECK_EQUAL(orbit_table::npos, t.parent(t.find("COM")));
+  CHECK_EQUAL(std::string("K"), std::string(t.name(t.parent(t.find("L")))));
+  CHECK_EQUAL(7, depth(t, "L"));
+  CHECK_EQUAL(orbit_table::npos, t.find("YOU"));
+}
+
+TEST(parse_parallel) {
+  for (unsigned int threads = 2; threads <= 8; ++threads) {
+    const auto t = orbit_table::parse(day6_example, threads);
+    CHECK_EQUAL(12u, t.size());
+    CHECK_EQUAL(7, depth(t, "L"));
+    CHECK_EQUAL(3, depth(t, "H"));
+  }
+}
+
+TEST(white_space_inside_pairs) {
+  const auto t = orbit_table::parse("COM)B B\n)\nC\nC)D", 4);
+  CHECK_EQUAL(4u, t.size());
+  CHECK_EQUAL(3, depth(t, "D"));
+}
+
+TEST(duplicate_satelite) {
+  CHECK_THROW(orbit_table::parse("COM)B\nB)C\nCOM)C\n", 1), std::runtime_error);
+  CHECK_THROW(orbit_table::parse("COM)B\nB)C\nCOM)C\n", 3), std::runtime_error);
+  CHECK_THROW(orbit_table::parse("COM)B\nB)\n", 2), std::runtime_error);
+}
+
+TEST(orbit_map_roundtrip) {
+  auto in = std::istringstream(day6_example);
+  const auto m = orbit_map::parse(in);
+  const auto t = orbit_table(m);
+  CHECK_EQUAL(12u, t.size());
+  CHECK_EQUAL(7, depth(t, "L"));
+  CHECK_EQUAL(m.path("L", true).size(), t.to_orbit_map().path("L", true).size());
+}
+
+TEST(load) {
+  const std::string filename = "orbit_table_test.txt";
+  std::ofstream(filename) << day6_example;
+  const auto t = orbit_table::load(filename, 3);
+  std::remove(filename.c_str());
+
+  CHECK_EQUAL(12u, t.size());
+  CHECK_EQUAL(7, depth(t, "L"));
+}
+
+TEST(depths) {
+  const auto t = orbit_table::parse(day6_example, 1);
+  for (unsigned int threads = 1; threads <= 4; ++threads) {
+    const auto d = t.depths(threads);
+    CHECK_EQUAL(12u, d.size());
+    CHECK_EQUAL(7u, d[t.find("L")]);
+    CHECK_EQUAL(0u, d[t.find("COM")]);
+    CHECK_EQUAL(42u, t.total_orbits(threads));
+  }
+}
+
+TEST(depths_long_chain) {
+  std::string text;
+  for (int i = 1; i < 5000; ++i)
+    text += "B" + std::to_string(i - 1) + ")B" + std::to_string(i) + "\n";
+  const auto t = orbit_table::parse(text, 4);
+  const auto expected = t.depths(1);
+  CHECK_EQUAL(4999u, expected[t.find("B4999")]);
+  for (unsigned int threads = 2; threads <= 7; ++threads)
+    CHECK(expected == t.depths(threads));
+  CHECK_EQUAL(4999u * 5000u / 2u, t.total_orbits(3));
+}
+
+TEST(depths_cycle) {
+  const auto t = orbit_table::parse("COM)B\nC)D\nD)E\nE)C\nA)X\nX)Y\n", 1);
+  CHECK_THROW(t.depths(1), std::runtime_error);
+  CHECK_THROW(t.depths(2), std::runtime_error);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,52 @@
+#include <perf_counters.hh>
+#include <int_computer.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <sstream>
+#include <string>
+
+
+TEST(counts_interpreted_instructions) {
+  // add, mul; reaching halt is not an executed instruction.
+  const auto before = int_computer_state::interpreted_instructions();
+  int_computer_state ic{ 1,9,10,3,2,3,11,0,99,30,40,50 };
+  ic.eval();
+  CHECK_EQUAL(2u, int_computer_state::interpreted_instructions() - before);
+}
+
+TEST(reading_covers_eval) {
+  perf_counters counters;
+  counters.start();
+  for (int i = 0; i < 100; ++i) {
+    int_computer_state ic{ 1,9,10,3,2,3,11,0,99,30,40,50 };
+    ic.eval();
+  }
+  const auto r = counters.stop();
+
+  CHECK_EQUAL(200u, r.interpreted);
+  CHECK(r.elapsed.count() > 0);
+  for (std::size_t i = 0; i < perf_counters::event_count; ++i) {
+    const auto e = perf_counters::event(i);
+    // Counters may be unavailable (no PMU, or forbidden by perf_event_paranoid).
+    CHECK_EQUAL(counters.available(e), r[e].has_value());
+  }
+  if (r[perf_counters::event::instructions].has_value())
+    CHECK(*r[perf_counters::event::instructions] >= r.interpreted);
+}
+
+TEST(report) {
+  std::ostringstream out;
+  {
+    perf_scope scope("test-label", out);
+    int_computer_state ic{ 1,9,10,3,2,3,11,0,99,30,40,50 };
+    ic.eval();
+  }
+
+  const std::string text = out.str();
+  CHECK(text.find("test-label: ") != std::string::npos);
+  CHECK(text.find("2 instructions interpreted") != std::string::npos);
+  CHECK(text.find("branch-misses") != std::string::npos);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
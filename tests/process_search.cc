@@ -0,0 +1,137 @@
+#include <process_search.hh>
+#include <amplifier.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+
+
+namespace {
+
+using value_type = process_search::value_type;
+
+const int_computer_state day7_example = {3,52,1001,52,-5,52,3,53,1,52,56,54,1007,54,5,55,1005,55,26,1001,54,-5,54,1105,1,12,1,53,54,53,1008,54,0,55,1001,55,1,55,2,53,55,53,4,53,1001,56,-1,56,1005,56,6,99,0,0,0,0,10};
+
+///\brief Counter shared with forked workers.
+class shared_counter {
+  public:
+  shared_counter()
+  : p_(static_cast<std::atomic<int>*>(::mmap(nullptr, sizeof(std::atomic<int>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)))
+  {
+    new (p_) std::atomic<int>(0);
+  }
+
+  ~shared_counter() {
+    ::munmap(p_, sizeof(std::atomic<int>));
+  }
+
+  auto operator++() noexcept -> int { return ++*p_; }
+  auto get() const noexcept -> int { return *p_; }
+
+  private:
+  std::atomic<int>* p_;
+};
+
+} /* namespace <unnamed> */
+
+TEST(finds_best_candidate) {
+  const auto r = process_search(3, 7).run({ 99 }, 100,
+      [](const int_computer_state&, std::uint64_t c) -> std::optional<value_type> {
+        if (c % 3u == 0u) return {};
+        return value_type(c % 10u);
+      });
+
+  CHECK(r.best.has_value());
+  CHECK_EQUAL(9, r.best.value_or(-1));
+  CHECK_EQUAL(19u, r.candidate); // 9 is a multiple of 3
+  CHECK_EQUAL(100u, r.evaluated);
+  CHECK_EQUAL(0u, r.crashes);
+  CHECK_EQUAL(0u, r.failed_ranges);
+}
+
+TEST(workers_see_program) {
+  const auto r = process_search(2, 4).run({ 99,7 }, 10,
+      [](const int_computer_state& program, std::uint64_t c) -> std::optional<value_type> {
+        return program[1] * value_type(c);
+      });
+
+  CHECK_EQUAL(63, r.best.value_or(-1));
+  CHECK_EQUAL(9u, r.candidate);
+}
+
+TEST(empty_search) {
+  const auto r = process_search(2).run({ 99 }, 0,
+      [](const int_computer_state&, std::uint64_t) -> std::optional<value_type> { return 1; });
+
+  CHECK(!r.best.has_value());
+  CHECK_EQUAL(0u, r.evaluated);
+}
+
+TEST(retries_range_of_crashed_worker) {
+  shared_counter crashed;
+  const auto r = process_search(2, 10).run({ 99 }, 100,
+      [&crashed](const int_computer_state&, std::uint64_t c) -> std::optional<value_type> {
+        if (c == 42u && ++crashed == 1) std::raise(SIGKILL);
+        return value_type(c);
+      });
+
+  CHECK_EQUAL(2, crashed.get());
+  CHECK_EQUAL(1u, r.crashes);
+  CHECK_EQUAL(1u, r.retried_ranges);
+  CHECK_EQUAL(0u, r.failed_ranges);
+  CHECK_EQUAL(100u, r.evaluated);
+  CHECK_EQUAL(99, r.best.value_or(-1));
+}
+
+TEST(gives_up_on_range_after_retries) {
+  const auto r = process_search(2, 10, 2).run({ 99 }, 100,
+      [](const int_computer_state&, std::uint64_t c) -> std::optional<value_type> {
+        if (c == 95u) throw std::runtime_error("expected failure");
+        return value_type(c);
+      });
+
+  CHECK_EQUAL(3u, r.crashes);
+  CHECK_EQUAL(2u, r.retried_ranges);
+  CHECK_EQUAL(1u, r.failed_ranges);
+  CHECK_EQUAL(90u, r.evaluated);
+  CHECK_EQUAL(89, r.best.value_or(-1));
+}
+
+TEST(unclaimed_ranges_keep_their_retries) {
+  // The single worker crashes on the first range, every round.
+  const auto r = process_search(1, 1, 3).run({ 99 }, 4,
+      [](const int_computer_state&, std::uint64_t c) -> std::optional<value_type> {
+        if (c == 0u) throw std::runtime_error("expected failure");
+        return value_type(c);
+      });
+
+  CHECK_EQUAL(4u, r.crashes);
+  CHECK_EQUAL(3u, r.retried_ranges);
+  CHECK_EQUAL(1u, r.failed_ranges);
+  CHECK_EQUAL(3u, r.evaluated);
+  CHECK_EQUAL(3, r.best.value_or(-1));
+}
+
+TEST(phase_search) {
+  std::shared_ptr<phase_cache> cache;
+  const auto r = process_search(2, 16).run(day7_example, 120,
+      [cache](const int_computer_state& program, std::uint64_t c) mutable -> std::optional<value_type> {
+        if (cache == nullptr) cache = std::make_shared<phase_cache>(program);
+        std::array<int, 5> phases{ 5,6,7,8,9 };
+        for (std::uint64_t i = 0; i < c; ++i) std::next_permutation(phases.begin(), phases.end());
+        amplifier_chain chain;
+        chain.reset(phases.begin(), phases.end(), *cache);
+        return chain.feedback_eval(0);
+      });
+
+  CHECK_EQUAL(18216, r.best.value_or(-1));
+  CHECK_EQUAL(120u, r.evaluated);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
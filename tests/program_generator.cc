@@ -0,0 +1,164 @@
+#include <program_generator.hh>
+#include <control_flow.hh>
+#include <ir_tier.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+using value_type = int_computer_state::value_type;
+
+struct outcome {
+  int_computer_state state;
+  std::vector<value_type> out;
+};
+
+///\brief Attach \p in as input and collect output into \p result.
+void bind_io(int_computer_state& s, const std::vector<value_type>& in, outcome& result) {
+  auto in_iter = std::make_shared<std::vector<value_type>::const_iterator>(in.begin());
+  s.read_cb = [&in, in_iter]() {
+    if (*in_iter == in.end()) throw io_error("out of input");
+    return *(*in_iter)++;
+  };
+  s.write_cb = [&result](value_type v) { result.out.push_back(v); };
+}
+
+auto interpret(const program_generator::program& p) -> outcome {
+  outcome result;
+  result.state = p.image;
+  bind_io(result.state, p.input, result);
+  result.state.eval();
+  return result;
+}
+
+auto blocks(const program_generator::program& p) -> outcome {
+  const control_flow_graph cfg(p.image);
+  outcome result;
+  result.state = p.image;
+  bind_io(result.state, p.input, result);
+  while (result.state.eval_until_io_or_halt(cfg) != int_computer_state::io_pending::halt)
+    result.state.eval1();
+  return result;
+}
+
+auto optimised(const program_generator::program& p) -> outcome {
+  ir_tier tier(p.image, 4);
+  outcome result;
+  result.state = p.image;
+  bind_io(result.state, p.input, result);
+  tier.eval(result.state);
+  return result;
+}
+
+auto config(std::uint64_t seed) -> generator_config {
+  generator_config cfg;
+  cfg.words = 2000;
+  cfg.loop_depth = 2;
+  cfg.loop_iterations = 5;
+  cfg.body_size = 8;
+  cfg.footprint = 64;
+  cfg.seed = seed;
+  return cfg;
+}
+
+} /* namespace <unnamed> */
+
+
+TEST(output_matches_model) {
+  const auto p = program_generator(config(1)).generate();
+  CHECK(p.s.words >= 2000u);
+  CHECK_EQUAL(p.s.words, p.image.size());
+  CHECK_EQUAL(p.s.segments, p.s.outputs);
+  CHECK(p.input.empty());
+
+  const std::uint64_t before = int_computer_state::interpreted_instructions();
+  const auto result = interpret(p);
+  CHECK_EQUAL(p.s.instructions, int_computer_state::interpreted_instructions() - before);
+  CHECK(result.out == p.expected);
+}
+
+TEST(io_and_self_modification) {
+  for (std::uint64_t seed = 1; seed <= 20; ++seed) {
+    auto cfg = config(seed);
+    cfg.loop_depth = unsigned(seed % 4u);
+    cfg.io_rate = 0.2;
+    cfg.self_modify_rate = 0.2;
+    cfg.mix = { 1, 1, 2, 2 };
+    const auto p = program_generator(cfg).generate();
+    CHECK_EQUAL(p.s.inputs, p.input.size());
+    CHECK_EQUAL(p.s.outputs, p.expected.size());
+
+    const auto result = interpret(p);
+    CHECK(result.out == p.expected);
+    CHECK(blocks(p).out == p.expected);
+    CHECK(optimised(p).out == p.expected);
+    CHECK(optimised(p).state == result.state);
+  }
+}
+
+TEST(deep_loops_stay_in_range) {
+  auto cfg = config(7);
+  cfg.words = 200;
+  cfg.loop_depth = 6;
+  cfg.loop_iterations = 1000;
+  cfg.body_size = 200;
+  cfg.footprint = 16;
+  const auto p = program_generator(cfg).generate();
+  // The nest is capped, so the accumulator of a body of additions fits.
+  CHECK(p.s.instructions < 3u * (std::uint64_t(1) << 31));
+  for (const auto v : p.expected) CHECK(v >= 0);
+}
+
+TEST(text_matches_memory) {
+  auto cfg = config(3);
+  cfg.io_rate = 0.1;
+  const program_generator gen(cfg);
+  std::ostringstream program, input, expected;
+  const auto s = gen.generate(program, input, expected);
+  const auto p = gen.generate();
+
+  CHECK_EQUAL(p.s.words, s.words);
+  CHECK_EQUAL(p.s.instructions, s.instructions);
+  std::istringstream program_in(program.str());
+  CHECK(int_computer_state::parse(program_in) == p.image);
+
+  std::string expected_text;
+  for (const auto v : p.expected) expected_text += std::to_string(v) + "\n";
+  CHECK_EQUAL(expected_text, expected.str());
+  std::string input_text;
+  for (const auto v : p.input) input_text += std::to_string(v) + "\n";
+  CHECK_EQUAL(input_text, input.str());
+}
+
+TEST(same_seed_same_program) {
+  const auto x = program_generator(config(5)).generate();
+  const auto y = program_generator(config(5)).generate();
+  const auto z = program_generator(config(6)).generate();
+  CHECK(x.image == y.image);
+  CHECK(x.expected == y.expected);
+  CHECK(!(x.image == z.image));
+}
+
+TEST(rejects_bad_config) {
+  auto cfg = config(1);
+  cfg.footprint = 3;
+  CHECK_THROW(program_generator{ cfg }, std::invalid_argument);
+
+  cfg = config(1);
+  cfg.mix = { 0, 0, 0, 0 };
+  CHECK_THROW(program_generator{ cfg }, std::invalid_argument);
+
+  cfg = config(1);
+  cfg.io_rate = 0.7;
+  cfg.self_modify_rate = 0.7;
+  CHECK_THROW(program_generator{ cfg }, std::invalid_argument);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
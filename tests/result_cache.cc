@@ -0,0 +1,127 @@
+#include <result_cache.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+using value_type = result_cache::value_type;
+
+auto temp_dir() -> std::string {
+  char name[] = "/tmp/result_cache_test.XXXXXX";
+  if (::mkdtemp(name) == nullptr) throw std::runtime_error("mkdtemp");
+  return name;
+}
+
+void remove_dir(const std::string& dir) {
+  std::system(("rm -rf '" + dir + "'").c_str());
+}
+
+const int_computer_state program({ 3, 9, 8, 9, 10, 9, 4, 9, 99, -1, 8 });
+
+
+TEST(store_and_lookup) {
+  const auto dir = temp_dir();
+  {
+    result_cache cache(dir + "/cache");
+    const auto k = result_cache::machine_key(program, { 8 });
+    CHECK(!cache.lookup(k).has_value());
+
+    cache.store(k, { 1, -2, 3 });
+    const auto hit = cache.lookup(k);
+    CHECK(hit.has_value());
+    CHECK(*hit == std::vector<value_type>({ 1, -2, 3 }));
+    CHECK_EQUAL(1u, cache.hits());
+    CHECK_EQUAL(1u, cache.misses());
+
+    CHECK(!cache.lookup(result_cache::machine_key(program, { 7 })).has_value());
+  }
+
+  // Entries persist across instances.
+  result_cache cache(dir + "/cache");
+  CHECK(cache.lookup(result_cache::machine_key(program, { 8 })).has_value());
+  remove_dir(dir);
+}
+
+TEST(keys_are_distinct) {
+  auto modified = program;
+  modified[10] = 7;
+
+  const std::vector<std::uint64_t> hashes = {
+    result_cache::machine_key(program, { 8 }).hash(),
+    result_cache::machine_key(program, { 8, 8 }).hash(),
+    result_cache::machine_key(modified, { 8 }).hash(),
+    result_cache::chain_key(program, { 8 }, 0, false).hash(),
+    result_cache::chain_key(program, { 8 }, 0, true).hash(),
+    result_cache::chain_key(program, { 8 }, 1, true).hash(),
+  };
+  for (std::size_t i = 0; i < hashes.size(); ++i)
+    for (std::size_t j = i + 1u; j < hashes.size(); ++j) CHECK(hashes[i] != hashes[j]);
+  CHECK_EQUAL(result_cache::machine_key(program, { 8 }).hash(), hashes[0]);
+}
+
+TEST(get_computes_once) {
+  const auto dir = temp_dir();
+  result_cache cache(dir);
+  int calls = 0;
+  const auto compute = [&calls]() {
+    ++calls;
+    return std::vector<value_type>{ 42 };
+  };
+
+  const auto k = result_cache::chain_key(program, { 0, 1, 2, 3, 4 }, 0, false);
+  CHECK(cache.get(k, compute) == std::vector<value_type>{ 42 });
+  CHECK(cache.get(k, compute) == std::vector<value_type>{ 42 });
+  CHECK_EQUAL(1, calls);
+  remove_dir(dir);
+}
+
+TEST(corrupt_entry_is_a_miss) {
+  const auto dir = temp_dir();
+  result_cache cache(dir);
+  const auto k = result_cache::machine_key(program, { 1 });
+  cache.store(k, { 5 });
+
+  // Truncate every entry.
+  std::system(("find '" + dir + "' -mindepth 2 -type f -exec truncate -s 20 {} +").c_str());
+  CHECK(!cache.lookup(k).has_value());
+  remove_dir(dir);
+}
+
+TEST(entries_hold_a_digest_of_the_key) {
+  const auto dir = temp_dir();
+  result_cache cache(dir);
+  std::vector<value_type> image(100000, 0);
+  image[0] = 99;
+  const int_computer_state large(image.begin(), image.end());
+  const auto k = result_cache::machine_key(large, {});
+  cache.store(k, { 1, 2, 3 });
+  CHECK(cache.lookup(k).has_value());
+
+  // Magic, digest, output count and outputs; not a copy of the program.
+  CHECK_EQUAL(0, std::system(("test \"$(find '" + dir + "' -mindepth 2 -type f -size 72c | wc -l)\" -eq 1").c_str()));
+  remove_dir(dir);
+}
+
+TEST(eviction) {
+  const auto dir = temp_dir();
+  result_cache cache(dir, 8 * 1024);
+  const auto first = result_cache::machine_key(program, { 0 });
+  cache.store(first, std::vector<value_type>(10, 1));
+
+  for (int i = 1; i < 200; ++i) {
+    cache.store(result_cache::machine_key(program, { i }), std::vector<value_type>(10, i));
+    CHECK(cache.lookup(first).has_value()); // Keeps the first entry recently used.
+  }
+
+  cache.evict();
+  CHECK(cache.lookup(first).has_value());
+  CHECK(!cache.lookup(result_cache::machine_key(program, { 1 })).has_value());
+  CHECK(cache.lookup(result_cache::machine_key(program, { 199 })).has_value());
+  remove_dir(dir);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
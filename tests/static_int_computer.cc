@@ -0,0 +1,49 @@
+#include <static_int_computer.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <array>
+
+
+constexpr int_computer_state::value_type day7_part1_example1[] = {3,15,3,16,1002,16,10,16,1,16,15,15,4,15,99,0,0};
+constexpr int_computer_state::value_type day7_part2_example1[] = {3,26,1001,26,-4,26,3,27,1002,27,2,27,1,27,26,27,4,27,1001,28,-1,28,1005,28,6,99,0,0,5};
+constexpr int_computer_state::value_type day5_part2_example[] = {3,9,8,9,10,9,4,9,99,-1,8};
+
+static_assert(make_static_int_computer({ 1, 0, 0, 0, 99 }).eval()[0] == 2);
+static_assert(make_static_amplifier_chain({4,3,2,1,0}, day7_part1_example1)(0) == 43210);
+static_assert(make_static_amplifier_chain({9,8,7,6,5}, day7_part2_example1).feedback_eval(0) == 139629729);
+
+// Compile time table of the outputs for the inputs 0..15.
+constexpr auto day5_part2_table = []() {
+  std::array<int_computer_state::value_type, 16> table{};
+  for (std::size_t x = 0; x < table.size(); ++x) {
+    table[x] = static_int_computer<std::size(day5_part2_example)>::single_output(
+        make_static_int_computer(day5_part2_example),
+        std::array<int_computer_state::value_type, 1>{ int(x) });
+  }
+  return table;
+}();
+static_assert(day5_part2_table[7] == 0 && day5_part2_table[8] == 1 && day5_part2_table[9] == 0);
+
+
+TEST(matches_runtime_interpreter) {
+  for (int x = 0; x < 16; ++x) {
+    CHECK_EQUAL(
+        int_computer_state::single_input_single_output({3,9,8,9,10,9,4,9,99,-1,8}, x),
+        day5_part2_table[x]);
+  }
+}
+
+TEST(day7_part2_example2) {
+  constexpr int_computer_state::value_type program[] = {3,52,1001,52,-5,52,3,53,1,52,56,54,1007,54,5,55,1005,55,26,1001,54,-5,54,1105,1,12,1,53,54,53,1008,54,0,55,1001,55,1,55,2,53,55,53,4,53,1001,56,-1,56,1005,56,6,99,0,0,0,0,10};
+  constexpr auto result = make_static_amplifier_chain({9,7,8,5,6}, program).feedback_eval(0);
+  CHECK_EQUAL(18216, result);
+}
+
+TEST(errors_at_runtime) {
+  CHECK_THROW(make_static_int_computer({ 3, 0, 99 }).eval(), io_error);
+  CHECK_THROW(make_static_int_computer({ 1101, 1, 1, 9, 99 }).eval(), std::out_of_range);
+  CHECK_THROW(make_static_int_computer({ 98 }).eval(), invalid_opcode_error);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
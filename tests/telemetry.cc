@@ -0,0 +1,108 @@
+#include <telemetry.hh>
+#include <int_computer.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace {
+
+auto counted(telemetry::counter c) -> std::uint64_t {
+  return telemetry::read()[static_cast<std::size_t>(c)];
+}
+
+} /* namespace <unnamed> */
+
+
+TEST(counts_machine_activity) {
+  const auto before = telemetry::read();
+  int_computer_state::single_input_single_output({3,9,8,9,10,9,4,9,99,-1,8}, 8);
+  const auto after = telemetry::read();
+
+  const auto delta = [&](telemetry::counter c) {
+    return after[static_cast<std::size_t>(c)] - before[static_cast<std::size_t>(c)];
+  };
+  if (!telemetry::enabled) {
+    CHECK_EQUAL(0u, delta(telemetry::counter::instructions));
+    return;
+  }
+  CHECK_EQUAL(3u, delta(telemetry::counter::instructions));
+  CHECK_EQUAL(1u, delta(telemetry::counter::reads));
+  CHECK_EQUAL(1u, delta(telemetry::counter::writes));
+  CHECK_EQUAL(1u, delta(telemetry::counter::halts));
+}
+
+TEST(sums_all_threads) {
+  const auto before = counted(telemetry::counter::searches);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back(
+        []() {
+          for (int j = 0; j < 1000; ++j) telemetry::add(telemetry::counter::searches);
+        });
+  }
+  for (auto& t : threads) t.join();
+  // Blocks of exited threads keep their counts, and are reused.
+  std::thread([]() { telemetry::add(telemetry::counter::searches, 5); }).join();
+
+  CHECK_EQUAL(telemetry::enabled ? 8005u : 0u, counted(telemetry::counter::searches) - before);
+}
+
+TEST(prometheus_format) {
+  std::ostringstream out;
+  telemetry::write_prometheus(out);
+  const std::string text = out.str();
+  CHECK(text.find("# TYPE intcode_instructions_total counter\n") != std::string::npos);
+  CHECK(text.find("\nintcode_searches_total ") != std::string::npos);
+}
+
+TEST(dump_to_file) {
+  const std::string filename = "telemetry_test.prom";
+  std::remove(filename.c_str());
+  {
+    telemetry_dumper dumper(filename, std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  std::ifstream in(filename);
+  const std::string text{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+  CHECK(text.find("intcode_halts_total ") != std::string::npos);
+  std::remove(filename.c_str());
+}
+
+TEST(serve_on_unix_socket) {
+  const std::string path = "telemetry_test.sock";
+  telemetry_dumper dumper("unix:" + path);
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, path.c_str());
+  const int rc = ::connect(fd, reinterpret_cast<const ::sockaddr*>(&addr), sizeof(addr));
+  CHECK_EQUAL(0, rc);
+  if (rc != 0) {
+    ::close(fd);
+    return;
+  }
+
+  std::string text;
+  char buf[4096];
+  for (ssize_t n; (n = ::read(fd, buf, sizeof(buf))) > 0; ) text.append(buf, n);
+  ::close(fd);
+  CHECK(text.find("# HELP intcode_reads_total ") != std::string::npos);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
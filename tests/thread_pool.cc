@@ -0,0 +1,48 @@
+#include <thread_pool.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <atomic>
+#include <stdexcept>
+
+
+TEST(runs_all_tasks) {
+  std::atomic<int> sum{ 0 };
+  thread_pool pool(4);
+  CHECK_EQUAL(4u, pool.size());
+  for (int i = 1; i <= 1000; ++i) pool.submit([&sum, i]() { sum += i; });
+  pool.wait();
+  CHECK_EQUAL(500500, sum.load());
+
+  pool.submit([&sum]() { sum = 0; });
+  pool.wait();
+  CHECK_EQUAL(0, sum.load());
+}
+
+TEST(destructor_drains_queue) {
+  std::atomic<int> count{ 0 };
+  {
+    thread_pool pool(2);
+    for (int i = 0; i < 100; ++i) pool.submit([&count]() { ++count; });
+  }
+  CHECK_EQUAL(100, count.load());
+}
+
+TEST(exception_propagates_to_wait) {
+  std::atomic<int> count{ 0 };
+  thread_pool pool(3);
+  for (int i = 0; i < 10; ++i) {
+    pool.submit(
+        [&count, i]() {
+          ++count;
+          if (i == 5) throw std::runtime_error("task failed");
+        });
+  }
+  CHECK_THROW(pool.wait(), std::runtime_error);
+  CHECK_EQUAL(10, count.load());
+
+  // The error is reported once.
+  pool.wait();
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,82 @@
+#include <trace_recorder.hh>
+#include <UnitTest++/UnitTest++.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+auto record_trace(int_computer_state s, const std::string& filename) -> void {
+  trace_recorder recorder(filename);
+  s.tracer = &recorder;
+  s.read_cb = []() -> int_computer_state::value_type { return 8; };
+  s.write_cb = [](int_computer_state::value_type) {};
+  s.eval();
+}
+
+auto load_trace(const std::string& filename) -> std::vector<trace_record> {
+  auto file = std::ifstream(filename, std::ios::binary);
+  trace_reader reader(file);
+
+  std::vector<trace_record> records;
+  trace_record r;
+  while (reader.next(r)) records.push_back(r);
+  return records;
+}
+
+
+TEST(trace_roundtrip) {
+  const std::string filename = "trace_recorder_test.trace";
+  record_trace({3,9,8,9,10,9,4,9,99,-1,8}, filename);
+  const auto records = load_trace(filename);
+  std::remove(filename.c_str());
+
+  CHECK_EQUAL(3u, records.size()); // eval() does not execute the halt instruction
+  if (records.size() != 3u) return;
+
+  CHECK_EQUAL(0u, records[0].pc); // read [9]
+  CHECK_EQUAL(3, records[0].instruction);
+  CHECK_EQUAL(9, records[0].args[0]);
+  CHECK_EQUAL(8, records[0].result);
+
+  CHECK_EQUAL(2u, records[1].pc); // equals [9] [10] [9]
+  CHECK_EQUAL(8, records[1].instruction);
+  CHECK_EQUAL(1, records[1].result);
+
+  CHECK_EQUAL(6u, records[2].pc); // write [9]
+  CHECK_EQUAL(1, records[2].result);
+}
+
+TEST(trace_overflow) {
+  const std::string filename = "trace_recorder_test.trace";
+  std::uint64_t total = 0, dropped = 0;
+  {
+    // Fill the ring faster than the writer drains it.
+    trace_recorder recorder(filename, 4);
+    trace_record r{};
+    while (total < 1000u || recorder.dropped() == 0u) {
+      r.pc = static_cast<std::uint32_t>(total++);
+      recorder.record(r);
+    }
+    dropped = recorder.dropped();
+  }
+  const auto records = load_trace(filename);
+  std::remove(filename.c_str());
+
+  // Kept records in order, followed by a marker holding the dropped count.
+  CHECK(dropped > 0u);
+  CHECK_EQUAL(total - dropped + 1u, records.size());
+  if (records.empty()) return;
+  CHECK_EQUAL(trace_record::dropped_marker, records.back().pc);
+  CHECK_EQUAL(dropped, static_cast<std::uint64_t>(records.back().result));
+  for (std::size_t i = 1; i + 1u < records.size(); ++i) CHECK(records[i - 1u].pc < records[i].pc);
+}
+
+TEST(trace_off_by_default) {
+  CHECK(int_computer_state({ 99 }).tracer == nullptr);
+}
+
+int main() {
+  return UnitTest::RunAllTests();
+}
@@ -0,0 +1,26 @@
+# Runs ${program} with the interpreter (${reference}) and the transpiled
+# executable (${transpiled}) on the comma separated ${input},
+# and fails unless both produce the same output.
+# The input is written to ${input_file}.
+
+file(WRITE ${input_file} "${input}\n")
+execute_process(COMMAND ${reference} ${program}
+    INPUT_FILE ${input_file}
+    OUTPUT_VARIABLE expected
+    RESULT_VARIABLE expected_rc
+    TIMEOUT 10)
+execute_process(COMMAND ${transpiled}
+    INPUT_FILE ${input_file}
+    OUTPUT_VARIABLE actual
+    RESULT_VARIABLE actual_rc
+    TIMEOUT 10)
+
+if (NOT expected_rc EQUAL 0)
+  message(FATAL_ERROR "interpreter failed (${expected_rc})")
+endif ()
+if (NOT actual_rc EQUAL 0)
+  message(FATAL_ERROR "transpiled program failed (${actual_rc})")
+endif ()
+if (NOT expected STREQUAL actual)
+  message(FATAL_ERROR "output differs:\ninterpreter:\n${expected}\ntranspiled:\n${actual}")
+endif ()
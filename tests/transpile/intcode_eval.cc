@@ -0,0 +1,27 @@
+#include <buffered_io.hh>
+#include <int_computer.hh>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+// Reference for the transpiler tests: runs a program with int_computer_state::eval(),
+// with the same I/O as the main() generated by intcode_transpile --main.
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: " << (argc >= 1 ? argv[0] : "intcode_eval") << " program.txt" << std::endl;
+    return 1;
+  }
+
+  try {
+    auto program = std::ifstream(argv[1]);
+    int_computer_state ic = int_computer_state::parse(program);
+    buffered_io io;
+    io.attach(ic);
+
+    ic.eval();
+    io.flush();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
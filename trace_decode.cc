@@ -0,0 +1,84 @@
+#include <trace_recorder.hh>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+
+auto mnemonic(opcode op) -> const char* {
+  switch (op) {
+    case opcode::add:           return "add";
+    case opcode::mul:           return "mul";
+    case opcode::read:          return "read";
+    case opcode::write:         return "write";
+    case opcode::jump_if_true:  return "jump_if_true";
+    case opcode::jump_if_false: return "jump_if_false";
+    case opcode::less_than:     return "less_than";
+    case opcode::equals:        return "equals";
+    case opcode::halt:          return "halt";
+  }
+  return "???";
+}
+
+auto argument_count(opcode op) -> int {
+  const auto& instr_map = int_computer_state::instructions();
+  const auto instr_iter = instr_map.find(op);
+  return instr_iter == instr_map.end() ? 0 : int(instr_iter->second.arguments);
+}
+
+void print(std::ostream& out, const trace_record& r) {
+  if (r.pc == trace_record::dropped_marker) {
+    out << "*** " << r.result << " records dropped\n";
+    return;
+  }
+
+  const auto op = opcode(r.instruction % 100);
+  out << "pc=" << r.pc << " " << mnemonic(op);
+
+  auto modifiers = r.instruction / 100;
+  for (int i = 0, n = argument_count(op); i < n; ++i, modifiers /= 10) {
+    if (modifiers % 10 == 0)
+      out << " [" << r.args[i] << "]";
+    else
+      out << " " << r.args[i];
+  }
+
+  switch (op) {
+    default:
+      break;
+    case opcode::write:
+      out << " => " << r.result;
+      break;
+    case opcode::jump_if_true: [[fallthrough]];
+    case opcode::jump_if_false:
+      out << " -> pc=" << r.result;
+      break;
+    case opcode::add: [[fallthrough]];
+    case opcode::mul: [[fallthrough]];
+    case opcode::read: [[fallthrough]];
+    case opcode::less_than: [[fallthrough]];
+    case opcode::equals:
+      out << " := " << r.result;
+      break;
+  }
+  out << "\n";
+}
+
+int main(int argc, char* argv[]) {
+  const auto progname = argc >= 1 ? argv[0] : "trace_decode";
+  if (argc != 2) {
+    std::cerr << "Usage: " << progname << " trace_file" << std::endl;
+    return 1;
+  }
+
+  try {
+    auto file = std::ifstream(argv[1], std::ios::binary);
+    if (!file) throw std::runtime_error(std::string("unable to open ") + argv[1]);
+
+    trace_reader reader(file);
+    trace_record r;
+    while (reader.next(r)) print(std::cout, r);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}